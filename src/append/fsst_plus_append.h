@@ -0,0 +1,233 @@
+#pragma once
+#include <stdexcept>
+#include <vector>
+#include "../fsst_plus.h"
+#include "block_decompressor.h"
+#include "bloom_filter.h"
+#include "cleaving.h"
+#include "zone_map.h"
+
+/*
+ * Appending rows to an FSST+ corpus without compressing it again. The blocks of all complete cleaving runs are kept
+ * byte for byte (blocks only hold offsets relative to themselves). Only the trailing partial run, if any, is decoded
+ * and cleaved again together with the appended rows, encoded with the corpus' existing symbol tables and written as
+ * new blocks. The global header, zone map and Bloom filters are written anew around them.
+ *
+ * Reusing the symbol tables pays off as long as the appended strings look like the ones they were trained on.
+ * When the new blocks compress worse than config::append_retrain_ratio times the old ones, everything is compressed
+ * again from scratch with freshly trained symbol tables instead.
+ */
+struct FSSTPlusAppendResult {
+    FSSTPlusCompressionResult segment; // in the worker's ThreadArena(), like the corpus appended to
+    bool retrained; // segment has new encoders, the caller still owns (and destroys) the previous ones
+};
+
+// Decompressed bytes per stored byte of blocks [first_block, last_block)
+inline double CalcBlocksCompressionRatio(uint8_t *global_header, const size_t first_block, const size_t last_block) {
+    uint8_t *block_start_offsets = global_header + sizeof(uint16_t);
+    const size_t stored_bytes = FindBlockStart(block_start_offsets, last_block) - FindBlockStart(block_start_offsets, first_block);
+    const size_t decompressed_bytes = LoadDecompressedOffset(global_header, last_block) - LoadDecompressedOffset(global_header, first_block);
+    return stored_bytes == 0 ? 0 : static_cast<double>(decompressed_bytes) / static_cast<double>(stored_bytes);
+}
+
+// Cleaves, encodes with the given encoders and writes input as a corpus of its own
+inline FSSTPlusCompressionResult FSSTPlusCompressWithEncoders(const size_t n, StringCollection &input, const size_t &block_granularity,
+                                                              fsst_encoder_t *prefix_encoder, fsst_encoder_t *suffix_encoder,
+                                                              StageMeasurements &stages, MemoryFootprint &memory) {
+    CleavingRuns runs;
+    const std::vector<SimilarityChunk> similarity_chunks = FormBlockwiseSimilarityChunks(n, input, block_granularity, runs, stages);
+    const size_t n_strings = runs.first_strings.back();
+    const StageProbe cleave_probe;
+    CleavedResult cleaved_result = Cleave(input.lengths, input.string_ptrs, similarity_chunks, n_strings);
+    cleave_probe.Stop(stages.cleave);
+    const FSSTCompressionResult prefix_compression_result = FSSTEncode(prefix_encoder, cleaved_result.prefixes, stages.encode);
+    const FSSTCompressionResult suffix_compression_result = FSSTEncode(suffix_encoder, cleaved_result.suffixes, stages.encode);
+    return FSSTPlusWrite(n_strings, similarity_chunks, cleaved_result, runs, block_granularity,
+                         prefix_compression_result, suffix_compression_result, stages, memory);
+}
+
+/*
+ * Puts the corpus together from the first kept_blocks blocks of head and all blocks of tail, whose rows come after
+ * the head's first tail_first_row rows. Zone maps and Bloom filters are joined the same way. Like FSSTPlusWrite(),
+ * sets memory.fsst_plus_buffer_bytes to what the result takes.
+ */
+inline FSSTPlusCompressionResult SpliceFSSTPlusCorpora(const FSSTPlusCompressionResult &head, const size_t kept_blocks, const size_t tail_first_row,
+                                                       const FSSTPlusCompressionResult &tail, MemoryFootprint &memory) {
+    uint8_t *head_header = head.data_start;
+    uint8_t *tail_header = tail.data_start;
+    uint8_t *head_block_start_offsets = head_header + sizeof(uint16_t);
+    uint8_t *tail_block_start_offsets = tail_header + sizeof(uint16_t);
+    const size_t tail_blocks = Load<uint16_t>(tail_header);
+    const size_t n_blocks = kept_blocks + tail_blocks;
+    if (n_blocks > UINT16_MAX) {
+        throw std::logic_error("Appended FSST+ corpus exceeds the uint16 range of num_blocks");
+    }
+    const size_t num_rows = tail_first_row + LoadNumRows(tail_header);
+    if (num_rows > UINT32_MAX) {
+        throw std::logic_error("Appended FSST+ row count exceeds the uint32 range of num_rows");
+    }
+
+    const uint8_t *head_blocks = FindBlockStart(head_block_start_offsets, 0);
+    const size_t head_blocks_size = FindBlockStart(head_block_start_offsets, kept_blocks) - head_blocks;
+    const uint8_t *tail_blocks_start = FindBlockStart(tail_block_start_offsets, 0);
+    const size_t tail_blocks_size = FindBlockStart(tail_block_start_offsets, tail_blocks) - tail_blocks_start;
+    const size_t header_size = sizeof(uint16_t) + (n_blocks + 1) * sizeof(uint32_t) + CalcGlobalHeaderTrailerSize(n_blocks, num_rows);
+
+    FSSTPlusCompressionResult result{};
+    result.prefix_encoder = tail.prefix_encoder;
+    result.suffix_encoder = tail.suffix_encoder;
+    const size_t size = header_size + head_blocks_size + tail_blocks_size;
+    result.data_start = ThreadArena().Allocate(size);
+    result.data_end = result.data_start + size;
+    memory.fsst_plus_buffer_bytes = size;
+
+    // num_blocks, then block_start_offsets[] and data_end_offset, each relative to where it is stored
+    uint8_t *ptr = result.data_start;
+    Store<uint16_t>(n_blocks, ptr);
+    ptr += sizeof(uint16_t);
+    for (size_t i = 0; i <= n_blocks; i++) {
+        const size_t block_position = i < kept_blocks
+                                          ? header_size + (FindBlockStart(head_block_start_offsets, i) - head_blocks)
+                                          : header_size + head_blocks_size +
+                                            (FindBlockStart(tail_block_start_offsets, i - kept_blocks) - tail_blocks_start);
+        Store<uint32_t>(block_position - (ptr - result.data_start), ptr);
+        ptr += sizeof(uint32_t);
+    }
+
+    // decompressed_offsets[], the tail's continue from where the kept blocks end
+    const size_t head_decompressed_size = LoadDecompressedOffset(head_header, kept_blocks);
+    for (size_t i = 0; i <= n_blocks; i++) {
+        const size_t decompressed_offset = i <= kept_blocks ? LoadDecompressedOffset(head_header, i)
+                                                            : head_decompressed_size + LoadDecompressedOffset(tail_header, i - kept_blocks);
+        if (decompressed_offset > UINT32_MAX) {
+            throw std::logic_error("Appended FSST+ decompressed size exceeds the uint32 range of decompressed_offsets[]");
+        }
+        Store<uint32_t>(decompressed_offset, ptr);
+        ptr += sizeof(uint32_t);
+    }
+
+    // block_run_starts[], num_rows and the validity bitmap, the tail's rows shifted by tail_first_row
+    for (size_t i = 0; i < n_blocks; i++) {
+        Store<uint32_t>(i < kept_blocks ? LoadBlockRunStart(head_header, i)
+                                        : tail_first_row + LoadBlockRunStart(tail_header, i - kept_blocks), ptr);
+        ptr += sizeof(uint32_t);
+    }
+    Store<uint32_t>(num_rows, ptr);
+    ptr += sizeof(uint32_t);
+    uint8_t *validity = ptr;
+    memset(validity, 0, (num_rows + 7) / 8);
+    const uint8_t *head_validity = FindValidity(head_header);
+    const uint8_t *tail_validity = FindValidity(tail_header);
+    for (size_t row = 0; row < num_rows; row++) {
+        const bool valid = row < tail_first_row ? RowIsValid(head_validity, row) : RowIsValid(tail_validity, row - tail_first_row);
+        validity[row / 8] |= static_cast<uint8_t>(valid) << (row % 8);
+    }
+    ptr += (num_rows + 7) / 8;
+
+    memcpy(ptr, head_blocks, head_blocks_size);
+    memcpy(ptr + head_blocks_size, tail_blocks_start, tail_blocks_size);
+
+    // Zone map: fixed size entries
+    const size_t zone_map_size = sizeof(uint16_t) + n_blocks * zone_map_entry_size;
+    result.zone_map_start = ThreadArena().Allocate(zone_map_size);
+    result.zone_map_end = result.zone_map_start + zone_map_size;
+    Store<uint16_t>(n_blocks, result.zone_map_start);
+    memcpy(result.zone_map_start + sizeof(uint16_t), head.zone_map_start + sizeof(uint16_t), kept_blocks * zone_map_entry_size);
+    memcpy(result.zone_map_start + sizeof(uint16_t) + kept_blocks * zone_map_entry_size, tail.zone_map_start + sizeof(uint16_t),
+           tail_blocks * zone_map_entry_size);
+    memory.fsst_plus_buffer_bytes += zone_map_size;
+
+    // Bloom filters: the tail's bucket offsets continue from the kept blocks' buckets
+    if (head.bloom_filter_start != nullptr && tail.bloom_filter_start != nullptr) {
+        const size_t head_buckets = LoadBloomFilterBucketOffset(head.bloom_filter_start, kept_blocks);
+        const size_t tail_buckets = LoadBloomFilterBucketOffset(tail.bloom_filter_start, tail_blocks);
+        const size_t bloom_header_size = sizeof(uint16_t) + (n_blocks + 1) * sizeof(uint32_t);
+        const size_t bloom_size = bloom_header_size + (head_buckets + tail_buckets) * bloom_filter_bucket_size;
+        result.bloom_filter_start = ThreadArena().Allocate(bloom_size);
+        result.bloom_filter_end = result.bloom_filter_start + bloom_size;
+        Store<uint16_t>(n_blocks, result.bloom_filter_start);
+        for (size_t i = 0; i <= n_blocks; i++) {
+            Store<uint32_t>(i <= kept_blocks ? LoadBloomFilterBucketOffset(head.bloom_filter_start, i)
+                                             : head_buckets + LoadBloomFilterBucketOffset(tail.bloom_filter_start, i - kept_blocks),
+                            result.bloom_filter_start + sizeof(uint16_t) + i * sizeof(uint32_t));
+        }
+        memcpy(result.bloom_filter_start + bloom_header_size, FindBloomFilterBuckets(head.bloom_filter_start),
+               head_buckets * bloom_filter_bucket_size);
+        memcpy(result.bloom_filter_start + bloom_header_size + head_buckets * bloom_filter_bucket_size,
+               FindBloomFilterBuckets(tail.bloom_filter_start), tail_buckets * bloom_filter_bucket_size);
+        memory.fsst_plus_buffer_bytes += bloom_size;
+    }
+    return result;
+}
+
+/*
+ * Appends the rows of appended (nullptr strings are NULL rows) to segment, which must have been compressed with the
+ * same block_granularity. segment is left untouched.
+ */
+inline FSSTPlusAppendResult FSSTPlusAppend(const FSSTPlusCompressionResult &segment, const StringCollection &appended,
+                                           const size_t &block_granularity, StageMeasurements &stages, MemoryFootprint &memory) {
+    uint8_t *global_header = segment.data_start;
+    const size_t num_blocks = Load<uint16_t>(global_header);
+    const size_t num_rows = LoadNumRows(global_header);
+    const fsst_decoder_t prefix_decoder = fsst_decoder(segment.prefix_encoder);
+    const fsst_decoder_t suffix_decoder = fsst_decoder(segment.suffix_encoder);
+    constexpr size_t decompression_padding = 32;
+
+    // The trailing partial run is cleaved again with the appended rows, the blocks before it stay as they are
+    const size_t tail_first_row = num_rows - num_rows % block_granularity;
+    const size_t kept_blocks = tail_first_row == 0 ? 0 : FindFirstBlockAfterRow(global_header, 0, tail_first_row - 1);
+    const size_t tail_old_rows = num_rows - tail_first_row;
+
+    std::vector<uint32_t> tail_rows(tail_old_rows);
+    for (size_t k = 0; k < tail_old_rows; k++) {
+        tail_rows[k] = tail_first_row + k;
+    }
+    const size_t tail_capacity = LoadDecompressedOffset(global_header, num_blocks) - LoadDecompressedOffset(global_header, kept_blocks) +
+                                 decompression_padding;
+    unsigned char *tail_out = ThreadArena().Allocate(tail_capacity);
+    std::vector<const unsigned char *> tail_ptrs(tail_old_rows);
+    std::vector<size_t> tail_lengths(tail_old_rows);
+    DecompressSelection(global_header, prefix_decoder, suffix_decoder, tail_rows.data(), tail_old_rows,
+                        tail_out, tail_out + tail_capacity, tail_ptrs, tail_lengths);
+
+    std::vector<size_t> appended_lengths = appended.lengths;
+    for (size_t k = 0; k < appended_lengths.size(); k++) {
+        if (appended.string_ptrs[k] == nullptr) {
+            appended_lengths[k] = 0;
+        }
+    }
+    const size_t n = tail_old_rows + appended_lengths.size();
+    StringCollection tail(n, false); // cleaving sorts it in place
+    tail.lengths = tail_lengths;
+    tail.string_ptrs = tail_ptrs;
+    tail.lengths.insert(tail.lengths.end(), appended_lengths.begin(), appended_lengths.end());
+    tail.string_ptrs.insert(tail.string_ptrs.end(), appended.string_ptrs.begin(), appended.string_ptrs.end());
+
+    // The tail's own corpus is only copied into the spliced one, its buffer does not count towards the result
+    MemoryFootprint tail_memory;
+    const FSSTPlusCompressionResult tail_result = FSSTPlusCompressWithEncoders(n, tail, block_granularity, segment.prefix_encoder,
+                                                                               segment.suffix_encoder, stages, tail_memory);
+    memory.prefix_fsst_bytes = tail_memory.prefix_fsst_bytes;
+    memory.suffix_fsst_bytes = tail_memory.suffix_fsst_bytes;
+    const double old_ratio = CalcBlocksCompressionRatio(global_header, 0, num_blocks);
+    const double tail_ratio = CalcBlocksCompressionRatio(tail_result.data_start, 0, Load<uint16_t>(tail_result.data_start));
+    const bool tail_has_strings = LoadDecompressedOffset(tail_result.data_start, Load<uint16_t>(tail_result.data_start)) > 0;
+    if (!tail_has_strings || tail_ratio >= config::append_retrain_ratio * old_ratio) {
+        const StageProbe writing_probe;
+        const FSSTPlusCompressionResult spliced = SpliceFSSTPlusCorpora(segment, kept_blocks, tail_first_row, tail_result, memory);
+        writing_probe.Stop(stages.writing);
+        return FSSTPlusAppendResult{spliced, false};
+    }
+
+    // The symbol tables no longer fit the data: decode everything and compress it again with new ones
+    const size_t all_capacity = LoadDecompressedOffset(global_header, num_blocks) + decompression_padding;
+    unsigned char *all_out = ThreadArena().Allocate(all_capacity);
+    StringCollection all(num_rows + appended_lengths.size(), false);
+    all.lengths.resize(num_rows);
+    all.string_ptrs.resize(num_rows);
+    DecompressAll(global_header, prefix_decoder, suffix_decoder, all_out, all_capacity, all.string_ptrs, all.lengths);
+    all.lengths.insert(all.lengths.end(), appended_lengths.begin(), appended_lengths.end());
+    all.string_ptrs.insert(all.string_ptrs.end(), appended.string_ptrs.begin(), appended.string_ptrs.end());
+
+    return FSSTPlusAppendResult{CompressFSSTPlus(all, block_granularity, stages, memory), true};
+}
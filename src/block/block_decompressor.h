@@ -3,101 +3,515 @@
 #include <ranges>
 #include "duckdb.hpp"
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
 #include "basic_fsst.h"
+#include "thread_pool.h"
 #include "../config.h"
 #include "../global.h"
 
-inline void DecompressBlock(const uint8_t *block_start, const fsst_decoder_t &prefix_decoder,
-const fsst_decoder_t &suffix_decoder, const uint8_t *block_stop,
-const std::vector<size_t> &lengths_original,
-const std::vector<const unsigned char *> &string_ptrs_original, Metadata &metadata) {
-    if (config::print_decompressed_corpus) {
-        std::cout << " ------- Block " << metadata.global_index/128 << "\n";
+/*
+ * Block layout:
+ *   uint8_t  n_strings
+ *   uint16_t suffix_data_area_offsets[n_strings]   relative to the end of each offset
+ *   uint8_t  rows[n_strings]                       original row of each string, relative to its cleaving run
+ *   prefix area, suffix area
+ *
+ * A string identical to the one before it has no suffix data area entry of its own: its offset points at the entry
+ * of the previous string.
+ */
+inline const uint8_t *FindSuffixDataArea(const uint8_t *block_start, const size_t i) {
+    const uint8_t *suffix_data_area_offset_ptr = block_start + sizeof(uint8_t) + i * sizeof(uint16_t);
+    // Count itself with + sizeof(uint16_t). So the offsetting starts at the value's end.
+    return suffix_data_area_offset_ptr + sizeof(uint16_t) + Load<uint16_t>(suffix_data_area_offset_ptr);
+}
+
+/*
+ * fsst_decompress() returns the full decoded size even when it had to cut the output short, so a size that does not fit
+ * between out and out_end means out_end - out would underflow for the next write. Throws instead.
+ */
+inline void CheckDecompressedSize(const size_t decompressed_size, const unsigned char *out, const unsigned char *out_end) {
+    if (decompressed_size > static_cast<size_t>(out_end - out)) {
+        throw std::logic_error("Decompression buffer of " + std::to_string(out_end - out) + " bytes is too small for a string of " +
+                               std::to_string(decompressed_size) + " bytes");
+    }
+}
+
+/*
+ * Decodes the prefix that a reference with length byte prefix_length points at into out and returns its decompressed
+ * size. A nested prefix first decodes its parent, then the bytes it adds.
+ */
+inline size_t DecompressPrefix(const fsst_decoder_t &prefix_decoder, const uint8_t prefix_length, const uint8_t *prefix_ptr,
+                               unsigned char *out, const unsigned char *out_end) {
+    if (prefix_length != nested_prefix_marker) {
+        return fsst_decompress(&prefix_decoder, prefix_length, prefix_ptr, out_end - out, out);
+    }
+    const uint8_t own_length = Load<uint8_t>(prefix_ptr);
+    const uint8_t parent_length = Load<uint8_t>(prefix_ptr + sizeof(uint8_t));
+    const uint16_t parent_jumpback = Load<uint16_t>(prefix_ptr + 2 * sizeof(uint8_t));
+    const size_t parent_size = DecompressPrefix(prefix_decoder, parent_length, prefix_ptr - parent_jumpback, out, out_end);
+    CheckDecompressedSize(parent_size, out, out_end);
+    return parent_size + fsst_decompress(&prefix_decoder, own_length, prefix_ptr + nested_prefix_header_size,
+                                         out_end - out - parent_size, out + parent_size);
+}
+
+// Where string i of the block keeps its encoded bytes
+struct BlockStringEntry {
+    uint8_t prefix_length; // encoded length of the referenced prefix, 0 for none or nested_prefix_marker
+    const uint8_t *encoded_prefix_ptr; // nullptr if the string has no prefix
+    const uint8_t *encoded_suffix_ptr;
+    size_t encoded_suffix_length;
+};
+
+inline BlockStringEntry FindBlockStringEntry(const uint8_t *block_start, const size_t n_strings, const size_t i,
+                                             const uint8_t *block_stop) {
+    const uint8_t *suffix_data_area_start = FindSuffixDataArea(block_start, i);
+    const uint8_t prefix_length = Load<uint8_t>(suffix_data_area_start);
+
+    // The entry ends where the next distinct entry starts, duplicates of this string point at the same entry
+    const uint8_t *suffix_data_area_end = block_stop;
+    for (size_t j = i + 1; j < n_strings; j++) {
+        const uint8_t *next_suffix_data_area_start = FindSuffixDataArea(block_start, j);
+        if (next_suffix_data_area_start != suffix_data_area_start) {
+            suffix_data_area_end = next_suffix_data_area_start;
+            break;
+        }
     }
+    const uint16_t suffix_data_area_length = suffix_data_area_end - suffix_data_area_start;
 
+    if (prefix_length == 0) {
+        // suffix only
+        return BlockStringEntry{0, nullptr, suffix_data_area_start + sizeof(uint8_t),
+                                static_cast<size_t>(suffix_data_area_length - sizeof(uint8_t))};
+    }
+    const uint8_t *jumpback_offset_ptr = suffix_data_area_start + sizeof(uint8_t);
+    const uint16_t jumpback_offset = Load<uint16_t>(jumpback_offset_ptr);
+
+    const uint8_t *encoded_suffix_ptr = jumpback_offset_ptr + sizeof(uint16_t);
+
+    const uint8_t *encoded_prefix_ptr =
+            encoded_suffix_ptr - jumpback_offset - sizeof(uint8_t) - sizeof(uint16_t);
+    return BlockStringEntry{prefix_length, encoded_prefix_ptr, encoded_suffix_ptr,
+                            static_cast<size_t>(suffix_data_area_length - sizeof(uint8_t) - sizeof(uint16_t))};
+}
+
+// Decodes string i of the block into out and returns its decompressed size.
+inline size_t DecompressBlockString(const uint8_t *block_start, const size_t n_strings, const size_t i,
+const fsst_decoder_t &prefix_decoder, const fsst_decoder_t &suffix_decoder, const uint8_t *block_stop,
+unsigned char *out, const unsigned char *out_end) {
+    const BlockStringEntry entry = FindBlockStringEntry(block_start, n_strings, i, block_stop);
+
+    // Step 1) Decompress prefix
+    const size_t decompressed_prefix_size = entry.prefix_length == 0 ? 0 :
+            DecompressPrefix(prefix_decoder, entry.prefix_length, entry.encoded_prefix_ptr, out, out_end);
+    CheckDecompressedSize(decompressed_prefix_size, out, out_end);
+
+    // Step 2) Decompress suffix
+    const size_t decompressed_suffix_size = fsst_decompress(&suffix_decoder,
+                                                            entry.encoded_suffix_length,
+                                                            entry.encoded_suffix_ptr,
+                                                            out_end - out - decompressed_prefix_size,
+                                                            out + decompressed_prefix_size);
+    return decompressed_prefix_size + decompressed_suffix_size;
+}
+
+/*
+ * Decodes every string of the block back to back into out, in the block's (sorted) order. Each string's pointer and
+ * length are written at its original row: run_ptrs and run_lengths point at the first row of the block's cleaving run.
+ * This is the pure decode path: no verification happens here, see VerifyDecompression() for that.
+ * Advances out past the decoded bytes and returns the number of strings in the block.
+ */
+inline size_t DecompressBlock(const uint8_t *block_start, const fsst_decoder_t &prefix_decoder,
+const fsst_decoder_t &suffix_decoder, const uint8_t *block_stop,
+unsigned char *&out, const unsigned char *out_end,
+const unsigned char **run_ptrs, size_t *run_lengths) {
     const size_t n_strings = Load<uint8_t>(block_start);
-    const uint8_t *suffix_data_area_offsets_ptr = block_start + sizeof(uint8_t);
-
-    constexpr size_t BUFFER_SIZE = 1000000;
-    unsigned char *result = new unsigned char[BUFFER_SIZE];
-
-    for (int i = 0; i < n_strings; i ++ ) {
-        // Clear the result buffer to ensure no remnants from previous strings
-        memset(result, 0, BUFFER_SIZE);
-        
-        const uint8_t *suffix_data_area_offset_ptr = suffix_data_area_offsets_ptr + i * sizeof(uint16_t);
-        const uint16_t suffix_data_area_offset = Load<uint16_t>(suffix_data_area_offset_ptr);
-
-        // Count itself with + sizeof(uint16_t). So the offsetting starts at the value's end.
-        const uint8_t *suffix_data_area_start = suffix_data_area_offset_ptr + sizeof(uint16_t) + suffix_data_area_offset;
-        const uint8_t prefix_length = Load<uint8_t>(suffix_data_area_start);
-
-        uint16_t suffix_data_area_length;
-        if (i < n_strings-1) {
-            // By adding +sizeof(uint16_t) we get the next suffix_data_area_offset
-            const uint16_t next_suffix_offset = Load<uint16_t>(suffix_data_area_offset_ptr + sizeof(uint16_t)); // next suffix offset
-            // diff between this offset and next suffix offset
-            suffix_data_area_length = next_suffix_offset + sizeof(uint16_t) - suffix_data_area_offset;
+    const uint8_t *rows = block_start + sizeof(uint8_t) + n_strings * sizeof(uint16_t);
+
+    const uint8_t *previous_suffix_data_area = nullptr;
+    size_t previous_size = 0;
+    for (size_t i = 0; i < n_strings; i ++ ) {
+        const uint8_t *suffix_data_area = FindSuffixDataArea(block_start, i);
+        size_t decompressed_size;
+        if (suffix_data_area == previous_suffix_data_area) {
+            // Duplicate of the previous string: copy its output instead of decoding the same entry again
+            CheckDecompressedSize(previous_size, out, out_end);
+            memcpy(out, out - previous_size, previous_size);
+            decompressed_size = previous_size;
         } else {
-            // last suffix, have to refer to block_stop to calc its length
-             suffix_data_area_length = block_stop - suffix_data_area_start;
-        }
-
-        if (prefix_length == 0) {
-            const uint8_t *encoded_suffix_ptr = suffix_data_area_start + sizeof(uint8_t);
-            // suffix only
-            const size_t decompressed_suffix_size = fsst_decompress(&suffix_decoder,
-                            suffix_data_area_length - sizeof(uint8_t),
-                            encoded_suffix_ptr, BUFFER_SIZE, result);
-            if (config::print_decompressed_corpus) {
-                std::cout << i << " decompressed: ";
-                std::cout << result << "\n";
+            decompressed_size = DecompressBlockString(block_start, n_strings, i, prefix_decoder, suffix_decoder,
+                                                      block_stop, out, out_end);
+            CheckDecompressedSize(decompressed_size, out, out_end);
+        }
+        previous_suffix_data_area = suffix_data_area;
+        previous_size = decompressed_size;
+        if (config::print_decompressed_corpus) {
+            std::cout << i << " decompressed: ";
+            std::cout.write(reinterpret_cast<const char *>(out), decompressed_size);
+            std::cout << "\n";
+        }
+        // Scatter into original row order. A block holds at most one run, so this stays within 256 entries
+        const uint8_t row = rows[i];
+        run_ptrs[row] = out;
+        run_lengths[row] = decompressed_size;
+        out += decompressed_size;
+    }
+    return n_strings;
+}
+
+inline uint8_t *FindBlockStart(uint8_t *block_start_offsets, const int i) {
+    uint8_t *offset_ptr = block_start_offsets + (i * sizeof(uint32_t));
+    const uint32_t offset = Load<uint32_t>(offset_ptr);
+    uint8_t *block_start =  offset_ptr + offset;
+    return block_start;
+}
+
+/*
+ * Global header layout:
+ *   uint16_t num_blocks
+ *   uint32_t block_start_offsets[num_blocks]      relative to the end of each offset
+ *   uint32_t data_end_offset                      same, the stop of the last block
+ *   uint32_t decompressed_offsets[num_blocks + 1] where each block starts in the decompressed corpus, the last one is its size
+ *   uint32_t block_run_starts[num_blocks]         first row of each block's cleaving run
+ *   uint32_t num_rows
+ *   uint8_t  validity[(num_rows + 7) / 8]         bit per row, 0 for NULL rows, which have no string in any block
+ */
+inline const uint8_t *FindDecompressedOffsets(const uint8_t *global_header) {
+    const uint16_t num_blocks = Load<uint16_t>(global_header);
+    return global_header + sizeof(uint16_t) + (num_blocks + 1) * sizeof(uint32_t);
+}
+
+inline uint32_t LoadDecompressedOffset(const uint8_t *global_header, const size_t i) {
+    return Load<uint32_t>(FindDecompressedOffsets(global_header) + i * sizeof(uint32_t));
+}
+
+inline uint32_t LoadBlockRunStart(const uint8_t *global_header, const size_t i) {
+    const uint16_t num_blocks = Load<uint16_t>(global_header);
+    const uint8_t *block_run_starts = FindDecompressedOffsets(global_header) + (num_blocks + 1) * sizeof(uint32_t);
+    return Load<uint32_t>(block_run_starts + i * sizeof(uint32_t));
+}
+
+inline uint32_t LoadNumRows(const uint8_t *global_header) {
+    const uint16_t num_blocks = Load<uint16_t>(global_header);
+    return Load<uint32_t>(FindDecompressedOffsets(global_header) + (2 * num_blocks + 1) * sizeof(uint32_t));
+}
+
+inline const uint8_t *FindValidity(const uint8_t *global_header) {
+    const uint16_t num_blocks = Load<uint16_t>(global_header);
+    return FindDecompressedOffsets(global_header) + (2 * num_blocks + 2) * sizeof(uint32_t);
+}
+
+inline bool RowIsValid(const uint8_t *validity, const size_t row) {
+    return (validity[row / 8] >> (row % 8)) & 1;
+}
+
+/*
+ * NULL rows get a nullptr and length 0 straight from the validity bitmap, without touching any block.
+ * Bytes with all 8 rows valid, the common case, are skipped with a single compare.
+ */
+inline void EmitNulls(const uint8_t *global_header, std::vector<const unsigned char *> &out_ptrs, std::vector<size_t> &out_lengths) {
+    const size_t num_rows = LoadNumRows(global_header);
+    const uint8_t *validity = FindValidity(global_header);
+    for (size_t byte = 0; byte < (num_rows + 7) / 8; ++byte) {
+        if (validity[byte] == 0xFF) {
+            continue;
+        }
+        const size_t last_row = std::min(byte * 8 + 8, num_rows);
+        for (size_t row = byte * 8; row < last_row; ++row) {
+            if (!RowIsValid(validity, row)) {
+                out_ptrs[row] = nullptr;
+                out_lengths[row] = 0;
             }
-            
-            // Test if it's correct!
-            if (decompressed_suffix_size != lengths_original[metadata.global_index] || !TextMatches(result, string_ptrs_original[metadata.global_index], decompressed_suffix_size)) {
-                std::cerr << "‼️ ERROR: Decompression mismatch (suffix only) i: "<< i <<":\n"<<"result:   " << result << "\noriginal: " << string_ptrs_original[metadata.global_index] << "\n";
-                throw std::runtime_error("Decompression mismatch (suffix only)");
+        }
+    }
+}
+
+// Throws unless out_capacity bytes hold the whole decompressed corpus, decompressed_offsets[num_blocks]
+inline void CheckDecompressionCapacity(const uint8_t *global_header, const size_t out_capacity) {
+    const size_t decompressed_size = LoadDecompressedOffset(global_header, Load<uint16_t>(global_header));
+    if (decompressed_size > out_capacity) {
+        throw std::logic_error("Decompression buffer of " + std::to_string(out_capacity) + " bytes is too small for " +
+                               std::to_string(decompressed_size) + " bytes");
+    }
+}
+
+/*
+ * Decodes the whole corpus into out (strings back to back, in block order) and sets out_ptrs[row] and
+ * out_lengths[row] for every row in its original order, nullptr for NULL rows. Both vectors must have
+ * room for every row, and out_capacity must cover the decompressed corpus. Returns the total number of decoded bytes.
+ */
+inline size_t DecompressAll(uint8_t *global_header, const fsst_decoder_t &prefix_decoder,
+const fsst_decoder_t &suffix_decoder,
+unsigned char *out, const size_t out_capacity,
+std::vector<const unsigned char *> &out_ptrs, std::vector<size_t> &out_lengths
+) {
+    CheckDecompressionCapacity(global_header, out_capacity);
+    unsigned char *out_ptr = out;
+    const unsigned char *out_end = out + out_capacity;
+
+    EmitNulls(global_header, out_ptrs, out_lengths);
+
+    uint16_t num_blocks = Load<uint16_t>(global_header);
+    uint8_t *block_start_offsets = global_header + sizeof(uint16_t);
+    for (int i = 0; i < num_blocks; ++i) {
+        if (config::print_decompressed_corpus) {
+            std::cout << " ------- Block " << i << "\n";
+        }
+        const uint8_t *block_start = FindBlockStart(block_start_offsets, i);
+        /*
+         * Block stop is next block's start. Note that this also works for the last block, so no over-read,
+         * as we save an "extra" data_end_offset, pointing to where the last block stops. This is needed to
+         * calculate the length
+         */
+        const uint8_t *block_stop = FindBlockStart(block_start_offsets, i + 1);
+
+        const size_t run_start = LoadBlockRunStart(global_header, i);
+        DecompressBlock(block_start, prefix_decoder, suffix_decoder, block_stop, out_ptr, out_end,
+                        out_ptrs.data() + run_start, out_lengths.data() + run_start);
+    }
+    return out_ptr - out;
+}
+
+/*
+ * Same output as DecompressAll(), but blocks are decoded by the threads of pool, which outlives the scan so that
+ * starting threads is not part of it. decompressed_offsets[] tells where every block goes, so each block decodes
+ * directly into its final position and threads never share output bytes. Threads grab batches of blocks from a
+ * shared counter, as block costs vary with the strings they hold.
+ */
+inline size_t DecompressAllParallel(uint8_t *global_header, const fsst_decoder_t &prefix_decoder,
+const fsst_decoder_t &suffix_decoder,
+unsigned char *out, const size_t out_capacity,
+std::vector<const unsigned char *> &out_ptrs, std::vector<size_t> &out_lengths, ThreadPool &pool
+) {
+    const uint16_t num_blocks = Load<uint16_t>(global_header);
+    uint8_t *block_start_offsets = global_header + sizeof(uint16_t);
+    CheckDecompressionCapacity(global_header, out_capacity);
+    const size_t decompressed_size = LoadDecompressedOffset(global_header, num_blocks);
+
+    EmitNulls(global_header, out_ptrs, out_lengths);
+
+    constexpr size_t blocks_per_batch = 16;
+    std::atomic<size_t> next_block{0};
+    auto decompress_blocks = [&]() {
+        while (true) {
+            const size_t first_block = next_block.fetch_add(blocks_per_batch);
+            if (first_block >= num_blocks) {
+                return;
+            }
+            const size_t last_block = std::min<size_t>(first_block + blocks_per_batch, num_blocks);
+            for (size_t i = first_block; i < last_block; ++i) {
+                unsigned char *block_out = out + LoadDecompressedOffset(global_header, i);
+                // Bound the output by the next block's start, so no decoder writes into another thread's bytes
+                const unsigned char *block_out_end = out + LoadDecompressedOffset(global_header, i + 1);
+                const size_t run_start = LoadBlockRunStart(global_header, i);
+                DecompressBlock(FindBlockStart(block_start_offsets, i), prefix_decoder, suffix_decoder,
+                                FindBlockStart(block_start_offsets, i + 1), block_out, block_out_end,
+                                out_ptrs.data() + run_start, out_lengths.data() + run_start);
             }
+        }
+    };
+
+    pool.Run(decompress_blocks);
+    return decompressed_size;
+}
+
+// First block at or after block `from` whose cleaving run starts after row, by binary search over block_run_starts[]
+inline size_t FindFirstBlockAfterRow(const uint8_t *global_header, size_t from, const size_t row) {
+    size_t to = Load<uint16_t>(global_header);
+    while (from < to) {
+        const size_t mid = (from + to) / 2;
+        if (LoadBlockRunStart(global_header, mid) <= row) {
+            from = mid + 1;
         } else {
-            const uint8_t *jumpback_offset_ptr = suffix_data_area_start + sizeof(uint8_t);
-            const uint16_t jumpback_offset = Load<uint16_t>(jumpback_offset_ptr);
+            to = mid;
+        }
+    }
+    return from;
+}
 
-            const uint8_t *encoded_suffix_ptr = jumpback_offset_ptr + sizeof(uint16_t);
+/*
+ * Point lookup: decodes only the string at original row `row` into out and sets decompressed_size.
+ * Returns false, without decoding anything, if the row is NULL. The row's blocks are found by binary search over
+ * block_run_starts[], and the row within them with a memchr() over rows[].
+ */
+inline bool DecompressRow(uint8_t *global_header, const fsst_decoder_t &prefix_decoder,
+const fsst_decoder_t &suffix_decoder, const size_t row,
+unsigned char *out, const unsigned char *out_end, size_t &decompressed_size) {
+    if (row >= LoadNumRows(global_header)) {
+        throw std::out_of_range("Row " + std::to_string(row) + " is not in the compressed corpus");
+    }
+    decompressed_size = 0;
+    if (!RowIsValid(FindValidity(global_header), row)) {
+        return false;
+    }
 
-            const uint8_t *encoded_prefix_ptr =
-                    encoded_suffix_ptr - jumpback_offset - sizeof(uint8_t) - sizeof(uint16_t);
+    // A valid row's run has blocks, and its run start is the last one <= row
+    uint8_t *block_start_offsets = global_header + sizeof(uint16_t);
+    const size_t low = FindFirstBlockAfterRow(global_header, 0, row);
+    const size_t run_start = LoadBlockRunStart(global_header, low - 1);
+    const uint8_t row_in_run = row - run_start;
 
+    // Walk back over the run's blocks, a run only spans several blocks when one of them filled up
+    for (size_t block = low; block > 0 && LoadBlockRunStart(global_header, block - 1) == run_start; --block) {
+        const uint8_t *block_start = FindBlockStart(block_start_offsets, block - 1);
+        const size_t n_strings = Load<uint8_t>(block_start);
+        const uint8_t *rows = block_start + sizeof(uint8_t) + n_strings * sizeof(uint16_t);
+        const auto *found = static_cast<const uint8_t *>(memchr(rows, row_in_run, n_strings));
+        if (found != nullptr) {
+            decompressed_size = DecompressBlockString(block_start, n_strings, found - rows, prefix_decoder, suffix_decoder,
+                                                      FindBlockStart(block_start_offsets, block), out, out_end);
+            return true;
+        }
+    }
+    throw std::logic_error("Row " + std::to_string(row) + " is valid but missing from its blocks");
+}
 
-            // Step 1) Decompress prefix
-            const size_t decompressed_prefix_size = fsst_decompress(&prefix_decoder, prefix_length,
-                                                                    encoded_prefix_ptr,
-                                                                    BUFFER_SIZE, result);
+/*
+ * Late materialization: decodes only the strings at the original rows in sorted_rows, which must be ascending
+ * (repeats are fine), and sets out_ptrs[k] and out_lengths[k] for sorted_rows[k], nullptr for NULL rows. The rows
+ * are grouped by cleaving run, and within a run's blocks only the selected suffixes are decoded, each with just the
+ * prefix it references. Returns the number of decoded bytes.
+ */
+inline size_t DecompressSelection(uint8_t *global_header, const fsst_decoder_t &prefix_decoder,
+const fsst_decoder_t &suffix_decoder, const uint32_t *sorted_rows, const size_t count,
+unsigned char *out, const unsigned char *out_end,
+std::vector<const unsigned char *> &out_ptrs, std::vector<size_t> &out_lengths) {
+    const size_t num_rows = LoadNumRows(global_header);
+    const uint16_t num_blocks = Load<uint16_t>(global_header);
+    uint8_t *block_start_offsets = global_header + sizeof(uint16_t);
+    const uint8_t *validity = FindValidity(global_header);
+    unsigned char *out_ptr = out;
 
+    // Selection index of every selected row of the current run, by its row within the run
+    int32_t selected[UINT8_MAX + 1];
+    std::fill(selected, selected + UINT8_MAX + 1, -1);
 
-            // Step 2) Decompress suffix
-            const size_t decompressed_suffix_size = fsst_decompress(&suffix_decoder,
-                                                                    suffix_data_area_length - sizeof(uint8_t) -
-                                                                    sizeof(uint16_t),
-                                                                    encoded_suffix_ptr,
-                                                                    BUFFER_SIZE, result + decompressed_prefix_size);
-            if (config::print_decompressed_corpus) {
-                std::cout << i << " decompressed: ";
-                std::cout << result << "\n";
+    size_t first_block = 0;
+    size_t k = 0;
+    while (k < count) {
+        const size_t row = sorted_rows[k];
+        if (row >= num_rows) {
+            throw std::out_of_range("Row " + std::to_string(row) + " is not in the compressed corpus");
+        }
+        if (k > 0 && row < sorted_rows[k - 1]) {
+            throw std::logic_error("Selected rows are not sorted at index " + std::to_string(k));
+        }
+        if (!RowIsValid(validity, row)) {
+            out_ptrs[k] = nullptr;
+            out_lengths[k] = 0;
+            k++;
+            continue;
+        }
+
+        // The run's blocks, the rows up to the next run's start are either in them or NULL
+        const size_t end_block = FindFirstBlockAfterRow(global_header, first_block, row);
+        const size_t run_start = LoadBlockRunStart(global_header, end_block - 1);
+        first_block = end_block - 1;
+        while (first_block > 0 && LoadBlockRunStart(global_header, first_block - 1) == run_start) {
+            first_block--;
+        }
+        const size_t run_end = end_block < num_blocks ? LoadBlockRunStart(global_header, end_block) : num_rows;
+
+        const size_t k_start = k;
+        size_t n_selected = 0;
+        for (; k < count && sorted_rows[k] < run_end; k++) {
+            if (k > k_start && sorted_rows[k] < sorted_rows[k - 1]) {
+                throw std::logic_error("Selected rows are not sorted at index " + std::to_string(k));
             }
+            if (!RowIsValid(validity, sorted_rows[k])) {
+                out_ptrs[k] = nullptr;
+                out_lengths[k] = 0;
+            } else if (selected[sorted_rows[k] - run_start] < 0) {
+                selected[sorted_rows[k] - run_start] = k;
+                n_selected++;
+            }
+        }
 
-            // Test if it's correct!
-            size_t decompressed_size = decompressed_suffix_size + decompressed_prefix_size;
-            if (decompressed_size != lengths_original[metadata.global_index] || !TextMatches(result, string_ptrs_original[metadata.global_index], decompressed_suffix_size + decompressed_prefix_size)) {
-                std::cerr << "‼️ ERROR: Decompression mismatch:\n"<<"result:   " << result << "\noriginal: " << string_ptrs_original[metadata.global_index] << "\n";
-                throw std::runtime_error("Decompression mismatch");
+        for (size_t block = first_block; block < end_block && n_selected > 0; block++) {
+            const uint8_t *block_start = FindBlockStart(block_start_offsets, block);
+            const size_t n_strings = Load<uint8_t>(block_start);
+            const uint8_t *rows = block_start + sizeof(uint8_t) + n_strings * sizeof(uint16_t);
+            const uint8_t *block_stop = FindBlockStart(block_start_offsets, block + 1);
+            for (size_t i = 0; i < n_strings && n_selected > 0; i++) {
+                const int32_t selection_index = selected[rows[i]];
+                if (selection_index < 0) {
+                    continue;
+                }
+                const size_t decompressed_size = DecompressBlockString(block_start, n_strings, i, prefix_decoder, suffix_decoder,
+                                                                       block_stop, out_ptr, out_end);
+                CheckDecompressedSize(decompressed_size, out_ptr, out_end);
+                out_ptrs[selection_index] = out_ptr;
+                out_lengths[selection_index] = decompressed_size;
+                out_ptr += decompressed_size;
+                n_selected--;
             }
+        }
+        if (n_selected > 0) {
+            throw std::logic_error("Run starting at row " + std::to_string(run_start) + " is missing selected rows");
+        }
 
+        // Repeated rows share the bytes of their first occurrence
+        for (size_t j = k_start; j < k; j++) {
+            if (j > k_start && sorted_rows[j] == sorted_rows[j - 1]) {
+                out_ptrs[j] = out_ptrs[j - 1];
+                out_lengths[j] = out_lengths[j - 1];
+            }
+            if (RowIsValid(validity, sorted_rows[j])) {
+                selected[sorted_rows[j] - run_start] = -1;
+            }
+        }
+        first_block = end_block;
+    }
+    return out_ptr - out;
+}
 
+/*
+ * DuckDB flavour of DecompressSelection(): decodes the count rows that sel picks out of the vector starting at
+ * original row row_offset, sel being ascending as a filter leaves it.
+ */
+inline size_t DecompressSelection(uint8_t *global_header, const fsst_decoder_t &prefix_decoder,
+const fsst_decoder_t &suffix_decoder, const duckdb::SelectionVector &sel, const size_t count, const size_t row_offset,
+unsigned char *out, const unsigned char *out_end,
+std::vector<const unsigned char *> &out_ptrs, std::vector<size_t> &out_lengths) {
+    std::vector<uint32_t> sorted_rows(count);
+    for (size_t k = 0; k < count; k++) {
+        sorted_rows[k] = row_offset + sel.get_index(k);
+    }
+    return DecompressSelection(global_header, prefix_decoder, suffix_decoder, sorted_rows.data(), count,
+                               out, out_end, out_ptrs, out_lengths);
+}
+
+// Separate correctness pass over the output of DecompressAll(), against the input in original row order. Throws on the first mismatch.
+inline void VerifyDecompression(const std::vector<const unsigned char *> &decompressed_ptrs,
+                                const std::vector<size_t> &decompressed_lengths,
+                                const std::vector<size_t> &lengths_original,
+                                const std::vector<const unsigned char *> &string_ptrs_original) {
+    if (decompressed_lengths.size() != lengths_original.size()) {
+        throw std::runtime_error("Decompression mismatch: expected " + std::to_string(lengths_original.size()) +
+                                 " strings, got " + std::to_string(decompressed_lengths.size()));
+    }
+    for (size_t i = 0; i < lengths_original.size(); ++i) {
+        const unsigned char *result = decompressed_ptrs[i];
+        const size_t decompressed_size = decompressed_lengths[i];
+        if (string_ptrs_original[i] == nullptr || result == nullptr) {
+            if (string_ptrs_original[i] != result || decompressed_size != 0) {
+                std::cerr << "‼️ ERROR: NULL mismatch i: " << i << ": expected " << (string_ptrs_original[i] == nullptr ? "NULL" : "a string")
+                          << ", got " << (result == nullptr ? "NULL" : "a string") << "\n";
+                throw std::runtime_error("Decompression mismatch");
+            }
+            continue;
+        }
+        if (decompressed_size != lengths_original[i] || !TextMatches(result, string_ptrs_original[i], decompressed_size)) {
+            std::cerr << "‼️ ERROR: Decompression mismatch i: " << i << ":\n" << "result:   ";
+            std::cerr.write(reinterpret_cast<const char *>(result), decompressed_size);
+            std::cerr << "\noriginal: ";
+            std::cerr.write(reinterpret_cast<const char *>(string_ptrs_original[i]), lengths_original[i]);
+            std::cerr << "\n";
+            throw std::runtime_error("Decompression mismatch");
         }
-        metadata.global_index += 1;
     }
-    
-    // Free the result buffer to avoid memory leak
-    delete[] result;
+    std::cout << "Decompression verified\n";
 }
@@ -0,0 +1,80 @@
+#pragma once
+#include <vector>
+#include "block_decompressor.h"
+#include "string_hash.h"
+
+/*
+ * Hashes of the strings of an FSST+ corpus for hash aggregation and joins, without putting the strings together:
+ * a prefix is decoded and hashed once for all the strings of its similarity chunk, and every string continues from
+ * that hasher state with its own suffix. The hashes are HashString() of the decoded strings, so they can be mixed
+ * with hashes of uncompressed data.
+ */
+constexpr uint64_t null_row_hash = 0xBF58476D1CE4E5B9; // hash of NULL rows, HashAll() gives them this
+
+/*
+ * Hashes every string of the block into run_hashes at its original row, run_hashes pointing at the first row of the
+ * block's cleaving run, like DecompressBlock(). scratch holds one decoded suffix at a time and grows as needed.
+ * Returns the number of strings in the block.
+ */
+inline size_t HashBlock(const uint8_t *block_start, const fsst_decoder_t &prefix_decoder, const fsst_decoder_t &suffix_decoder,
+                        const uint8_t *block_stop, uint64_t *run_hashes, std::vector<unsigned char> &scratch) {
+    constexpr size_t decompression_padding = 32;
+    constexpr size_t max_symbol_length = 8; // an FSST code decodes to at most 8 bytes
+    const size_t n_strings = Load<uint8_t>(block_start);
+    const uint8_t *rows = block_start + sizeof(uint8_t) + n_strings * sizeof(uint16_t);
+
+    unsigned char prefix_out[config::max_prefix_size + decompression_padding];
+    StringHasher prefix_hasher;
+    const uint8_t *hashed_prefix_ptr = nullptr;
+    const uint8_t *previous_suffix_data_area = nullptr;
+    for (size_t i = 0; i < n_strings; i++) {
+        const uint8_t *suffix_data_area = FindSuffixDataArea(block_start, i);
+        if (suffix_data_area == previous_suffix_data_area) {
+            run_hashes[rows[i]] = run_hashes[rows[i - 1]]; // same string as the previous one
+            continue;
+        }
+        previous_suffix_data_area = suffix_data_area;
+
+        const BlockStringEntry entry = FindBlockStringEntry(block_start, n_strings, i, block_stop);
+        if (i == 0 || entry.encoded_prefix_ptr != hashed_prefix_ptr) {
+            prefix_hasher = StringHasher();
+            if (entry.prefix_length != 0) {
+                const size_t prefix_size = DecompressPrefix(prefix_decoder, entry.prefix_length, entry.encoded_prefix_ptr,
+                                                            prefix_out, prefix_out + sizeof(prefix_out));
+                prefix_hasher.Update(prefix_out, prefix_size);
+            }
+            hashed_prefix_ptr = entry.encoded_prefix_ptr;
+        }
+
+        const size_t suffix_capacity = entry.encoded_suffix_length * max_symbol_length + decompression_padding;
+        if (scratch.size() < suffix_capacity) {
+            scratch.resize(suffix_capacity);
+        }
+        const size_t suffix_size = fsst_decompress(&suffix_decoder, entry.encoded_suffix_length, entry.encoded_suffix_ptr,
+                                                   scratch.size(), scratch.data());
+        StringHasher hasher = prefix_hasher;
+        hasher.Update(scratch.data(), suffix_size);
+        run_hashes[rows[i]] = hasher.Finalize();
+    }
+    return n_strings;
+}
+
+// Hashes every row of the corpus into hashes, which must have room for every row, null_row_hash for NULL rows
+inline void HashAll(uint8_t *global_header, const fsst_decoder_t &prefix_decoder, const fsst_decoder_t &suffix_decoder,
+                    std::vector<uint64_t> &hashes) {
+    const size_t num_rows = LoadNumRows(global_header);
+    const uint8_t *validity = FindValidity(global_header);
+    for (size_t row = 0; row < num_rows; row++) {
+        if (!RowIsValid(validity, row)) {
+            hashes[row] = null_row_hash;
+        }
+    }
+
+    const uint16_t num_blocks = Load<uint16_t>(global_header);
+    uint8_t *block_start_offsets = global_header + sizeof(uint16_t);
+    std::vector<unsigned char> scratch;
+    for (size_t i = 0; i < num_blocks; i++) {
+        HashBlock(FindBlockStart(block_start_offsets, i), prefix_decoder, suffix_decoder, FindBlockStart(block_start_offsets, i + 1),
+                  hashes.data() + LoadBlockRunStart(global_header, i), scratch);
+    }
+}
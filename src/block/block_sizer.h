@@ -9,12 +9,16 @@
 inline bool TryAddPrefix(BlockSizingMetadata &sm,
                          BlockWritingMetadata &wm,
                          const FSSTCompressionResult &prefix_compression_result,
+                         const std::vector<SimilarityChunk> &similarity_chunks,
                          const size_t prefix_index) {
-    const size_t prefix_size = prefix_compression_result.encoded_string_lengths[prefix_index];
+    const bool nested = similarity_chunks[prefix_index].nested;
+    const size_t prefix_size = prefix_compression_result.encoded_string_lengths[prefix_index]
+                               + (nested ? nested_prefix_header_size : 0);
     if (sm.block_size + prefix_size >= config::block_byte_capacity) {
         return false;
     }
     wm.prefix_offsets_from_first_prefix[wm.number_of_prefixes] = wm.prefix_area_size;
+    wm.prefix_is_nested[wm.number_of_prefixes] = nested;
     wm.number_of_prefixes += 1;
     wm.prefix_area_size += prefix_size;
     sm.block_size += prefix_size;
@@ -36,9 +40,10 @@ inline size_t CalculateSuffixPlusHeaderSize(const FSSTCompressionResult &suffix_
 
 inline bool CanFitInBlock(const BlockSizingMetadata &bsm,
                           const size_t additional_size) {
-    // We also need space for one uint16_t header offset
+    // We also need space for one uint16_t header offset and one uint8_t row permutation entry
     constexpr size_t block_header_suffix_offset = sizeof(uint16_t);
-    return (bsm.block_size + additional_size + block_header_suffix_offset
+    constexpr size_t block_header_row = sizeof(uint8_t);
+    return (bsm.block_size + additional_size + block_header_suffix_offset + block_header_row
             < config::block_byte_capacity);
 }
 
@@ -51,46 +56,86 @@ inline size_t CalculateBlockSizeAndPopulateWritingMetadata(const std::vector<Sim
                                  const FSSTCompressionResult &suffix_compression_result,
                                  BlockWritingMetadata &wm,
                                  const size_t suffix_area_start_index,
-                                 const size_t block_granularity) {
+                                 const size_t block_granularity,
+                                 const size_t run_end,
+                                 const std::vector<bool> &equals_previous) {
     BlockSizingMetadata sm;
     // Start with the space for num_strings
     sm.block_size += sizeof(uint8_t);
 
-    // Try to fit as many suffixes as possible, up to 128
-    size_t strings_to_go = suffix_compression_result.encoded_string_ptrs.size() - suffix_area_start_index;
+    /*
+     * Try to fit as many suffixes as possible, up to 128. A block never crosses run_end, the end of its cleaving run,
+     * so that its row permutation entries are all relative to the same run (a full block can end mid-run, though).
+     */
+    const size_t strings_to_go = std::min(suffix_compression_result.encoded_string_ptrs.size(), run_end) - suffix_area_start_index;
     while (wm.number_of_suffixes < std::min(strings_to_go, block_granularity)) {
         const size_t suffix_index = suffix_area_start_index + wm.number_of_suffixes; // starts at 0
         const size_t prefix_index =
             FindSimilarityChunkCorrespondingToIndex(suffix_index, similarity_chunks);
+        const bool same_chunk_as_previous = prefix_index == sm.prefix_last_index_added;
 
         // If new prefix is needed, try to add it
         if (prefix_index != sm.prefix_last_index_added) {
-            if (!TryAddPrefix(sm, wm, prefix_compression_result, prefix_index)) {
+            /*
+             * The block's first prefix may be nested in prefixes that ended up in the previous block: bring its
+             * ancestors along, so every parent reference stays within the block.
+             */
+            size_t first_prefix_index = prefix_index;
+            if (wm.prefix_area_start_index == UINT64_MAX) {
+                while (similarity_chunks[first_prefix_index].nested) {
+                    first_prefix_index--;
+                }
+            }
+            bool added = true;
+            for (size_t i = first_prefix_index; i <= prefix_index && added; i++) {
+                added = TryAddPrefix(sm, wm, prefix_compression_result, similarity_chunks, i);
+            }
+            if (!added) {
                 break;
             } else {
                 if (wm.prefix_area_start_index == UINT64_MAX) {
-                    wm.prefix_area_start_index = prefix_index;
+                    wm.prefix_area_start_index = first_prefix_index;
                 }
             }
         }
 
+        /*
+         * A string identical to the one before it in the block only gets its header offset, pointing at the
+         * previous string's entry. The prefix above is still added, prefixes of a block must stay contiguous.
+         * Both have to be in the same similarity chunk: with nested prefixes, identical strings can end up in chunks
+         * of different prefix_length, and the duplicate's suffix was cleaved with its own prefix, which the entry it
+         * would share does not know about.
+         */
+        const bool is_duplicate = wm.number_of_suffixes > 0 && same_chunk_as_previous && equals_previous[suffix_index];
+
         // Calculate suffix size
-        size_t suffix_size = CalculateSuffixPlusHeaderSize(
-            suffix_compression_result, similarity_chunks, suffix_index
-        );
+        size_t suffix_size = is_duplicate
+                                 ? 0
+                                 : CalculateSuffixPlusHeaderSize(suffix_compression_result, similarity_chunks, suffix_index);
         // Check capacity
         if (!CanFitInBlock(sm, suffix_size)) {
             break;
         }
 
-        // We can fit the suffix plus its offset in the block header
+        // We can fit the suffix plus its offset and row in the block header
         constexpr size_t block_header_suffix_offset_size = sizeof(uint16_t);
-        sm.block_size += suffix_size + block_header_suffix_offset_size;
+        constexpr size_t block_header_row_size = sizeof(uint8_t);
+        sm.block_size += suffix_size + block_header_suffix_offset_size + block_header_row_size;
 
         // Update suffix metadata
+        if (is_duplicate) {
+            const size_t previous = wm.number_of_suffixes - 1;
+            wm.suffix_offsets_from_first_suffix[wm.number_of_suffixes] = wm.suffix_offsets_from_first_suffix[previous];
+            wm.suffix_encoded_prefix_lengths[wm.number_of_suffixes] = wm.suffix_encoded_prefix_lengths[previous];
+            wm.suffix_prefix_index[wm.number_of_suffixes] = wm.suffix_prefix_index[previous];
+            wm.suffix_is_duplicate[wm.number_of_suffixes] = true;
+            wm.number_of_suffixes += 1;
+            continue;
+        }
         wm.suffix_offsets_from_first_suffix[wm.number_of_suffixes] = wm.suffix_area_size;
-        wm.suffix_encoded_prefix_lengths[wm.number_of_suffixes] =
-            prefix_compression_result.encoded_string_lengths[prefix_index];
+        wm.suffix_encoded_prefix_lengths[wm.number_of_suffixes] = similarity_chunks[prefix_index].nested
+                                                                      ? nested_prefix_marker
+                                                                      : prefix_compression_result.encoded_string_lengths[prefix_index];
         wm.suffix_prefix_index[wm.number_of_suffixes] = wm.number_of_prefixes - 1; // -1 because we increased it earlier
         wm.suffix_area_size += suffix_size;
         wm.number_of_suffixes += 1;
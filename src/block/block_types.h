@@ -16,20 +16,25 @@ struct BlockWritingMetadata {
     size_t suffix_area_start_index = 0; // global index
 
     std::vector<uint16_t> prefix_offsets_from_first_prefix; // from start of first prefix, how many bytes until we reach prefix i
+    std::vector<bool> prefix_is_nested; // prefix i is stored as an entry referencing prefix i-1 (see SimilarityChunk::nested)
     std::vector<uint16_t> suffix_offsets_from_first_suffix; // same, but for suffix
 
     std::vector<uint8_t> suffix_encoded_prefix_lengths; // the length of the prefix for suffix i
 
     std::vector<uint8_t> suffix_prefix_index; // the index of the prefix for suffix i
 
+    std::vector<bool> suffix_is_duplicate; // suffix i shares the suffix data area entry of suffix i-1, nothing of it is written
+
     size_t prefix_area_size = 0;
     uint16_t suffix_area_size = 0;
     
     explicit BlockWritingMetadata(const size_t block_granularity) :
         prefix_offsets_from_first_prefix(block_granularity),
+        prefix_is_nested(block_granularity),
         suffix_offsets_from_first_suffix(block_granularity),
         suffix_encoded_prefix_lengths(block_granularity),
-        suffix_prefix_index(block_granularity) {}
+        suffix_prefix_index(block_granularity),
+        suffix_is_duplicate(block_granularity) {}
 };
 
 struct BlockSizingMetadata {
@@ -0,0 +1,89 @@
+#pragma once
+#include <algorithm>
+#include <cstring>
+#include "duckdb.hpp"
+#include "block_decompressor.h"
+
+/*
+ * Scan of an FSST+ corpus straight into DuckDB VARCHAR vectors, STANDARD_VECTOR_SIZE rows at a time, in original
+ * row order. Every block is decoded in one go into a single allocation of the result vector's string heap, so a
+ * string_t of more than string_t::INLINE_LENGTH bytes just points at its decoded bytes. Shorter strings are copied
+ * into the string_t itself and never reference the heap, and blocks with no more bytes than that skip the heap.
+ *
+ * A chunk covers whole blocks, except where a cleaving run straddles two chunks (when the block granularity does
+ * not divide STANDARD_VECTOR_SIZE): that run's blocks are decoded again for the next chunk.
+ */
+struct FSSTPlusVectorScanState {
+    uint8_t *global_header;
+    const fsst_decoder_t *prefix_decoder;
+    const fsst_decoder_t *suffix_decoder;
+    size_t next_row = 0;
+    size_t next_block = 0; // first block that may still hold rows >= next_row
+
+    FSSTPlusVectorScanState(uint8_t *global_header, const fsst_decoder_t &prefix_decoder, const fsst_decoder_t &suffix_decoder)
+        : global_header(global_header), prefix_decoder(&prefix_decoder), suffix_decoder(&suffix_decoder) {}
+};
+
+/*
+ * Fills result, a flat VARCHAR vector with all rows valid, with the next STANDARD_VECTOR_SIZE rows (fewer at the end)
+ * and returns how many rows it holds, 0 once the scan is done. NULL rows are marked in result's validity mask.
+ */
+inline size_t FSSTPlusScanVector(FSSTPlusVectorScanState &state, duckdb::Vector &result) {
+    uint8_t *global_header = state.global_header;
+    const size_t num_rows = LoadNumRows(global_header);
+    const size_t first_row = state.next_row;
+    const size_t end_row = std::min<size_t>(first_row + STANDARD_VECTOR_SIZE, num_rows);
+    if (first_row >= end_row) {
+        return 0;
+    }
+    duckdb::string_t *result_data = duckdb::FlatVector::GetData<duckdb::string_t>(result);
+
+    const uint8_t *validity = FindValidity(global_header);
+    for (size_t row = first_row; row < end_row; row++) {
+        if (!RowIsValid(validity, row)) {
+            duckdb::FlatVector::SetNull(result, row - first_row, true);
+        }
+    }
+
+    const uint16_t num_blocks = Load<uint16_t>(global_header);
+    uint8_t *block_start_offsets = global_header + sizeof(uint16_t);
+    constexpr size_t decompression_padding = 32; // lets fsst_decompress() stay on its fast path up to the last string
+    unsigned char small_block[duckdb::string_t::INLINE_LENGTH + decompression_padding];
+    const unsigned char *run_ptrs[UINT8_MAX + 1];
+    size_t run_lengths[UINT8_MAX + 1];
+
+    size_t next_block = num_blocks;
+    size_t block = state.next_block;
+    for (; block < num_blocks && LoadBlockRunStart(global_header, block) < end_row; block++) {
+        const size_t block_size = LoadDecompressedOffset(global_header, block + 1) - LoadDecompressedOffset(global_header, block);
+        unsigned char *block_out = small_block;
+        if (block_size > duckdb::string_t::INLINE_LENGTH) {
+            duckdb::string_t heap_area = duckdb::StringVector::EmptyString(result, block_size + decompression_padding);
+            block_out = reinterpret_cast<unsigned char *>(heap_area.GetDataWriteable());
+        }
+        const unsigned char *block_out_end = block_out + block_size + decompression_padding;
+
+        const uint8_t *block_start = FindBlockStart(block_start_offsets, block);
+        const size_t n_strings = DecompressBlock(block_start, *state.prefix_decoder, *state.suffix_decoder,
+                                                 FindBlockStart(block_start_offsets, block + 1), block_out, block_out_end,
+                                                 run_ptrs, run_lengths);
+
+        const size_t run_start = LoadBlockRunStart(global_header, block);
+        const uint8_t *rows = block_start + sizeof(uint8_t) + n_strings * sizeof(uint16_t);
+        for (size_t k = 0; k < n_strings; k++) {
+            const size_t row = run_start + rows[k];
+            if (row < first_row) {
+                continue; // decoded by the previous chunk already
+            }
+            if (row >= end_row) {
+                next_block = std::min(next_block, block); // the run goes on in the next chunk
+                continue;
+            }
+            result_data[row - first_row] = duckdb::string_t(reinterpret_cast<const char *>(run_ptrs[rows[k]]),
+                                                            static_cast<uint32_t>(run_lengths[rows[k]]));
+        }
+    }
+    state.next_block = std::min(next_block, block);
+    state.next_row = end_row;
+    return end_row - first_row;
+}
@@ -1,21 +1,37 @@
 #pragma once
 #include "duckdb.hpp"
+#include <cassert>
 #include <iostream>
 #include <ranges>
 #include "basic_fsst.h"
 
-inline void WriteBlockHeader(const BlockWritingMetadata &wm, uint8_t *&current_data_ptr) {
+// Plain encoded prefixes must never be mistaken for the nested prefix marker, FSST at most doubles the size
+static_assert(2 * config::max_prefix_size < nested_prefix_marker, "Encoded prefixes must stay below nested_prefix_marker");
+
+// What a reference to prefix i of the block holds in its length byte
+inline uint8_t PrefixReferenceLength(const FSSTCompressionResult &prefix_compression_result, const BlockWritingMetadata &wm,
+                                     const size_t i) {
+    return wm.prefix_is_nested[i] ? nested_prefix_marker
+                                  : prefix_compression_result.encoded_string_lengths[wm.prefix_area_start_index + i];
+}
+
+inline void WriteBlockHeader(const BlockWritingMetadata &wm, const std::vector<uint8_t> &row_permutation, uint8_t *&current_data_ptr) {
     // A 1) Write the number of strings as an uint_8
     Store<uint8_t>(wm.number_of_suffixes, current_data_ptr);
     current_data_ptr += sizeof(uint8_t);
 
     // A 2) Write the suffix_data_area_offsets[]
+    const size_t rows_size = wm.number_of_suffixes * sizeof(uint8_t);
     for (size_t i = 0; i < wm.number_of_suffixes; i++) {
         const uint16_t offset_array_size_to_go = (wm.number_of_suffixes - i) * sizeof(uint16_t) - sizeof(uint16_t); // Count itself with - sizeof(uint16_t). So the offsetting starts at the value's end.
-        uint16_t suffix_data_area_offset = wm.prefix_area_size + offset_array_size_to_go + wm.suffix_offsets_from_first_suffix[i];
+        uint16_t suffix_data_area_offset = offset_array_size_to_go + rows_size + wm.prefix_area_size + wm.suffix_offsets_from_first_suffix[i];
         Store<uint16_t>(suffix_data_area_offset, current_data_ptr);
         current_data_ptr += sizeof(uint16_t);
     }
+
+    // A 3) Write rows[]: the original row of each string, relative to the start of its cleaving run
+    memcpy(current_data_ptr, row_permutation.data() + wm.suffix_area_start_index, rows_size);
+    current_data_ptr += rows_size;
 }
 
 inline void WritePrefixArea(const FSSTCompressionResult &prefix_compression_result, const BlockWritingMetadata &wm,
@@ -31,12 +47,9 @@ inline void WritePrefixArea(const FSSTCompressionResult &prefix_compression_resu
         const size_t prefix_index = prefix_area_start_index + i;
         // std::cout << "prefix_index: " << prefix_index << '\n';
         
-        // Add bounds checking before accessing the vector
-        if (prefix_index >= prefix_compression_result.encoded_string_lengths.size()) {
-            std::cerr << "⛔️ Prefix index out of bounds: " << prefix_index << " >= " << prefix_compression_result.encoded_string_lengths.size() << "\n";
-            throw std::logic_error("Prefix index out of bounds.");
-        }
-        
+        // Sizing only hands out prefixes that exist, fsst_plus_verify checks written corpora (see fsst_plus_verify.h)
+        assert(prefix_index < prefix_compression_result.encoded_string_lengths.size());
+
         const size_t prefix_length = prefix_compression_result.encoded_string_lengths[prefix_index];
 
         // std::cout << "Write Prefix " << i << " Length=" << prefix_length << '\n';
@@ -46,6 +59,15 @@ inline void WritePrefixArea(const FSSTCompressionResult &prefix_compression_resu
         // std::cout << "Current data ptr: " << static_cast<void*>(current_data_ptr) << '\n';  // Cast to void* to print address
         // std::cout << "Will write up to: " << static_cast<void*>(current_data_ptr + prefix_length) << '\n';  
 
+        if (wm.prefix_is_nested[i]) {
+            // The parent is always the prefix right before this one
+            const uint16_t parent_jumpback = wm.prefix_offsets_from_first_prefix[i] - wm.prefix_offsets_from_first_prefix[i - 1];
+            Store<uint8_t>(prefix_length, current_data_ptr);
+            Store<uint8_t>(PrefixReferenceLength(prefix_compression_result, wm, i - 1), current_data_ptr + sizeof(uint8_t));
+            Store<uint16_t>(parent_jumpback, current_data_ptr + 2 * sizeof(uint8_t));
+            current_data_ptr += nested_prefix_header_size;
+        }
+
         memcpy(current_data_ptr, prefix_start, prefix_length);
         current_data_ptr += prefix_length;
     }
@@ -54,14 +76,13 @@ inline void WritePrefixArea(const FSSTCompressionResult &prefix_compression_resu
 inline void WriteSuffixArea(const FSSTCompressionResult &suffix_compression_result, const BlockWritingMetadata &wm,
                               const size_t &suffix_area_start_index, uint8_t *&current_data_ptr) {
     for (size_t i = 0; i < wm.number_of_suffixes; i++) {
-        const size_t suffix_index = suffix_area_start_index + i;
-        
-        // Add bounds check
-        if (suffix_index >= suffix_compression_result.encoded_string_ptrs.size()) {
-            std::cerr << "⚠️ Invalid suffix index: " << suffix_index << "\n";
-            throw std::logic_error("Invalid suffix index. Terminating.");
+        if (wm.suffix_is_duplicate[i]) {
+            continue; // its header offset already points at the previous suffix's entry
         }
+        const size_t suffix_index = suffix_area_start_index + i;
         
+        assert(suffix_index < suffix_compression_result.encoded_string_ptrs.size());
+
         uint8_t prefix_index = wm.suffix_prefix_index[i];
         uint8_t suffix_prefix_length = wm.suffix_encoded_prefix_lengths[i];
         const bool suffix_has_prefix = suffix_prefix_length != 0;
@@ -92,11 +113,12 @@ inline void WriteSuffixArea(const FSSTCompressionResult &suffix_compression_resu
 
 inline uint8_t * WriteBlock(uint8_t *block_start,
                         const FSSTCompressionResult &prefix_compression_result,
-                        const FSSTCompressionResult &suffix_compression_result, const BlockWritingMetadata &wm) {
+                        const FSSTCompressionResult &suffix_compression_result, const BlockWritingMetadata &wm,
+                        const std::vector<uint8_t> &row_permutation) {
 
     uint8_t *current_data_ptr = block_start;
     // A) WRITE THE HEADER
-    WriteBlockHeader(wm, current_data_ptr);
+    WriteBlockHeader(wm, row_permutation, current_data_ptr);
 
     // B) WRITE THE PREFIX AREA
     WritePrefixArea(prefix_compression_result, wm, wm.prefix_area_start_index, current_data_ptr);
@@ -0,0 +1,169 @@
+#pragma once
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "arena.h"
+#include "block_decompressor.h"
+#include "block_types.h"
+#include "cleaving_types.h"
+#include "string_hash.h"
+
+/*
+ * Per-block split-block Bloom filters, so a point lookup only decodes the blocks that may hold its string.
+ * A filter is a number of 256-bit buckets: a key's hash picks one bucket and sets one bit in each of its eight
+ * 32-bit words, so a probe touches a single cache line. Keys are HashString() of the original strings.
+ *
+ * Bloom filter section layout:
+ *   uint16_t num_blocks
+ *   uint32_t bucket_offsets[num_blocks + 1]   first bucket of each block's filter, the last one is the bucket count
+ *   uint32_t buckets[bucket count][8]
+ */
+constexpr size_t bloom_filter_bucket_words = 8;
+constexpr size_t bloom_filter_bucket_size = bloom_filter_bucket_words * sizeof(uint32_t);
+
+inline uint32_t LoadBloomFilterBucketOffset(const uint8_t *bloom_filter_start, const size_t i) {
+    return Load<uint32_t>(bloom_filter_start + sizeof(uint16_t) + i * sizeof(uint32_t));
+}
+
+inline uint8_t *FindBloomFilterBuckets(uint8_t *bloom_filter_start) {
+    const uint16_t num_blocks = Load<uint16_t>(bloom_filter_start);
+    return bloom_filter_start + sizeof(uint16_t) + (num_blocks + 1) * sizeof(uint32_t);
+}
+
+inline const uint8_t *FindBloomFilterBuckets(const uint8_t *bloom_filter_start) {
+    return FindBloomFilterBuckets(const_cast<uint8_t *>(bloom_filter_start));
+}
+
+// The bit of each of the bucket's words that hash sets, from its low 32 bits
+inline uint32_t BloomFilterBucketMask(const uint64_t hash, const size_t word) {
+    static constexpr uint32_t salts[bloom_filter_bucket_words] = {
+        0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU, 0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+    };
+    return 1U << ((static_cast<uint32_t>(hash) * salts[word]) >> 27);
+}
+
+// The bucket hash goes to among n_buckets, from its high 32 bits
+inline size_t BloomFilterBucket(const uint64_t hash, const size_t n_buckets) {
+    return static_cast<size_t>(((hash >> 32) * n_buckets) >> 32);
+}
+
+inline void BloomFilterInsert(uint8_t *buckets, const size_t n_buckets, const uint64_t hash) {
+    uint8_t *bucket = buckets + BloomFilterBucket(hash, n_buckets) * bloom_filter_bucket_size;
+    for (size_t word = 0; word < bloom_filter_bucket_words; word++) {
+        uint8_t *word_ptr = bucket + word * sizeof(uint32_t);
+        Store<uint32_t>(Load<uint32_t>(word_ptr) | BloomFilterBucketMask(hash, word), word_ptr);
+    }
+}
+
+// Whether block i may hold a string with this HashString(), false means it certainly does not
+inline bool BloomFilterMayContain(const uint8_t *bloom_filter_start, const size_t i, const uint64_t hash) {
+    const size_t first_bucket = LoadBloomFilterBucketOffset(bloom_filter_start, i);
+    const size_t n_buckets = LoadBloomFilterBucketOffset(bloom_filter_start, i + 1) - first_bucket;
+    const uint8_t *bucket = FindBloomFilterBuckets(bloom_filter_start) +
+                            (first_bucket + BloomFilterBucket(hash, n_buckets)) * bloom_filter_bucket_size;
+    for (size_t word = 0; word < bloom_filter_bucket_words; word++) {
+        const uint32_t mask = BloomFilterBucketMask(hash, word);
+        if ((Load<uint32_t>(bucket + word * sizeof(uint32_t)) & mask) != mask) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Writes a filter of bits_per_key bits per string (rounded up to whole buckets) for every block described by wms into
+ * the worker's ThreadArena() and returns its start, its end goes to bloom_filter_end. Like WriteZoneMap(), it reads
+ * each original string through its suffix pointer minus its chunk's prefix_length.
+ */
+inline uint8_t *WriteBloomFilters(const std::vector<BlockWritingMetadata> &wms, const std::vector<SimilarityChunk> &similarity_chunks,
+                                  const CleavedResult &cleaved_result, const size_t bits_per_key, uint8_t *&bloom_filter_end) {
+    std::vector<uint32_t> bucket_offsets(1, 0);
+    for (const BlockWritingMetadata &wm : wms) {
+        const size_t n_buckets = std::max<size_t>(1, (wm.number_of_suffixes * bits_per_key + 8 * bloom_filter_bucket_size - 1) /
+                                                     (8 * bloom_filter_bucket_size));
+        bucket_offsets.push_back(bucket_offsets.back() + n_buckets);
+    }
+    const size_t header_size = sizeof(uint16_t) + bucket_offsets.size() * sizeof(uint32_t);
+    const size_t size = header_size + bucket_offsets.back() * bloom_filter_bucket_size;
+    uint8_t *bloom_filter_start = ThreadArena().Allocate(size);
+    Store<uint16_t>(wms.size(), bloom_filter_start);
+    memcpy(bloom_filter_start + sizeof(uint16_t), bucket_offsets.data(), bucket_offsets.size() * sizeof(uint32_t));
+    uint8_t *buckets = bloom_filter_start + header_size;
+    memset(buckets, 0, size - header_size);
+
+    for (size_t i = 0; i < wms.size(); i++) {
+        const BlockWritingMetadata &wm = wms[i];
+        uint8_t *block_buckets = buckets + bucket_offsets[i] * bloom_filter_bucket_size;
+        for (size_t k = 0; k < wm.number_of_suffixes; k++) {
+            const size_t suffix_index = wm.suffix_area_start_index + k;
+            const size_t prefix_length = similarity_chunks[wm.prefix_area_start_index + wm.suffix_prefix_index[k]].prefix_length;
+            BloomFilterInsert(block_buckets, bucket_offsets[i + 1] - bucket_offsets[i],
+                              HashString(cleaved_result.suffixes.string_ptrs[suffix_index] - prefix_length,
+                                         prefix_length + cleaved_result.suffixes.lengths[suffix_index]));
+        }
+    }
+    bloom_filter_end = bloom_filter_start + size;
+    return bloom_filter_start;
+}
+
+/*
+ * Measured false-positive rate of the filters: the share of random hashes, which stand in for strings that are not
+ * in the corpus, that a block's filter lets through. Every block gets probes_per_block probes.
+ */
+inline double BloomFilterFalsePositiveRate(const uint8_t *bloom_filter_start, const size_t probes_per_block, const uint64_t seed = 42) {
+    const uint16_t num_blocks = Load<uint16_t>(bloom_filter_start);
+    if (num_blocks == 0 || probes_per_block == 0) {
+        return 0;
+    }
+    std::mt19937_64 rng(seed);
+    size_t false_positives = 0;
+    for (size_t i = 0; i < num_blocks; i++) {
+        for (size_t probe = 0; probe < probes_per_block; probe++) {
+            false_positives += BloomFilterMayContain(bloom_filter_start, i, rng());
+        }
+    }
+    return static_cast<double>(false_positives) / static_cast<double>(num_blocks * probes_per_block);
+}
+
+/*
+ * Point lookup (WHERE column = value): decodes only the blocks whose filter may contain value, one at a time into out,
+ * which needs room for the largest block, and returns the rows holding value in ascending row order.
+ * Returns the number of decoded blocks.
+ */
+inline size_t BloomFilterLookup(uint8_t *global_header, const uint8_t *bloom_filter_start, const fsst_decoder_t &prefix_decoder,
+                                const fsst_decoder_t &suffix_decoder, const unsigned char *value, const size_t length,
+                                unsigned char *out, const unsigned char *out_end, std::vector<uint32_t> &matching_rows) {
+    const uint16_t num_blocks = Load<uint16_t>(global_header);
+    if (Load<uint16_t>(bloom_filter_start) != num_blocks) {
+        throw std::logic_error("Bloom filters cover " + std::to_string(Load<uint16_t>(bloom_filter_start)) + " blocks, the corpus has " +
+                               std::to_string(num_blocks));
+    }
+    uint8_t *block_start_offsets = global_header + sizeof(uint16_t);
+    const unsigned char *run_ptrs[UINT8_MAX + 1];
+    size_t run_lengths[UINT8_MAX + 1];
+
+    const uint64_t hash = HashString(value, length);
+    matching_rows.clear();
+    size_t decoded_blocks = 0;
+    for (size_t i = 0; i < num_blocks; i++) {
+        if (!BloomFilterMayContain(bloom_filter_start, i, hash)) {
+            continue;
+        }
+        unsigned char *block_out = out;
+        const uint8_t *block_start = FindBlockStart(block_start_offsets, i);
+        const size_t n_strings = DecompressBlock(block_start, prefix_decoder, suffix_decoder, FindBlockStart(block_start_offsets, i + 1),
+                                                 block_out, out_end, run_ptrs, run_lengths);
+        decoded_blocks++;
+        const size_t run_start = LoadBlockRunStart(global_header, i);
+        const uint8_t *rows = block_start + sizeof(uint8_t) + n_strings * sizeof(uint16_t);
+        for (size_t k = 0; k < n_strings; k++) {
+            const uint8_t row = rows[k];
+            if (run_lengths[row] == length && memcmp(run_ptrs[row], value, length) == 0) {
+                matching_rows.push_back(run_start + row);
+            }
+        }
+    }
+    // A run's strings are spread over its blocks in sorted order
+    std::sort(matching_rows.begin(), matching_rows.end());
+    return decoded_blocks;
+}
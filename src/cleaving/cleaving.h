@@ -6,11 +6,41 @@
 #include "print_utils.h"
 #include "../config.h" // Not needed but prevents ClionIDE from complaining
 #include <algorithm>
+#include <cstring>
 #include <limits>
+#include <stdexcept>
+#include "perf_counters.h"
 
-// Sort all strings based on their starting characters truncated to the largest multiple of 8 bytes (up to config::max_prefix_size bytes)
+/*
+ * Sort order of the cleaving runs: by the strings' starting characters truncated to the largest multiple of 8 bytes
+ * (up to config::max_prefix_size bytes), ties broken on the rest of the strings so identical strings end up adjacent
+ */
+inline bool TruncatedLess(const size_t len_a, const unsigned char *str_a, const size_t len_b, const unsigned char *str_b) {
+    // Calculate truncated lengths as largest multiple of 8 <= min(config::max_prefix_size, original length)
+    const size_t truncated_a = std::min(len_a, config::max_prefix_size) & ~7;
+    const size_t truncated_b = std::min(len_b, config::max_prefix_size) & ~7;
+
+    // Compare truncated strings
+    const int cmp = memcmp(str_a, str_b, std::min(truncated_a, truncated_b));
+    if (cmp != 0 || truncated_a != truncated_b) {
+        return cmp < 0 || (cmp == 0 && truncated_a < truncated_b);
+    }
+    // Same truncated key: order by the rest of the strings
+    const int rest_cmp = memcmp(str_a + truncated_a, str_b + truncated_b, std::min(len_a, len_b) - truncated_a);
+    return rest_cmp < 0 || (rest_cmp == 0 && len_a < len_b);
+}
+
+/*
+ * Sort the strings of one cleaving run by TruncatedLess().
+ * row_permutation[start_index..] holds each string's row within its run and is reordered along with the strings.
+ */
 inline void TruncatedSort(std::vector<size_t> &lenIn, std::vector<const unsigned char *> &strIn,
+                           std::vector<uint8_t> &row_permutation,
                            const size_t start_index, const size_t cleaving_run_n) {
+    if (cleaving_run_n > UINT8_MAX + 1) {
+        throw std::logic_error("Cleaving runs longer than 256 strings do not fit the uint8_t row permutation");
+    }
+
     // Create index array
     std::vector<size_t> indices(cleaving_run_n);
     for (size_t i = start_index; i < start_index + cleaving_run_n; ++i) {
@@ -19,23 +49,20 @@ inline void TruncatedSort(std::vector<size_t> &lenIn, std::vector<const unsigned
 
     // Sort indices based on truncated string comparison
     std::sort(indices.begin(), indices.end(), [&](size_t i, size_t j) {
-        // Calculate truncated lengths as largest multiple of 8 <= min(config::max_prefix_size, original length)
-        const size_t len_i = std::min(lenIn[i], config::max_prefix_size) & ~7;
-        const size_t len_j = std::min(lenIn[j], config::max_prefix_size) & ~7;
-
-        // Compare truncated strings
-        const int cmp = memcmp(strIn[i], strIn[j], std::min(len_i, len_j));
-        return cmp < 0 || (cmp == 0 && len_i < len_j);
+        return TruncatedLess(lenIn[i], strIn[i], lenIn[j], strIn[j]);
     });
 
 
     // Reorder both vectors based on sorted indices
     const std::vector<size_t> tmp_len(lenIn);
     const std::vector<const unsigned char *> tmp_str(strIn);
+    const std::vector<uint8_t> tmp_rows(row_permutation.begin() + start_index,
+                                        row_permutation.begin() + start_index + cleaving_run_n);
 
     for (size_t k = 0; k < cleaving_run_n; ++k) {
         lenIn[start_index + k] = tmp_len[indices[k]];
         strIn[start_index + k] = tmp_str[indices[k]];
+        row_permutation[start_index + k] = tmp_rows[indices[k] - start_index];
     }
 
     // Print strings
@@ -85,6 +112,7 @@ inline std::vector<SimilarityChunk> FormSimilarityChunks(
     std::vector<size_t> dp(size + 1, INF);
     std::vector<size_t> prev(size + 1, 0);
     std::vector<size_t> p_for_i(size + 1, 0);
+    std::vector<bool> nested_for_i(size + 1, false);
 
     dp[0] = 0;
 
@@ -92,19 +120,26 @@ inline std::vector<SimilarityChunk> FormSimilarityChunks(
     for (size_t i = 1; i <= size; ++i) {
         for (size_t j = 0; j < i; ++j) {
             const size_t min_common_prefix = min_lcp[j][i - 1]; // can be max 128 a.k.a. config::max_prefix_size
+            // The best partitioning up to j ends in a chunk with prefix q. If q is also a prefix of string j, a longer
+            // prefix of this range can be stored as q plus the rest, paying the parent reference instead of q's bytes.
+            const size_t q = j > 0 ? p_for_i[j] : 0;
+            const bool can_nest = config::hierarchical_prefixes && q > 0 && q <= lcp[j - 1];
             size_t p = 0;
             while (p <= min_common_prefix) {
                 const size_t n = i - j;
                 const size_t per_string_overhead = 1 + (p > 0 ? 2 : 0); // 1 because u will always exist, 2 for pointer
                 const size_t overhead = n * per_string_overhead;
                 const size_t sum_len = length_prefix_sum[i] - length_prefix_sum[j];
-                const size_t total_cost = dp[j] + overhead + sum_len - (n - 1) * p;
-                // (n - 1) * p is the compression gain. n are strings in current range, p is the common prefix length in this range
+                const bool nested = can_nest && p > q && q > nested_prefix_header_size;
+                const size_t prefix_entry_size = nested ? nested_prefix_header_size + p - q : p;
+                const size_t total_cost = dp[j] + overhead + sum_len - n * p + prefix_entry_size;
+                // n * p is taken out of every string in current range, the prefix is then stored once
 
                 if (total_cost < dp[i]) {
                     dp[i] = total_cost;
                     prev[i] = j;
                     p_for_i[i] = p;
+                    nested_for_i[i] = nested;
                 }
                 if (p < min_common_prefix and p + 8 > min_common_prefix) {
                     p = min_common_prefix;
@@ -124,6 +159,7 @@ inline std::vector<SimilarityChunk> FormSimilarityChunks(
         SimilarityChunk chunk;
         chunk.start_index = start_index + start_idx;
         chunk.prefix_length = prefix_length;
+        chunk.nested = nested_for_i[idx];
         chunks.push_back(chunk);
         idx = start_idx;
     }
@@ -151,9 +187,10 @@ inline CleavedResult Cleave(const std::vector<size_t> &lenIn,
                                       ? lenIn.size()
                                       : similarity_chunks[i + 1].start_index;
 
-        // Prefix
-        pl->push_back(chunk.prefix_length);
-        ps->push_back(strIn[chunk.start_index]);
+        // Prefix, a nested one only keeps what comes after its parent's prefix
+        const size_t parent_prefix_length = chunk.nested ? similarity_chunks[i - 1].prefix_length : 0;
+        pl->push_back(chunk.prefix_length - parent_prefix_length);
+        ps->push_back(strIn[chunk.start_index] + parent_prefix_length);
 
         for (size_t j = chunk.start_index; j < stop_index; j++) {
             // Suffix
@@ -166,4 +203,66 @@ inline CleavedResult Cleave(const std::vector<size_t> &lenIn,
     }
 
     return cleaved_result;
-}
\ No newline at end of file
+}
+
+/*
+ * Takes the NULLs out of every cleaving run of block_granularity rows, then sorts the run's strings in place and forms
+ * their similarity chunks. Afterwards input only holds the non-NULL strings, run after run; runs describes where
+ * each run's strings went, their original rows and which rows were NULL.
+ */
+inline std::vector<SimilarityChunk> FormBlockwiseSimilarityChunks(const size_t &n, StringCollection &input, const size_t &block_granularity,
+                                                                  CleavingRuns &runs, StageMeasurements &stages) {
+    std::vector<SimilarityChunk> similarity_chunks;
+    similarity_chunks.reserve(n);
+    runs.block_granularity = block_granularity;
+    runs.num_rows = n;
+    runs.first_strings.clear();
+    runs.row_permutation.resize(n);
+    runs.equals_previous.assign(n, false);
+    runs.validity.assign((n + 7) / 8, 0);
+
+    size_t n_strings = 0; // non-NULL strings so far, compacted to the front of input
+    for (size_t i = 0; i < n; i += block_granularity) {
+        const size_t run_rows = std::min(n - i, block_granularity);
+        const size_t run_first_string = n_strings;
+        runs.first_strings.push_back(run_first_string);
+        for (size_t row = i; row < i + run_rows; ++row) {
+            if (input.string_ptrs[row] == nullptr) {
+                continue;
+            }
+            runs.validity[row / 8] |= 1 << (row % 8);
+            input.lengths[n_strings] = input.lengths[row];
+            input.string_ptrs[n_strings] = input.string_ptrs[row];
+            runs.row_permutation[n_strings] = row - i;
+            n_strings++;
+        }
+        const size_t cleaving_run_n = n_strings - run_first_string;
+        if (cleaving_run_n == 0) {
+            continue; // all NULL, the run only exists in the validity bitmap
+        }
+
+        // std::cout << "Current Cleaving Run coverage: " << run_first_string << ":" << n_strings - 1 << std::endl;
+
+        const StageProbe sort_probe;
+        TruncatedSort(input.lengths, input.string_ptrs, runs.row_permutation, run_first_string, cleaving_run_n);
+        for (size_t k = run_first_string + 1; k < n_strings; ++k) {
+            runs.equals_previous[k] = input.lengths[k] == input.lengths[k - 1] &&
+                                      memcmp(input.string_ptrs[k], input.string_ptrs[k - 1], input.lengths[k]) == 0;
+        }
+        sort_probe.Stop(stages.sort);
+
+        const StageProbe chunking_probe;
+        const std::vector<SimilarityChunk> cleaving_run_similarity_chunks = FormSimilarityChunks(
+            input.lengths, input.string_ptrs, run_first_string, cleaving_run_n);
+        chunking_probe.Stop(stages.chunking);
+        similarity_chunks.insert(similarity_chunks.end(),
+                                 cleaving_run_similarity_chunks.begin(),
+                                 cleaving_run_similarity_chunks.end());
+    }
+    runs.first_strings.push_back(n_strings);
+    input.lengths.resize(n_strings);
+    input.string_ptrs.resize(n_strings);
+    runs.row_permutation.resize(n_strings);
+    runs.equals_previous.resize(n_strings);
+    return similarity_chunks;
+}
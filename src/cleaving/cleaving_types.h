@@ -1,32 +1,62 @@
 #pragma once
 #include <vector>
 #include <cstddef> // for size_t
+#include <cstdint>
 #include <string>
 
 struct SimilarityChunk {
     size_t start_index; // Starts here and goes on until next chunk's index, or until the end of the 128 block
     size_t prefix_length;
+    bool nested; // the prefix extends the previous chunk's prefix, only the bytes after the parent's prefix_length are stored
 };
 
-// Common base struct for Prefixes and Suffixes
+/*
+ * A nested prefix is stored in the prefix area as a small entry that references its parent prefix:
+ *   uint8_t  own_encoded_length
+ *   uint8_t  parent_encoded_length   or nested_prefix_marker if the parent is nested itself
+ *   uint16_t parent_jumpback         from the start of this entry back to the parent's
+ *   encoded bytes after the parent's prefix
+ * References to a prefix (in suffix entries and nested entries) hold nested_prefix_marker instead of an encoded length
+ * when the prefix is nested. Flat prefixes stay plain encoded bytes, at most 2 * config::max_prefix_size long.
+ */
+constexpr uint8_t nested_prefix_marker = UINT8_MAX;
+constexpr size_t nested_prefix_header_size = sizeof(uint8_t) + sizeof(uint8_t) + sizeof(uint16_t);
+
+// Common base struct for Prefixes and Suffixes. A NULL row has a nullptr string_ptr and length 0.
 struct StringCollection {
     std::vector<size_t> lengths;
     std::vector<const unsigned char *> string_ptrs;
     std::vector<std::string> data;  // retains the actual string bytes
 
-    explicit StringCollection(const size_t n) {
+    // Collections that only point into another collection's strings (e.g. prefixes/suffixes) don't own data
+    explicit StringCollection(const size_t n, const bool owns_data = true) {
         lengths.reserve(n);
         string_ptrs.reserve(n);
-        data.reserve(n);
+        if (owns_data) {
+            data.reserve(n);
+        }
     }
 };
 
 struct Prefixes : StringCollection {
-    explicit Prefixes(const size_t n) : StringCollection(n) {}
+    explicit Prefixes(const size_t n) : StringCollection(n, false) {}
 };
 
 struct Suffixes : StringCollection {
-    explicit Suffixes(const size_t n) : StringCollection(n) {}
+    explicit Suffixes(const size_t n) : StringCollection(n, false) {}
+};
+
+/*
+ * Cleaving runs are block_granularity consecutive rows. NULL rows are taken out of the string stream, only the validity
+ * bitmap remembers them; the non-NULL strings of each run are sorted and stored back to back.
+ */
+struct CleavingRuns {
+    size_t block_granularity = 0;
+    size_t num_rows = 0;
+    std::vector<size_t> first_strings; // index of each run's first non-NULL string, the last entry is the number of non-NULL strings
+    std::vector<uint8_t> row_permutation; // per non-NULL string, its row within its run
+    std::vector<bool> equals_previous; // per non-NULL string, whether it is identical to the string sorted right before it in its run
+    std::vector<uint8_t> validity; // one bit per row, set if the row is not NULL
 };
 
 struct CleavedResult {
@@ -11,6 +11,25 @@ namespace config {
     extern const bool print_decompressed_corpus;
 
     constexpr size_t max_prefix_size = 120; // how far into the string to scan for a prefix. (max prefix size)
+    constexpr size_t zone_map_key_size = 8; // bytes of each block's min and max string kept in the zone map (see zone_map.h)
+    constexpr size_t bloom_filter_bits_per_key = 10; // per-block Bloom filter size (see bloom_filter.h), ~1% false positives at 10, 0 disables them
+    constexpr size_t bloom_filter_fpr_probes_per_block = 256; // random probes per block to measure the reported false-positive rate
+    constexpr double append_retrain_ratio = 0.8; // retrain on append once new blocks compress worse than this times the old ones (see fsst_plus_append.h)
+    constexpr bool hierarchical_prefixes = true; // let a chunk's prefix extend the previous chunk's prefix (see FormSimilarityChunks())
     constexpr size_t amount_strings_per_symbol_table = 120000; // 120000 = a duckdb row group
+    constexpr bool verify_decompression = true; // run the (untimed) correctness pass after the decompression benchmark
+    constexpr size_t decompression_benchmark_repetitions = 5; // decode-only scans per column, the fastest one is reported
+    constexpr size_t decompression_threads = 1; // > 1 decodes blocks in parallel with DecompressAllParallel()
+    constexpr size_t segment_benchmark_lookups_per_thread = 1000000; // random row lookups per reader thread in segment_scaling_benchmark
+    constexpr size_t segment_benchmark_scans_per_thread = 5; // full scans per reader thread in segment_scaling_benchmark
+    constexpr const char *duckdb_codecs[] = {"fsst", "dictionary", "zstd"}; // DuckDB baselines forced per column (see duckdb_codecs.h), unsupported ones are skipped
+    constexpr size_t query_benchmark_runs = 100; // timed runs per query and engine in query_benchmark, each filter run with its own parameter
+    constexpr size_t query_benchmark_infix_length = 4; // bytes of the LIKE '%infix%' patterns
+    constexpr uint64_t query_benchmark_seed = 42; // rows the query parameters are drawn from
+    constexpr size_t synthetic_stem_window = 1024; // rows that draw from the same stems of a synthetic column (see synthetic_corpus.h)
+    constexpr size_t synthetic_duplicate_window = 1024; // recent values a synthetic duplicate is drawn from (see synthetic_corpus.h)
+    constexpr size_t results_batch_size = 64; // result rows a worker buffers before appending them to the results table
+    constexpr bool arena_use_huge_pages = true; // madvise(MADV_HUGEPAGE) the per-worker arena (see arena.h)
+    constexpr bool collect_perf_counters = true; // per-stage hardware counters via perf_event_open, if the kernel allows it
     size_t global_index = 0;
 }
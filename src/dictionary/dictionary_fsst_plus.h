@@ -0,0 +1,152 @@
+#pragma once
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include "../fsst_plus.h"
+#include "bitpacking.h"
+#include "block_decompressor.h"
+#include "cleaving.h"
+
+/*
+ * Hybrid dictionary + FSST+ codec for low-cardinality columns. Every distinct string is stored once, in an FSST+
+ * corpus of the sorted dictionary (sorting puts shared prefixes next to each other, which is what FSST+ feeds on),
+ * and every row only stores the bit-packed code of its dictionary entry.
+ *
+ * Codes section layout:
+ *   uint32_t num_rows
+ *   uint32_t num_entries   dictionary entries, a NULL entry comes first if the column has NULLs
+ *   uint8_t  code_width    bits per code, see bitpacking.h
+ *   codes[]                one code per row, followed by bitpacking_padding bytes
+ */
+struct DictionaryFSSTPlusCompressionResult {
+    FSSTPlusCompressionResult dictionary; // FSST+ corpus with one row per dictionary entry
+    uint8_t *codes_start; // owned by the worker's ThreadArena(), valid until its next Reset()
+    uint8_t *codes_end; // end of the packed codes, the padding is not counted
+};
+
+constexpr size_t dictionary_codes_header_size = sizeof(uint32_t) + sizeof(uint32_t) + sizeof(uint8_t);
+
+inline uint32_t LoadDictionaryNumRows(const uint8_t *codes_start) {
+    return Load<uint32_t>(codes_start);
+}
+
+inline uint32_t LoadDictionaryNumEntries(const uint8_t *codes_start) {
+    return Load<uint32_t>(codes_start + sizeof(uint32_t));
+}
+
+inline uint8_t LoadDictionaryCodeWidth(const uint8_t *codes_start) {
+    return Load<uint8_t>(codes_start + 2 * sizeof(uint32_t));
+}
+
+inline const uint8_t *FindDictionaryCodes(const uint8_t *codes_start) {
+    return codes_start + dictionary_codes_header_size;
+}
+
+// Orders strings by their bytes, a shorter string before the longer strings it is a prefix of
+inline bool StringLess(const unsigned char *a, const size_t a_length, const unsigned char *b, const size_t b_length) {
+    const int cmp = memcmp(a, b, std::min(a_length, b_length));
+    return cmp < 0 || (cmp == 0 && a_length < b_length);
+}
+
+/*
+ * Builds the sorted distinct dictionary of input, compresses it with FSST+ and packs one code per row.
+ * input is left untouched: the dictionary only points into its strings.
+ */
+inline DictionaryFSSTPlusCompressionResult DictionaryFSSTPlusCompress(const size_t n, const StringCollection &input,
+                                                                      const size_t &block_granularity,
+                                                                      StageMeasurements &stages, MemoryFootprint &memory) {
+    if (n > UINT32_MAX) {
+        throw std::logic_error("Dictionary FSST+ row count exceeds the uint32 range of num_rows");
+    }
+
+    // Sort the non-NULL rows by their string, equal strings end up next to each other
+    const StageProbe sort_probe;
+    std::vector<uint32_t> sorted_rows;
+    sorted_rows.reserve(n);
+    bool has_nulls = false;
+    for (size_t row = 0; row < n; row++) {
+        if (input.string_ptrs[row] == nullptr) {
+            has_nulls = true;
+        } else {
+            sorted_rows.push_back(row);
+        }
+    }
+    std::sort(sorted_rows.begin(), sorted_rows.end(), [&input](const uint32_t a, const uint32_t b) {
+        return StringLess(input.string_ptrs[a], input.lengths[a], input.string_ptrs[b], input.lengths[b]);
+    });
+
+    // Assign codes in sorted order, NULL rows share code 0
+    StringCollection dictionary(sorted_rows.size() + 1, false);
+    std::vector<uint32_t> codes(n, 0);
+    if (has_nulls) {
+        dictionary.lengths.push_back(0);
+        dictionary.string_ptrs.push_back(nullptr);
+    }
+    for (size_t k = 0; k < sorted_rows.size(); k++) {
+        const uint32_t row = sorted_rows[k];
+        const bool is_new_entry = k == 0 || StringLess(input.string_ptrs[sorted_rows[k - 1]], input.lengths[sorted_rows[k - 1]],
+                                                       input.string_ptrs[row], input.lengths[row]);
+        if (is_new_entry) {
+            dictionary.lengths.push_back(input.lengths[row]);
+            dictionary.string_ptrs.push_back(input.string_ptrs[row]);
+        }
+        codes[row] = dictionary.lengths.size() - 1;
+    }
+    sort_probe.Stop(stages.sort);
+    const size_t n_entries = dictionary.lengths.size();
+
+    // FSST+ over the dictionary, exactly as for a regular column
+    DictionaryFSSTPlusCompressionResult compression_result{};
+    CleavingRuns runs;
+    const std::vector<SimilarityChunk> similarity_chunks = FormBlockwiseSimilarityChunks(n_entries, dictionary, block_granularity, runs, stages);
+    const size_t n_strings = runs.first_strings.back();
+    const StageProbe cleave_probe;
+    CleavedResult cleaved_result = Cleave(dictionary.lengths, dictionary.string_ptrs, similarity_chunks, n_strings);
+    cleave_probe.Stop(stages.cleave);
+    memory.cleaved_bytes = CalcCleavedResultBytes(cleaved_result);
+    compression_result.dictionary = FSSTPlusCompress(n_strings, similarity_chunks, cleaved_result, runs, block_granularity, stages, memory);
+
+    // Codes section
+    const StageProbe writing_probe;
+    const uint8_t code_width = CalcBitWidth(n_entries);
+    const size_t codes_size = dictionary_codes_header_size + CalcBitPackedSize(n, code_width);
+    compression_result.codes_start = ThreadArena().Allocate(codes_size + bitpacking_padding);
+    Store<uint32_t>(n, compression_result.codes_start);
+    Store<uint32_t>(n_entries, compression_result.codes_start + sizeof(uint32_t));
+    Store<uint8_t>(code_width, compression_result.codes_start + 2 * sizeof(uint32_t));
+    BitPack(codes, code_width, compression_result.codes_start + dictionary_codes_header_size);
+    compression_result.codes_end = compression_result.codes_start + codes_size;
+    writing_probe.Stop(stages.writing);
+    memory.fsst_plus_buffer_bytes += codes_size + bitpacking_padding;
+
+    return compression_result;
+}
+
+/*
+ * Decodes every dictionary entry once into out, then points out_ptrs[row] and out_lengths[row] of every row at its
+ * entry, nullptr for NULL rows. Rows with the same string share the same bytes. out must have room for the
+ * decompressed dictionary, LoadDecompressedOffset(dictionary_global_header, num_blocks).
+ * Returns the number of decoded dictionary bytes.
+ */
+inline size_t DictionaryFSSTPlusDecompressAll(uint8_t *dictionary_global_header, const uint8_t *codes_start,
+                                              const fsst_decoder_t &prefix_decoder, const fsst_decoder_t &suffix_decoder,
+                                              unsigned char *out, const size_t out_capacity,
+                                              std::vector<const unsigned char *> &out_ptrs, std::vector<size_t> &out_lengths) {
+    const size_t num_rows = LoadDictionaryNumRows(codes_start);
+    const size_t num_entries = LoadDictionaryNumEntries(codes_start);
+    const uint8_t code_width = LoadDictionaryCodeWidth(codes_start);
+    const uint8_t *codes = FindDictionaryCodes(codes_start);
+
+    std::vector<const unsigned char *> entry_ptrs(num_entries);
+    std::vector<size_t> entry_lengths(num_entries);
+    const size_t decompressed_bytes = DecompressAll(dictionary_global_header, prefix_decoder, suffix_decoder,
+                                                    out, out_capacity, entry_ptrs, entry_lengths);
+
+    for (size_t row = 0; row < num_rows; row++) {
+        const uint32_t code = BitUnpack(codes, row, code_width);
+        out_ptrs[row] = entry_ptrs[code];
+        out_lengths[row] = entry_lengths[code];
+    }
+    return decompressed_bytes;
+}
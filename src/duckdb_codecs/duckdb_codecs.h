@@ -0,0 +1,259 @@
+#pragma once
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "duckdb.hpp"
+#include "../config.h"
+#include "../env.h"
+#include "../global.h"
+#include "cleaving_types.h"
+#include "results_table.h"
+
+/*
+ * Baselines from DuckDB's own storage: the column is written into a table of a fresh on-disk database with
+ * force_compression set to one codec, checkpointed, and measured from pragma_storage_info. Each codec gets a database
+ * instance of its own, so force_compression never leaks into the benchmark database or other workers.
+ *
+ * pragma_storage_info has no segment sizes, only where each segment starts (block_id, block_offset). Segments are
+ * written back to back into blocks, so a segment takes the bytes up to the next segment of its block. The last
+ * segment of a block takes the rest of it if the column continues in a later segment, as DuckDB only starts a new
+ * segment once the current one is full. Otherwise it is the column's final segment of its row group, and the rest of
+ * the block holds that segment plus space DuckDB leaves free, which its partial block manager hands to other segments.
+ * Such a segment is charged its rows at the bytes per row of the segments of the same column path whose size is known,
+ * and the rest of the block, or all of it when no such segment exists, is reported apart as slack_bytes.
+ * Blocks holding long strings (additional_block_ids) count in full. The column's validity segments are included, as
+ * FSST+ also stores its validity bitmap.
+ */
+struct DuckDBCodecMeasurement {
+    std::string compression; // lowercase name of what DuckDB applied, may differ from the forced codec if it could not be used
+    size_t segments = 0;
+    size_t storage_bytes = 0; // including slack_bytes, what the column takes in a database of its own
+    size_t slack_bytes = 0; // free block space after final segments, see above. Not attributable to the column
+    double load_time_ms = 0; // appending the rows and the checkpoint that compresses them
+    double best_scan_time_ms = 0;
+};
+
+inline std::string DuckDBCodecDatabasePath(const std::string &codec) {
+    const size_t worker = std::hash<std::thread::id>()(std::this_thread::get_id());
+    return env::scratch_dir + "/fsst_plus_codec_" + std::to_string(worker) + "_" + codec + ".duckdb";
+}
+
+inline void RemoveDuckDBCodecDatabase(const std::string &path) {
+    std::remove(path.c_str());
+    std::remove((path + ".wal").c_str());
+}
+
+// Fills in compression, segments, storage_bytes and slack_bytes of table t's persistent segments, see above
+inline void CalcStorageBytes(duckdb::Connection &con, DuckDBCodecMeasurement &measurement) {
+    const auto database_size = con.Query("PRAGMA database_size");
+    if (database_size->HasError()) {
+        throw std::logic_error("PRAGMA database_size failed: " + database_size->GetError());
+    }
+    const size_t block_size = database_size->GetValue(2, 0).GetValue<int64_t>();
+
+    // Overflow blocks of long strings are only listed by newer DuckDB versions
+    const std::string columns = "block_id, block_offset, compression, segment_type, "
+                                "start = max(start) OVER (PARTITION BY row_group_id, column_path) AS final_segment, count, column_path";
+    auto storage_info = con.Query("SELECT " + columns + ", len(additional_block_ids) FROM pragma_storage_info('t') WHERE persistent");
+    const bool has_additional_blocks = !storage_info->HasError();
+    if (!has_additional_blocks) {
+        storage_info = con.Query("SELECT " + columns + " FROM pragma_storage_info('t') WHERE persistent");
+    }
+    if (storage_info->HasError()) {
+        throw std::logic_error("pragma_storage_info failed: " + storage_info->GetError());
+    }
+
+    struct SegmentStart {
+        int64_t block_id;
+        size_t block_offset;
+        bool final_segment;
+        size_t rows;
+        std::string column_path;
+        bool operator<(const SegmentStart &other) const {
+            return block_id != other.block_id ? block_id < other.block_id : block_offset < other.block_offset;
+        }
+    };
+    std::vector<SegmentStart> segment_starts;
+    size_t additional_blocks = 0;
+    measurement.segments = 0;
+    measurement.compression.clear();
+    for (size_t row = 0; row < storage_info->RowCount(); row++) {
+        const int64_t block_id = storage_info->GetValue(0, row).GetValue<int64_t>();
+        const std::string segment_type = storage_info->GetValue(3, row).ToString();
+        if (segment_type == "VARCHAR") {
+            measurement.segments++;
+            std::string segment_compression = storage_info->GetValue(2, row).ToString();
+            std::transform(segment_compression.begin(), segment_compression.end(), segment_compression.begin(), ::tolower);
+            if (measurement.compression.find(segment_compression) == std::string::npos) {
+                measurement.compression += (measurement.compression.empty() ? "" : "+") + segment_compression;
+            }
+        }
+        if (block_id < 0) {
+            continue; // constant segment, e.g. validity without NULLs, nothing is stored
+        }
+        segment_starts.push_back(SegmentStart{block_id, static_cast<size_t>(storage_info->GetValue(1, row).GetValue<int64_t>()),
+                                              storage_info->GetValue(4, row).GetValue<bool>(),
+                                              static_cast<size_t>(storage_info->GetValue(5, row).GetValue<int64_t>()),
+                                              storage_info->GetValue(6, row).ToString()});
+        const duckdb::Value additional = has_additional_blocks ? storage_info->GetValue(7, row) : duckdb::Value();
+        if (!additional.IsNull()) {
+            additional_blocks += additional.GetValue<int64_t>();
+        }
+    }
+
+    std::sort(segment_starts.begin(), segment_starts.end());
+    measurement.storage_bytes = additional_blocks * block_size;
+    measurement.slack_bytes = 0;
+    // Bytes and rows of the segments whose size is known, by column path, to charge the final segments at their rate
+    std::map<std::string, std::pair<size_t, size_t> > known_bytes_and_rows;
+    std::vector<size_t> open_segments;
+    for (size_t i = 0; i < segment_starts.size(); i++) {
+        const bool last_in_block = i + 1 == segment_starts.size() || segment_starts[i + 1].block_id != segment_starts[i].block_id;
+        const size_t segment_end = last_in_block ? block_size : segment_starts[i + 1].block_offset;
+        measurement.storage_bytes += segment_end - segment_starts[i].block_offset;
+        if (last_in_block && segment_starts[i].final_segment) {
+            open_segments.push_back(i);
+        } else {
+            known_bytes_and_rows[segment_starts[i].column_path].first += segment_end - segment_starts[i].block_offset;
+            known_bytes_and_rows[segment_starts[i].column_path].second += segment_starts[i].rows;
+        }
+    }
+    for (const size_t i : open_segments) {
+        const size_t tail = block_size - segment_starts[i].block_offset;
+        const std::pair<size_t, size_t> &known = known_bytes_and_rows[segment_starts[i].column_path];
+        const size_t charged = known.second == 0 ? 0 : std::min(tail, (segment_starts[i].rows * known.first + known.second - 1) / known.second);
+        measurement.slack_bytes += tail - charged;
+    }
+}
+
+// The bytes compression factors are taken against: storage_bytes without the free block space in slack_bytes
+inline size_t CalcAttributableBytes(const DuckDBCodecMeasurement &measurement) {
+    return measurement.storage_bytes - measurement.slack_bytes;
+}
+
+/*
+ * Creates table t (s VARCHAR) in con's database with force_compression = codec ("auto" leaves the choice to DuckDB),
+ * appends the n rows of input (nullptr strings are NULL) and checkpoints, so that the rows are compressed and scans
+ * read them from the persistent segments. Queries of con run single-threaded from here on. Returns the milliseconds
+ * spent appending and checkpointing.
+ */
+inline double LoadDuckDBCodecTable(duckdb::Connection &con, const StringCollection &input, const size_t n, const std::string &codec) {
+    con.Query("SET threads TO 1");
+    const auto set_codec = con.Query("SET force_compression = '" + codec + "'");
+    if (set_codec->HasError()) {
+        throw std::logic_error("DuckDB does not know codec " + codec + ": " + set_codec->GetError());
+    }
+    con.Query("CREATE TABLE t (s VARCHAR)");
+
+    const auto load_start = std::chrono::high_resolution_clock::now();
+    {
+        duckdb::Appender appender(con, "t");
+        for (size_t i = 0; i < n; i++) {
+            appender.BeginRow();
+            if (input.string_ptrs[i] == nullptr) {
+                appender.Append(duckdb::Value());
+            } else {
+                appender.Append(duckdb::string_t(reinterpret_cast<const char *>(input.string_ptrs[i]), input.lengths[i]));
+            }
+            appender.EndRow();
+        }
+        appender.Close();
+    }
+    const auto checkpoint = con.Query("FORCE CHECKPOINT");
+    if (checkpoint->HasError()) {
+        throw std::logic_error("Checkpoint with codec " + codec + " failed: " + checkpoint->GetError());
+    }
+    const auto load_end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(load_end - load_start).count();
+}
+
+/*
+ * Loads input with LoadDuckDBCodecTable() into a scratch database and times config::decompression_benchmark_repetitions
+ * full scans, keeping the fastest one. The scan takes the MAX() of the column, which has to look at every string but
+ * materializes none.
+ */
+inline DuckDBCodecMeasurement MeasureDuckDBCodec(const StringCollection &input, const size_t n, const std::string &codec) {
+    const std::string path = DuckDBCodecDatabasePath(codec);
+    RemoveDuckDBCodecDatabase(path);
+    DuckDBCodecMeasurement measurement;
+    {
+        duckdb::DuckDB db(path);
+        duckdb::Connection con(db);
+        measurement.load_time_ms = LoadDuckDBCodecTable(con, input, n, codec);
+        CalcStorageBytes(con, measurement);
+
+        for (size_t rep = 0; rep < config::decompression_benchmark_repetitions; ++rep) {
+            const auto scan_start = std::chrono::high_resolution_clock::now();
+            const auto scan = con.Query("SELECT MAX(s) FROM t");
+            const auto scan_end = std::chrono::high_resolution_clock::now();
+            if (scan->HasError()) {
+                throw std::logic_error("Scan with codec " + codec + " failed: " + scan->GetError());
+            }
+            const double scan_time_ms = std::chrono::duration<double, std::milli>(scan_end - scan_start).count();
+            if (rep == 0 || scan_time_ms < measurement.best_scan_time_ms) {
+                measurement.best_scan_time_ms = scan_time_ms;
+            }
+        }
+    }
+    RemoveDuckDBCodecDatabase(path);
+    return measurement;
+}
+
+inline double CalcStorageCompressionFactor(const size_t total_string_size, const size_t storage_bytes) {
+    return storage_bytes == 0 ? 0 : static_cast<double>(total_string_size) / static_cast<double>(storage_bytes);
+}
+
+/*
+ * One results row per codec of config::duckdb_codecs that the DuckDB we link against supports, algo "duckdb_<codec>".
+ * Leaves input untouched, and sets metadata.duckdb_best_compression_factor for these rows and those of the other
+ * algorithms. All codecs are measured before any row is added, so that every row carries the same best factor.
+ */
+inline void RunDuckDBCodecs(ResultsBuffer &results, Metadata &metadata, const size_t &n, const StringCollection &input,
+                            const size_t &total_string_size) {
+    std::vector<std::pair<std::string, DuckDBCodecMeasurement> > measurements;
+    metadata.duckdb_best_compression_factor = 0;
+    for (const std::string codec : config::duckdb_codecs) {
+        DuckDBCodecMeasurement measurement;
+        try {
+            measurement = MeasureDuckDBCodec(input, n, codec);
+        } catch (std::exception &e) {
+            std::cerr << "Skipping DuckDB codec " << codec << ": " << e.what() << std::endl;
+            continue;
+        }
+        if (measurement.compression.find(codec) == std::string::npos) {
+            std::cerr << "DuckDB stored the column as " << measurement.compression << " instead of " << codec << std::endl;
+        }
+        metadata.duckdb_best_compression_factor = std::max(metadata.duckdb_best_compression_factor,
+                                                           CalcStorageCompressionFactor(total_string_size, CalcAttributableBytes(measurement)));
+        measurements.push_back(std::make_pair(codec, measurement));
+    }
+
+    for (const std::pair<std::string, DuckDBCodecMeasurement> &codec_measurement : measurements) {
+        const std::string &codec = codec_measurement.first;
+        const DuckDBCodecMeasurement &measurement = codec_measurement.second;
+        ResetRunMetrics(metadata);
+        metadata.algo = "duckdb_" + codec;
+        metadata.run_time_ms = measurement.load_time_ms;
+        metadata.compression_factor = CalcStorageCompressionFactor(total_string_size, CalcAttributableBytes(measurement));
+        metadata.stages.decompression.time_ms = measurement.best_scan_time_ms;
+        const double seconds = measurement.best_scan_time_ms / 1e3;
+        metadata.decompression_mb_s = seconds > 0 ? static_cast<double>(total_string_size) / 1e6 / seconds : 0;
+        metadata.decompression_strings_per_s = seconds > 0 ? static_cast<double>(n) / seconds : 0;
+        metadata.decompression_threads = 1;
+        metadata.storage_codec = measurement.compression;
+        metadata.storage_bytes = measurement.storage_bytes;
+        metadata.storage_slack_bytes = measurement.slack_bytes;
+        printf("DuckDB %s: %zu bytes (%zu of them slack) in %zu segments (%s), factor %.3f, scan %.3f ms\n", codec.c_str(),
+               measurement.storage_bytes, measurement.slack_bytes, measurement.segments, measurement.compression.c_str(),
+               metadata.compression_factor, measurement.best_scan_time_ms);
+        results.Add(metadata, n, total_string_size);
+    }
+}
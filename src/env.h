@@ -1,9 +1,22 @@
 #pragma once
 #include <cstddef>
+#include <cstdlib>
 #include <string>
 
 namespace env {
-    const std::string project_dir = "/export/scratch2/home/yla/fsst-plus-experiments";
-    // const std::string project_dir = "/Users/yanlannaalexandre/_DA_REPOS/fsst-plus-experiments";
-    
+    // Root of the benchmarking/ tree: $FSST_PLUS_PROJECT_DIR, or else the working directory
+    inline std::string ProjectDir() {
+        const char *dir = std::getenv("FSST_PLUS_PROJECT_DIR");
+        return dir != nullptr && *dir != '\0' ? dir : ".";
+    }
+
+    const std::string project_dir = ProjectDir();
+
+    // Where scratch databases go, e.g. those of the DuckDB baselines: $TMPDIR, or else the project dir
+    inline std::string ScratchDir() {
+        const char *dir = std::getenv("TMPDIR");
+        return dir != nullptr && *dir != '\0' ? dir : project_dir;
+    }
+
+    const std::string scratch_dir = ScratchDir();
 }
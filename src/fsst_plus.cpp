@@ -12,15 +12,18 @@
 #include "block_writer.h"
 #include "block_decompressor.h"
 #include "cleaving_types.h"
+#include "memory_utils.h"
 #include <thread>
 #include <mutex>
 #include <atomic>
 #include <vector>
-#include <queue>
-#include <condition_variable>
+#include "work_stealing_scheduler.h"
+#include "dictionary_fsst_plus.h"
+#include "row_group_sorted_fsst_plus.h"
+#include "duckdb_codecs.h"
 
 namespace config {
-    constexpr size_t total_strings = 100000; // # of input strings
+    constexpr size_t total_strings = 10 * amount_strings_per_symbol_table; // rows per column at most, split into row groups
     constexpr bool print_sorted_corpus = false;
     constexpr bool print_split_points = false; // prints compressed corpus displaying split points
     constexpr bool print_similarity_chunks = false;
@@ -28,195 +31,40 @@ namespace config {
 }
 
 
-uint8_t *FindBlockStart(uint8_t *block_start_offsets, const int i) {
-    uint8_t *offset_ptr = block_start_offsets + (i * sizeof(uint32_t));
-    const uint32_t offset = Load<uint32_t>(offset_ptr);
-    uint8_t *block_start =  offset_ptr + offset;
-    return block_start;
-}
-
-void DecompressAll(uint8_t *global_header, const fsst_decoder_t &prefix_decoder,
-const fsst_decoder_t &suffix_decoder,
-const std::vector<size_t> &lengths_original,
-const std::vector<const unsigned char *> &string_ptrs_original,
-Metadata &metadata
-) {
-    metadata.global_index = 0; // Reset global index before decompression
-    uint16_t num_blocks = Load<uint16_t>(global_header);
-    uint8_t *block_start_offsets = global_header + sizeof(uint16_t);
-    for (int i = 0; i < num_blocks; ++i) {
-        const uint8_t *block_start = FindBlockStart(block_start_offsets, i);
-        /*
-         * Block stop is next block's start. Note that this also works for the last block, so no over-read,
-         * as we save an "extra" data_end_offset, pointing to where the last block stops. This is needed to
-         * calculate the length
-         */
-        const uint8_t *block_stop = FindBlockStart(block_start_offsets, i + 1);
-
-        DecompressBlock(block_start, prefix_decoder, suffix_decoder, block_stop, lengths_original, string_ptrs_original, metadata);
-    }
-    std::cout << "Decompression verified\n";
-}
-
-
-std::vector<SimilarityChunk> FormBlockwiseSimilarityChunks(const size_t &n, StringCollection &input, const size_t &block_granularity) {
-    std::vector<SimilarityChunk> similarity_chunks;
-    similarity_chunks.reserve(n);
-
-    // Figure out the optimal split points (similarity chunks)
-    for (size_t i = 0; i < n; i += block_granularity) {
-        const size_t cleaving_run_n = std::min(input.lengths.size() - i, block_granularity);
-
-        // std::cout << "Current Cleaving Run coverage: " << i << ":" << i + cleaving_run_n - 1 << std::endl;
-
-        TruncatedSort(input.lengths, input.string_ptrs, i, cleaving_run_n);
-
-        const std::vector<SimilarityChunk> cleaving_run_similarity_chunks = FormSimilarityChunks(
-            input.lengths, input.string_ptrs, i, cleaving_run_n);
-        similarity_chunks.insert(similarity_chunks.end(),
-                                 cleaving_run_similarity_chunks.begin(),
-                                 cleaving_run_similarity_chunks.end());
-    }
-    return similarity_chunks;
-}
-
-
-
-FSSTPlusCompressionResult FSSTPlusCompress(const size_t n, std::vector<SimilarityChunk> similarity_chunks, CleavedResult cleaved_result, const size_t &block_granularity) {
-    FSSTPlusCompressionResult compression_result{};
-
-    FSSTCompressionResult prefix_compression_result = FSSTCompress(cleaved_result.prefixes);
-    compression_result.prefix_encoder = prefix_compression_result.encoder;
-
-    FSSTCompressionResult suffix_compression_result = FSSTCompress(cleaved_result.suffixes);
-    compression_result.suffix_encoder = suffix_compression_result.encoder;
-
-    // Allocate the maximum size possible for the corpus
-    size_t max_size = CalcMaxFSSTPlusDataSize(prefix_compression_result,suffix_compression_result);
-    compression_result.data_start = new uint8_t[max_size];
-
-    // std::cout << "Data should start at: " << static_cast<void*>(compression_result.data_start) << '\n';
-    // std::cout << "and end at: " << static_cast<void*>(compression_result.data_start + max_size) << '\n';
+// Set by main(). Only a single worker has the process' RSS to itself, see CurrentRSSBytes()
+bool single_worker = true;
 
-    /*
-     *  >>> WRITE GLOBAL HEADER <<<
-     *
-     * To write num_blocks, we must know how many blocks we have. But first let's
-     * calculate the size of each block (giving us also the number of blocks),
-     * allowing us to write block_start_offsets[] and data_end_offset also.
-     */
-
-     FSSTPlusSizingResult sizing_result = SizeEverything(n, similarity_chunks, prefix_compression_result, suffix_compression_result, block_granularity);
-
-
-    uint8_t* global_header_ptr = compression_result.data_start;
-
-    // Now we can write!
-
-    // A) write num_blocks
-    size_t n_blocks = sizing_result.block_sizes_pfx_summed.size();
-    Store<uint16_t>(n_blocks ,global_header_ptr);
-    global_header_ptr+=sizeof(uint16_t);
-
-    // B) write block_start_offsets[]
-    for (size_t i = 0; i < n_blocks; i++) {
-        size_t offsets_to_go = (n_blocks - i); // count itself, so that the "base" begins at the offset's end
-        size_t global_header_size_ahead =
-                offsets_to_go * sizeof(uint32_t)
-                + sizeof(uint32_t); // data_end_offset size
-        const size_t total_block_size_ahead =  i == 0 ? 0 : sizing_result.block_sizes_pfx_summed[i-1];
-
-        Store<uint32_t>(global_header_size_ahead + total_block_size_ahead, global_header_ptr);
-        global_header_ptr +=sizeof(uint32_t);
-    }
-
-    // C) write data_end_offset
-    Store<uint32_t>(sizing_result.block_sizes_pfx_summed.back() + sizeof(uint32_t) // count itself, so that the "base" begins at the offset's end
-                    ,global_header_ptr);
-    global_header_ptr +=sizeof(uint32_t);
-
-    uint8_t* next_block_start_ptr = global_header_ptr;
-
-    //  >>> WRITE BLOCKS <<<
-    for (size_t i = 0; i < sizing_result.wms.size(); i++) {
-        // use metadata to write correctly
-
-        // std::cout << "wm.prefix_area_size: " << sizing_result.wms[i].prefix_area_size << "\n";
-
-        // std::cout << "\n🧱 Block " << std::setw(3) << i << " start: " << static_cast<void*>(next_block_start_ptr) << '\n';
-        next_block_start_ptr = WriteBlock(next_block_start_ptr, prefix_compression_result, suffix_compression_result, sizing_result.wms[i]);
-    }
-
-    // Cleanup
-    free(prefix_compression_result.output_buffer);
-    free(suffix_compression_result.output_buffer);
-
-    compression_result.data_end = next_block_start_ptr;
-    return compression_result;
-}
-
-bool CreateResultsTable(Connection &con) {
-    // Begin transaction
-    con.Query("BEGIN TRANSACTION");
-
-    // Create a results table to store benchmarks
-    const string create_results_table =
-            "CREATE TABLE results ("
-            "path VARCHAR, "
-            "dataset VARCHAR, "
-            "col_name VARCHAR, "
-            "algo VARCHAR, "
-            "amount_of_rows BIGINT, "
-            "run_time_ms DOUBLE, "
-            "compression_factor DOUBLE, "
-            "num_strings BIGINT, "
-            "original_size BIGINT"
-            ");";
-
-    try {
-        con.Query(create_results_table);
-
-        // Commit the transaction to persist the table
-        con.Query("COMMIT");
-    } catch (std::exception& e) {
-        con.Query("ROLLBACK");
-        std::cerr << "Failed to create results table: " << e.what() << std::endl;
-        return false;
-    }
-
-    // Verify the table was created (after commit)
-    auto verify_result = con.Query("SHOW TABLES");
-    auto verify_chunk = verify_result->Fetch();
-    bool found_results_table = false;
-
-    while (verify_chunk) {
-        // Only access columns that exist
-        size_t num_cols = verify_chunk->data.size();
-        if (num_cols == 0) {
-            std::cerr << "SHOW TABLES returned no columns" << std::endl;
-            break;
-        }
+struct DecompressionBenchmarkResult {
+    double best_time_ms = 0;
+    double gb_s = 0;
+    double strings_per_s = 0;
+};
 
-        // Use the first column as it contains the table name in this case
-        auto table_names = duckdb::FlatVector::GetData<duckdb::string_t>(verify_chunk->data[0]);
-        for (size_t i = 0; i < verify_chunk->size(); i++) {
-            std::string table_name = table_names[i].GetString();
-            std::cout << " - " << table_name << std::endl;
-            if (table_name == "results") {
-                found_results_table = true;
-            }
+/*
+ * Decode-only scans of the compressed buffer, repeated config::decompression_benchmark_repetitions times.
+ * Reports the fastest scan, throughput is measured on the column's total_string_size and n_rows.
+ * scan() decodes the whole column, its output is left in place for an optional verification pass.
+ */
+template <typename Scan>
+DecompressionBenchmarkResult BenchmarkDecompression(const Scan &scan, const size_t total_string_size, const size_t n_rows,
+                                                    StageMeasurement &decompression) {
+    DecompressionBenchmarkResult result{};
+    for (size_t rep = 0; rep < config::decompression_benchmark_repetitions; ++rep) {
+        StageMeasurement scan_measurement;
+        const StageProbe scan_probe;
+        scan();
+        scan_probe.Stop(scan_measurement);
+        if (rep == 0 || scan_measurement.time_ms < result.best_time_ms) {
+            result.best_time_ms = scan_measurement.time_ms;
+            decompression = scan_measurement;
         }
-        verify_chunk = verify_result->Fetch();
     }
-
-    if (!found_results_table) {
-        std::cerr << "Results table was not created successfully" << std::endl;
-        return false;
+    if (result.best_time_ms > 0) {
+        const double seconds = result.best_time_ms / 1e3;
+        result.gb_s = static_cast<double>(total_string_size) / 1e9 / seconds;
+        result.strings_per_s = static_cast<double>(n_rows) / seconds;
     }
-
-    std::cout << "Results table created successfully" << std::endl;
-
-    return found_results_table;
+    return result;
 }
 
 vector<string> FindDatasets(Connection &con, const string &data_dir) {
@@ -251,8 +99,8 @@ vector<string> GetColumnNames(const unique_ptr<MaterializedQueryResult> &columns
     return column_names;
 }
 
-bool ColumnIsStringType(Connection &con, const string &column_name) {
-    const auto column_type_result = con.Query("SELECT data_type FROM duckdb_columns() WHERE table_name = 'temp_view' AND column_name = '" + column_name + "'");
+bool ColumnIsStringType(Connection &con, const string &view_name, const string &column_name) {
+    const auto column_type_result = con.Query("SELECT data_type FROM duckdb_columns() WHERE table_name = '" + view_name + "' AND column_name = '" + column_name + "'");
     const auto column_type_chunk = column_type_result->Fetch();
     if (column_type_chunk) {
         const string type = duckdb::FlatVector::GetData<duckdb::string_t>(column_type_chunk->data[0])[0].GetString();
@@ -264,13 +112,33 @@ bool ColumnIsStringType(Connection &con, const string &column_name) {
     return true;
 }
 
-void RunFSSTPlus(Connection &con, const size_t &block_granularity, Metadata &metadata, const size_t &n, StringCollection &input, const size_t &total_string_size) {
+void RunFSSTPlus(ResultsBuffer &results, const size_t &block_granularity, Metadata &metadata, const size_t &n, StringCollection &input, const size_t &total_string_size) {
+    ResetRunMetrics(metadata);
+    StageMeasurements &stages = metadata.stages;
+    metadata.perf_counters_available = ThreadPerfCounters().Available();
+    MemoryFootprint &memory = metadata.memory;
+    memory.input_bytes = CalcStringCollectionBytes(input);
+    const long rss_before = single_worker ? CurrentRSSBytes() : 0;
+
+    // Compression sorts input in place, keep the original row order to verify against
+    std::vector<size_t> original_lengths;
+    std::vector<const unsigned char *> original_string_ptrs;
+    if (config::verify_decompression) {
+        original_lengths = input.lengths;
+        original_string_ptrs = input.string_ptrs;
+    }
+
     // Start timing
     auto start_time = std::chrono::high_resolution_clock::now();
 
-    const std::vector<SimilarityChunk> similarity_chunks = FormBlockwiseSimilarityChunks(n, input, block_granularity);
+    CleavingRuns runs;
+    const std::vector<SimilarityChunk> similarity_chunks = FormBlockwiseSimilarityChunks(n, input, block_granularity, runs, stages);
+    const size_t n_strings = runs.first_strings.back(); // NULLs are out of the string stream from here on
 
-    const CleavedResult cleaved_result = Cleave(input.lengths, input.string_ptrs, similarity_chunks, n);
+    const StageProbe cleave_probe;
+    CleavedResult cleaved_result = Cleave(input.lengths, input.string_ptrs, similarity_chunks, n_strings);
+    cleave_probe.Stop(stages.cleave);
+    memory.cleaved_bytes = CalcCleavedResultBytes(cleaved_result);
     if (config::print_similarity_chunks) {
         std::cout << "🤓 Similarity Chunks 🤓\n";
         for (int i = 0; i < similarity_chunks.size(); ++i) {
@@ -280,15 +148,41 @@ void RunFSSTPlus(Connection &con, const size_t &block_granularity, Metadata &met
                     << " PREFIX: " << cleaved_result.prefixes.string_ptrs[i] << "\n";
         }
     }
-    const FSSTPlusCompressionResult compression_result = FSSTPlusCompress(n, similarity_chunks, cleaved_result, block_granularity);
+    const FSSTPlusCompressionResult compression_result = FSSTPlusCompress(n_strings, similarity_chunks, cleaved_result, runs, block_granularity, stages, memory);
 
     // End timing
     auto end_time = std::chrono::high_resolution_clock::now();
 
-    // decompress to check all went well
-    DecompressAll(compression_result.data_start, fsst_decoder(compression_result.prefix_encoder),
-                  fsst_decoder(compression_result.suffix_encoder), input.lengths, input.string_ptrs, metadata);
-
+    // Decode-only throughput, then check all went well in a separate pass
+    const fsst_decoder_t prefix_decoder = fsst_decoder(compression_result.prefix_encoder);
+    const fsst_decoder_t suffix_decoder = fsst_decoder(compression_result.suffix_encoder);
+    constexpr size_t decompression_padding = 32; // lets fsst_decompress() stay on its fast path up to the last string
+    const size_t decompressed_capacity = total_string_size + decompression_padding;
+    unsigned char *decompressed = ThreadArena().Allocate(decompressed_capacity);
+    std::vector<const unsigned char *> decompressed_ptrs(n);
+    std::vector<size_t> decompressed_lengths(n);
+    memory.decompression_buffer_bytes = decompressed_capacity + CalcVectorBytes(decompressed_ptrs) + CalcVectorBytes(decompressed_lengths);
+
+    ThreadPool decompression_pool(config::decompression_threads); // started before the timed scans
+    const DecompressionBenchmarkResult decompression_benchmark = BenchmarkDecompression([&]() {
+        if (config::decompression_threads > 1) {
+            DecompressAllParallel(compression_result.data_start, prefix_decoder, suffix_decoder, decompressed, decompressed_capacity,
+                                  decompressed_ptrs, decompressed_lengths, decompression_pool);
+        } else {
+            DecompressAll(compression_result.data_start, prefix_decoder, suffix_decoder, decompressed, decompressed_capacity,
+                          decompressed_ptrs, decompressed_lengths);
+        }
+    }, total_string_size, n, stages.decompression);
+    metadata.decompression_mb_s = decompression_benchmark.gb_s * 1e3;
+    metadata.decompression_strings_per_s = decompression_benchmark.strings_per_s;
+    metadata.decompression_threads = config::decompression_threads;
+    printf("Decompression: %.3f GB/s, %.0f strings/s\n", decompression_benchmark.gb_s, decompression_benchmark.strings_per_s);
+
+    if (config::verify_decompression) {
+        VerifyDecompression(decompressed_ptrs, decompressed_lengths, original_lengths, original_string_ptrs);
+    }
+    memory.arena_bytes = ThreadArena().Capacity();
+    memory.rss_delta_bytes = single_worker ? CurrentRSSBytes() - rss_before : 0;
 
     metadata.run_time_ms = std::chrono::duration<double, std::milli>(end_time - start_time).count();
 
@@ -304,43 +198,176 @@ void RunFSSTPlus(Connection &con, const size_t &block_granularity, Metadata &met
     size_t savings = non_bitpacked_offsets_size - bitpacked_offsets_size;
     printf("Savings of bitpacking global header block offsets: %zu bytes\n", savings);
     compressed_size -= savings;
+    // The zone map is an optional index next to the corpus, it is not counted in the compression factor
+    printf("Zone map: %zu bytes\n", static_cast<size_t>(compression_result.zone_map_end - compression_result.zone_map_start));
+    if (compression_result.bloom_filter_start != nullptr) {
+        metadata.bloom_filter_bytes = compression_result.bloom_filter_end - compression_result.bloom_filter_start;
+        metadata.bloom_filter_fpr = BloomFilterFalsePositiveRate(compression_result.bloom_filter_start, config::bloom_filter_fpr_probes_per_block);
+        printf("Bloom filters: %zu bytes, %.4f false-positive rate\n", metadata.bloom_filter_bytes, metadata.bloom_filter_fpr);
+    }
     metadata.compression_factor = static_cast<double>(total_string_size) / static_cast<double>(compressed_size);
 
     PrintCompressionStats(n, total_string_size, compressed_size);
 
     // Add results to table
-    string insert_query = "INSERT INTO results VALUES ('" +
-                          metadata.dataset_folders + "', '" +
-                          metadata.dataset + "', '" +
-                          metadata.column + "', '" +
-                          metadata.algo + "', " +
-                          std::to_string(metadata.amount_of_rows) + ", " +
-                          std::to_string(metadata.run_time_ms) + ", " +
-                          std::to_string(metadata.compression_factor) + ", " +
-                          std::to_string(n) + ", " +
-                          std::to_string(total_string_size) + ");";
-
-    try {
-        con.Query(insert_query);
-        std::cout << "Inserted result for " << metadata.dataset << "." << metadata.column << std::endl;
-    } catch (std::exception& e) {
-        std::cerr << "Failed to insert result: " << e.what() << std::endl;
-    }
+    results.Add(metadata, n, total_string_size);
 
     // Cleanup
     fsst_destroy(compression_result.prefix_encoder);
     fsst_destroy(compression_result.suffix_encoder);
-    delete[] compression_result.data_start;
 }
 
-bool process_dataset(Connection &con, const size_t &block_granularity, const string &dataset_path, int thread_id) {
-    // Extract dataset name from path
-    string dataset_folders = dataset_path.substr(0, dataset_path.find_last_of("/"));
+/*
+ * Hybrid dictionary + FSST+ (see dictionary_fsst_plus.h). Leaves input untouched, so it can run before RunFSSTPlus(),
+ * which sorts input in place.
+ */
+void RunDictionaryFSSTPlus(ResultsBuffer &results, const size_t &block_granularity, Metadata &metadata, const size_t &n, const StringCollection &input, const size_t &total_string_size) {
+    ResetRunMetrics(metadata);
+    StageMeasurements &stages = metadata.stages;
+    metadata.perf_counters_available = ThreadPerfCounters().Available();
+    MemoryFootprint &memory = metadata.memory;
+    memory.input_bytes = CalcStringCollectionBytes(input);
+    const long rss_before = single_worker ? CurrentRSSBytes() : 0;
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    const DictionaryFSSTPlusCompressionResult compression_result = DictionaryFSSTPlusCompress(n, input, block_granularity, stages, memory);
+    auto end_time = std::chrono::high_resolution_clock::now();
+
+    // Only the dictionary gets decoded, rows point into it
+    uint8_t *dictionary_global_header = compression_result.dictionary.data_start;
+    const fsst_decoder_t prefix_decoder = fsst_decoder(compression_result.dictionary.prefix_encoder);
+    const fsst_decoder_t suffix_decoder = fsst_decoder(compression_result.dictionary.suffix_encoder);
+    constexpr size_t decompression_padding = 32; // lets fsst_decompress() stay on its fast path up to the last string
+    const size_t decompressed_capacity = LoadDecompressedOffset(dictionary_global_header, Load<uint16_t>(dictionary_global_header)) + decompression_padding;
+    unsigned char *decompressed = ThreadArena().Allocate(decompressed_capacity);
+    std::vector<const unsigned char *> decompressed_ptrs(n);
+    std::vector<size_t> decompressed_lengths(n);
+    memory.decompression_buffer_bytes = decompressed_capacity + CalcVectorBytes(decompressed_ptrs) + CalcVectorBytes(decompressed_lengths);
+
+    const DecompressionBenchmarkResult decompression_benchmark = BenchmarkDecompression([&]() {
+        DictionaryFSSTPlusDecompressAll(dictionary_global_header, compression_result.codes_start, prefix_decoder, suffix_decoder,
+                                        decompressed, decompressed_capacity, decompressed_ptrs, decompressed_lengths);
+    }, total_string_size, n, stages.decompression);
+    metadata.decompression_mb_s = decompression_benchmark.gb_s * 1e3;
+    metadata.decompression_strings_per_s = decompression_benchmark.strings_per_s;
+    metadata.decompression_threads = 1;
+    printf("Decompression: %.3f GB/s, %.0f strings/s\n", decompression_benchmark.gb_s, decompression_benchmark.strings_per_s);
+
+    if (config::verify_decompression) {
+        VerifyDecompression(decompressed_ptrs, decompressed_lengths, input.lengths, input.string_ptrs);
+    }
+    memory.arena_bytes = ThreadArena().Capacity();
+    memory.rss_delta_bytes = single_worker ? CurrentRSSBytes() - rss_before : 0;
+
+    metadata.run_time_ms = std::chrono::duration<double, std::milli>(end_time - start_time).count();
+
+    size_t compressed_size = compression_result.dictionary.data_end - compression_result.dictionary.data_start;
+    compressed_size += CalcSymbolTableSize(compression_result.dictionary.prefix_encoder);
+    compressed_size += CalcSymbolTableSize(compression_result.dictionary.suffix_encoder);
+    compressed_size += compression_result.codes_end - compression_result.codes_start;
+    std::cout << "Dictionary entries: " << LoadDictionaryNumEntries(compression_result.codes_start)
+              << ", code width: " << static_cast<int>(LoadDictionaryCodeWidth(compression_result.codes_start)) << " bits\n";
+    metadata.compression_factor = static_cast<double>(total_string_size) / static_cast<double>(compressed_size);
+
+    PrintCompressionStats(n, total_string_size, compressed_size);
+
+    results.Add(metadata, n, total_string_size);
+
+    fsst_destroy(compression_result.dictionary.prefix_encoder);
+    fsst_destroy(compression_result.dictionary.suffix_encoder);
+}
+
+/*
+ * FSST+ over the row group sorted as a whole (see row_group_sorted_fsst_plus.h). Its compression_factor includes the
+ * permutation, which is reported separately as permutation_bytes to weigh it against the gain over "fsstplus_twost".
+ * Leaves input untouched.
+ */
+void RunRowGroupSortedFSSTPlus(ResultsBuffer &results, const size_t &block_granularity, Metadata &metadata, const size_t &n, const StringCollection &input, const size_t &total_string_size) {
+    ResetRunMetrics(metadata);
+    StageMeasurements &stages = metadata.stages;
+    metadata.perf_counters_available = ThreadPerfCounters().Available();
+    MemoryFootprint &memory = metadata.memory;
+    memory.input_bytes = CalcStringCollectionBytes(input);
+    const long rss_before = single_worker ? CurrentRSSBytes() : 0;
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    const RowGroupSortedCompressionResult compression_result = RowGroupSortedFSSTPlusCompress(n, input, block_granularity, stages, memory);
+    auto end_time = std::chrono::high_resolution_clock::now();
+
+    const fsst_decoder_t prefix_decoder = fsst_decoder(compression_result.sorted.prefix_encoder);
+    const fsst_decoder_t suffix_decoder = fsst_decoder(compression_result.sorted.suffix_encoder);
+    constexpr size_t decompression_padding = 32; // lets fsst_decompress() stay on its fast path up to the last string
+    const size_t decompressed_capacity = total_string_size + decompression_padding;
+    unsigned char *decompressed = ThreadArena().Allocate(decompressed_capacity);
+    std::vector<const unsigned char *> decompressed_ptrs(n);
+    std::vector<size_t> decompressed_lengths(n);
+    memory.decompression_buffer_bytes = decompressed_capacity + CalcVectorBytes(decompressed_ptrs) + CalcVectorBytes(decompressed_lengths);
+
+    const DecompressionBenchmarkResult decompression_benchmark = BenchmarkDecompression([&]() {
+        RowGroupSortedFSSTPlusDecompressAll(compression_result.sorted.data_start, compression_result.permutation_start,
+                                            prefix_decoder, suffix_decoder, decompressed, decompressed_capacity,
+                                            decompressed_ptrs, decompressed_lengths);
+    }, total_string_size, n, stages.decompression);
+    metadata.decompression_mb_s = decompression_benchmark.gb_s * 1e3;
+    metadata.decompression_strings_per_s = decompression_benchmark.strings_per_s;
+    metadata.decompression_threads = 1;
+    printf("Decompression: %.3f GB/s, %.0f strings/s\n", decompression_benchmark.gb_s, decompression_benchmark.strings_per_s);
+
+    if (config::verify_decompression) {
+        VerifyDecompression(decompressed_ptrs, decompressed_lengths, input.lengths, input.string_ptrs);
+    }
+    memory.arena_bytes = ThreadArena().Capacity();
+    memory.rss_delta_bytes = single_worker ? CurrentRSSBytes() - rss_before : 0;
+
+    metadata.run_time_ms = std::chrono::duration<double, std::milli>(end_time - start_time).count();
+
+    metadata.permutation_bytes = compression_result.permutation_end - compression_result.permutation_start;
+    size_t compressed_size = compression_result.sorted.data_end - compression_result.sorted.data_start;
+    compressed_size += CalcSymbolTableSize(compression_result.sorted.prefix_encoder);
+    compressed_size += CalcSymbolTableSize(compression_result.sorted.suffix_encoder);
+    std::cout << "Sorted corpus: " << compressed_size << " bytes, permutation: " << metadata.permutation_bytes << " bytes\n";
+    compressed_size += metadata.permutation_bytes;
+    metadata.compression_factor = static_cast<double>(total_string_size) / static_cast<double>(compressed_size);
+
+    PrintCompressionStats(n, total_string_size, compressed_size);
+
+    results.Add(metadata, n, total_string_size);
+
+    fsst_destroy(compression_result.sorted.prefix_encoder);
+    fsst_destroy(compression_result.sorted.suffix_encoder);
+}
+
+// Either a dataset that still has to be split into columns (column_name empty), or one row group of one column
+struct BenchmarkTask {
+    string dataset_path;
+    string column_name; // empty for a dataset task, which plans the column tasks
+    size_t row_group;
+    size_t rows; // rows of the row group, up to config::amount_strings_per_symbol_table. For a dataset task, rows per column at most
+};
+
+void SplitDatasetPath(const string &dataset_path, string &dataset_folders, string &dataset_name) {
+    dataset_folders = dataset_path.substr(0, dataset_path.find_last_of("/"));
     string substring = dataset_path.substr(dataset_path.find_last_of("/") + 1);
-    string dataset_name = substring.substr(0, substring.find_last_of('.'));
+    dataset_name = substring.substr(0, substring.find_last_of('.'));
+}
+
+size_t CountRows(Connection &con, const string &dataset_path) {
+    const auto count_result = con.Query("SELECT COUNT(*) FROM read_parquet('" + dataset_path + "')");
+    const auto count_chunk = count_result->Fetch();
+    if (!count_chunk || count_chunk->size() == 0) {
+        return 0;
+    }
+    return duckdb::FlatVector::GetData<int64_t>(count_chunk->data[0])[0];
+}
 
-    // Create a unique temp view name for this thread
-    string temp_view_name = "temp_view_" + std::to_string(thread_id);
+// Splits a dataset into one task per string column and row group
+vector<BenchmarkTask> PlanDataset(Connection &con, const string &dataset_path, const size_t &max_rows, const size_t &worker_id) {
+    string dataset_folders;
+    string dataset_name;
+    SplitDatasetPath(dataset_path, dataset_folders, dataset_name);
+
+    // Create a unique temp view name for this worker
+    string temp_view_name = "temp_view_" + std::to_string(worker_id);
 
     std::cout<<"dataset_path: "<<dataset_path << "\n";
     std::cout<<"dataset_name: "<< dataset_name << "\n";
@@ -349,126 +376,131 @@ bool process_dataset(Connection &con, const size_t &block_granularity, const str
     con.Query("CREATE OR REPLACE VIEW " + temp_view_name + " AS SELECT * FROM read_parquet('" + dataset_path + "')");
     auto columns_result = con.Query("SELECT column_name FROM duckdb_columns() WHERE table_name = '" + temp_view_name + "'");
     vector<string> column_names;
+    vector<BenchmarkTask> tasks;
 
     try {
-        column_names = GetColumnNames(columns_result); //TODO: Uncomment
-        // column_names = {"fromUseravatarUrlMedium"};
+        column_names = GetColumnNames(columns_result);
     } catch (std::exception& e) {
         std::cerr << "🚨 Error GetColumnNames() with dataset: " << dataset_name << ": " << e.what() << std::endl;
         std::cerr << "Moving on to the next dataset" << std::endl;
-        return false;
+        con.Query("DROP VIEW IF EXISTS " + temp_view_name);
+        return tasks;
     }
 
-    // For each column
+    // Row groups of the dataset's real rows, bounded by max_rows per column
+    const size_t rows = std::min(CountRows(con, dataset_path), max_rows);
+    const size_t n_row_groups = std::max<size_t>(1, (rows + config::amount_strings_per_symbol_table - 1) / config::amount_strings_per_symbol_table);
+
     for (const auto& column_name : column_names) {
-        std::cout << "\n🟡> Processing dataset: " << dataset_name << ", column: " << column_name << std::endl;
-        try {
-            // Skip this column if it's not string
-            if (!ColumnIsStringType(con, column_name)) {
-                std::cerr<<"Refined column is not string time. This should not happen as refinement should deal with that. Skipping column.";
-                continue;
-                // throw std::logic_error("Refined column is not string time. This should not happen as refinement should deal with that. Terminating");
-            }
+        // Skip this column if it's not string
+        if (!ColumnIsStringType(con, temp_view_name, column_name)) {
+            std::cerr<<"Refined column is not string time. This should not happen as refinement should deal with that. Skipping column.";
+            continue;
+        }
+        for (size_t row_group = 0; row_group < n_row_groups; ++row_group) {
+            const size_t row_group_start = row_group * config::amount_strings_per_symbol_table;
+            const size_t row_group_rows = std::min(config::amount_strings_per_symbol_table, rows - std::min(rows, row_group_start));
+            tasks.push_back(BenchmarkTask{dataset_path, column_name, row_group, row_group_rows});
+        }
+    }
 
-            // Set global variables for tracking
-            Metadata metadata{};
-            metadata.dataset_folders = dataset_folders;
-            metadata.dataset = dataset_name;
-            metadata.column = column_name;
+    // Clean up the temp view when done
+    con.Query("DROP VIEW IF EXISTS " + temp_view_name);
+    return tasks;
+}
 
-            // Query to get column data
-            const string query =
-                    "SELECT \"" + column_name + "\" FROM read_parquet('" + dataset_path + "')"
-                    "LIMIT " + std::to_string(config::total_strings) + ";";
+void ProcessColumnTask(Connection &con, ResultsBuffer &results, const size_t &block_granularity, const BenchmarkTask &task) {
+    string dataset_folders;
+    string dataset_name;
+    SplitDatasetPath(task.dataset_path, dataset_folders, dataset_name);
+    const string &column_name = task.column_name;
 
-            const auto result = con.Query(query);
-            metadata.amount_of_rows = result->RowCount();
+    std::cout << "\n🟡> Processing dataset: " << dataset_name << ", column: " << column_name << ", row group: " << task.row_group << std::endl;
+    // Buffers of the previous column are no longer referenced, their pages get reused for this one
+    ThreadArena().Reset();
+    try {
+        // Set global variables for tracking
+        Metadata metadata{};
+        metadata.dataset_folders = dataset_folders;
+        metadata.dataset = dataset_name;
+        metadata.column = column_name;
+        metadata.row_group = task.row_group;
+
+        // Query to get the row group's data
+        const size_t row_group_start = task.row_group * config::amount_strings_per_symbol_table;
+        const string query =
+                "SELECT \"" + column_name + "\" FROM read_parquet('" + task.dataset_path + "')"
+                "LIMIT " + std::to_string(task.rows) + " OFFSET " + std::to_string(row_group_start) + ";";
+
+        const auto result = con.Query(query);
+        metadata.amount_of_rows = result->RowCount();
+
+        auto data_chunk = result->Fetch();
+        if (!data_chunk || data_chunk->size() == 0) {
+            std::cout << "No data for column: " << column_name << std::endl;
+            return;
+        }
 
-            auto data_chunk = result->Fetch();
-            if (!data_chunk || data_chunk->size() == 0) {
-                std::cout << "No data for column: " << column_name << std::endl;
-                continue;
-            }
+        const size_t n = std::min(config::amount_strings_per_symbol_table, static_cast<size_t>(result->RowCount()));
 
-            const size_t n = std::min(config::amount_strings_per_symbol_table, static_cast<size_t>(result->RowCount()));
+        StringCollection input = RetrieveData(result, data_chunk, n); // 100k rows
 
-            StringCollection input = RetrieveData(result, data_chunk, n); // 100k rows
+        size_t total_string_size = {0};
+        for (const size_t string_length: input.lengths) {
+            total_string_size += string_length;
+        }
 
-            size_t total_string_size = {0};
-            for (const size_t string_length: input.lengths) {
-                total_string_size += string_length;
-            }
+        // std::cout <<"==========START DICTIONARY COMPRESSION=========\n";
+        // metadata.algo = "dictionary";
+        // RunDictionaryCompression(con, results, column_name, task.dataset_path, n, total_string_size, metadata);
 
-            // std::cout <<"==========START DICTIONARY COMPRESSION=========\n";
-            // metadata.algo = "dictionary";
-            // RunDictionaryCompression(con, column_name, dataset_path, n, total_string_size, metadata);
+        // std::cout <<"==========START BASIC FSST COMPRESSION=========\n";
+        // metadata.algo = "basic_fsst";
+        // RunBasicFSST(results, input, total_string_size, metadata);
 
-            // std::cout <<"==========START BASIC FSST COMPRESSION=========\n";
-            // metadata.algo = "basic_fsst";
-            // RunBasicFSST(con, input, total_string_size, metadata);
+        // Before the FSST+ runs, RunFSSTPlus() sorts input in place and the baselines get the row group's original order
+        std::cout <<"==========START DUCKDB CODECS==========\n";
+        RunDuckDBCodecs(results, metadata, n, input, total_string_size);
 
-            std::cout <<"==========START FSST PLUS COMPRESSION==========\n";
-            metadata.algo = "fsstplus_twost";
-            RunFSSTPlus(con, block_granularity, metadata, n, input, total_string_size);
-        } catch (std::exception& e) {
-            std::cerr << "🚨 Error processing column" << dataset_name << "." << column_name << ": " << e.what() << std::endl;
-            std::cerr << "Moving on to the next column" << std::endl;
-        }
-    }
-    
-    // Clean up the temp view when done
-    con.Query("DROP VIEW IF EXISTS " + temp_view_name);
-    return true;
-}
+        std::cout <<"==========START DICTIONARY FSST PLUS COMPRESSION==========\n";
+        metadata.algo = "dictionary_fsstplus";
+        RunDictionaryFSSTPlus(results, block_granularity, metadata, n, input, total_string_size);
 
-// Thread-safe queue for distributing datasets to worker threads
-class ThreadSafeQueue {
-private:
-    std::queue<string> queue;
-    std::mutex mutex;
-    std::condition_variable cv;
-    bool done = false;
-
-public:
-    void push(const string& item) {
-        std::unique_lock<std::mutex> lock(mutex);
-        queue.push(item);
-        cv.notify_one();
-    }
+        std::cout <<"==========START ROW GROUP SORTED FSST PLUS COMPRESSION==========\n";
+        metadata.algo = "fsstplus_rowgroup_sorted";
+        RunRowGroupSortedFSSTPlus(results, block_granularity, metadata, n, input, total_string_size);
 
-    bool pop(string& item) {
-        std::unique_lock<std::mutex> lock(mutex);
-        cv.wait(lock, [this] { return !queue.empty() || done; });
-        
-        if (queue.empty() && done) {
-            return false;
-        }
-        
-        item = queue.front();
-        queue.pop();
-        return true;
-    }
-    
-    void finish() {
-        std::unique_lock<std::mutex> lock(mutex);
-        done = true;
-        cv.notify_all();
+        std::cout <<"==========START FSST PLUS COMPRESSION==========\n";
+        metadata.algo = "fsstplus_twost";
+        RunFSSTPlus(results, block_granularity, metadata, n, input, total_string_size);
+    } catch (std::exception& e) {
+        std::cerr << "🚨 Error processing column" << dataset_name << "." << column_name << ": " << e.what() << std::endl;
+        std::cerr << "Moving on to the next column" << std::endl;
     }
-};
+}
 
 // Thread worker function
-void worker_thread(int thread_id, ThreadSafeQueue& queue, DuckDB& db, const size_t& block_granularity) {
-    // Create a connection for this thread
+void worker_thread(size_t worker_id, WorkStealingScheduler<BenchmarkTask> &scheduler, DuckDB &db, ResultsSink &results_sink, const size_t &block_granularity) {
+    // Create a connection and a results buffer for this thread
     Connection con(db);
-    
-    string dataset_path;
-    while (queue.pop(dataset_path)) {
+    ResultsBuffer results(results_sink);
+
+    BenchmarkTask task;
+    while (scheduler.Pop(worker_id, task)) {
         try {
-            process_dataset(con, block_granularity, dataset_path, thread_id);
+            if (task.column_name.empty()) {
+                for (const BenchmarkTask &column_task : PlanDataset(con, task.dataset_path, task.rows, worker_id)) {
+                    scheduler.Push(worker_id, column_task);
+                }
+            } else {
+                ProcessColumnTask(con, results, block_granularity, task);
+            }
         } catch (std::exception& e) {
-            std::cerr << "Thread " << thread_id << " error processing dataset " << dataset_path << ": " << e.what() << std::endl;
+            std::cerr << "Worker " << worker_id << " error processing dataset " << task.dataset_path << ": " << e.what() << std::endl;
         }
+        scheduler.TaskDone();
     }
+    results.Flush();
 }
 
 void save_results(Connection &con) {
@@ -531,7 +563,7 @@ void save_results(Connection &con) {
     }
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     // Define project directory
     // string project_dir = "/export/scratch2/home/yla/fsst-plus-experiments";
     // string project_dir = "~/fsst-plus-experiments/";
@@ -540,8 +572,8 @@ int main() {
     // Create a persistent database connection
     string db_path = env::project_dir + "/benchmarking/results/benchmark.db";
     
-    // Ensure the data directory exists using system commands
-    system(("mkdir -p " + env::project_dir + "/benchmarking/data").c_str());
+    // Ensure the data and results directories exist using system commands
+    system(("mkdir -p " + env::project_dir + "/benchmarking/data " + env::project_dir + "/benchmarking/results").c_str());
     
     // Remove any existing database file to start fresh
     system(("rm -f " + db_path).c_str());
@@ -551,41 +583,47 @@ int main() {
     
     if (!CreateResultsTable(con)) return 1;
 
-    string data_dir = env::project_dir + "/benchmarking/data/refined";
+    // "fsst_plus <num_threads> <data dir>" benchmarks another directory of parquet files, e.g. generate_corpus output
+    string data_dir = argc > 2 ? string(argv[2]) : env::project_dir + "/benchmarking/data/refined";
+    // "fsst_plus <num_threads> <data dir> <rows per column>" lifts the bound on rows per column, e.g. for 100M generated rows
+    const size_t max_rows = argc > 3 ? std::stoull(argv[3]) : config::total_strings;
 
     vector<string> datasets = FindDatasets(con, data_dir);
     
     constexpr size_t block_granularity = 128;
-    constexpr int num_threads = 192;
 
-    // Create a thread-safe queue for distributing work
-    ThreadSafeQueue dataset_queue;
-    
-    for (const auto& dataset_path : datasets) { //TODO: Uncomment
-        dataset_queue.push(dataset_path);
+    // One worker per hardware thread, unless overridden with "fsst_plus <num_threads>"
+    const size_t hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+    const size_t num_threads = argc > 1 ? std::max<size_t>(1, std::stoul(argv[1])) : hardware_threads;
+    single_worker = num_threads == 1;
+
+    // Every worker already runs its own queries, so DuckDB only gets the cores the workers leave over
+    const size_t duckdb_threads = std::max<size_t>(1, hardware_threads / num_threads);
+    con.Query("SET threads TO " + std::to_string(duckdb_threads));
+    std::cout << "Running " << num_threads << " workers, DuckDB threads: " << duckdb_threads << std::endl;
+
+    // Dataset tasks are spread round-robin, the workers split them into column tasks and steal from each other
+    WorkStealingScheduler<BenchmarkTask> scheduler(num_threads);
+    for (size_t i = 0; i < datasets.size(); i++) {
+        scheduler.Push(i % num_threads, BenchmarkTask{datasets[i], "", 0, max_rows});
     }
 
-    // dataset_queue.push(env::project_dir + "/benchmarking/data/refined/NextiaJD/freecodecamp_casual_chatroom.parquet");
-    // dataset_queue.push(env::project_dir + "/benchmarking/data/refined/NextiaJD/glassdoor.parquet");
-    // dataset_queue.push(env::project_dir + "/benchmarking/data/refined/NextiaJD/glassdoor_photos.parquet");
-    // dataset_queue.push(env::project_dir + "/benchmarking/data/refined/NextiaJD/github_issues.parquet");
-    // dataset_queue.push(env::project_dir + "/benchmarking/data/refined/clickbench.parquet");
+    // scheduler.Push(0, BenchmarkTask{env::project_dir + "/benchmarking/data/refined/NextiaJD/glassdoor.parquet", "", 0});
+    // scheduler.Push(0, BenchmarkTask{env::project_dir + "/benchmarking/data/refined/clickbench.parquet", "", 0});
 
+    ResultsSink results_sink(db);
 
-    
     // Create worker threads
     std::vector<std::thread> threads;
-    for (int i = 0; i < num_threads; i++) {
-        threads.emplace_back(worker_thread, i, std::ref(dataset_queue), std::ref(db), std::ref(block_granularity));
+    for (size_t i = 0; i < num_threads; i++) {
+        threads.emplace_back(worker_thread, i, std::ref(scheduler), std::ref(db), std::ref(results_sink), std::ref(block_granularity));
     }
     
-    // Signal that no more items will be added to the queue
-    dataset_queue.finish();
-    
     // Wait for all threads to complete
     for (auto& thread : threads) {
         thread.join();
     }
+    results_sink.Close();
     
     // Save results to parquet file
     try {
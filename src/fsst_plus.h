@@ -3,30 +3,59 @@
 #include <vector>
 #include "basic_fsst.h"
 #include "block_types.h"
+#include "block_writer.h"
+#include "cleaving.h"
+#include "cleaving_types.h"
+#include "memory_utils.h"
+#include "arena.h"
+#include "perf_counters.h"
+#include "zone_map.h"
+#include "bloom_filter.h"
 #include <cmath>
+#include <stdexcept>
 struct FSSTPlusCompressionResult {
     fsst_encoder_t *prefix_encoder;
     fsst_encoder_t *suffix_encoder;
-    uint8_t *data_start;
+    uint8_t *data_start; // owned by the worker's ThreadArena(), valid until its next Reset()
     uint8_t *data_end;
+    uint8_t *zone_map_start; // side table next to the corpus, also in the worker's ThreadArena(), see zone_map.h
+    uint8_t *zone_map_end;
+    uint8_t *bloom_filter_start; // nullptr if config::bloom_filter_bits_per_key is 0, see bloom_filter.h
+    uint8_t *bloom_filter_end;
 };
 
 struct FSSTPlusSizingResult {
     std::vector<BlockWritingMetadata> wms;
     std::vector<size_t> block_sizes_pfx_summed;
+    std::vector<size_t> block_runs; // cleaving run of each block
 };
 
+/*
+ * Bytes of the global header after data_end_offset:
+ * decompressed_offsets[n_blocks + 1], block_run_starts[n_blocks], num_rows and the validity bitmap
+ */
+inline size_t CalcGlobalHeaderTrailerSize(const size_t n_blocks, const size_t num_rows) {
+    return (n_blocks + 1) * sizeof(uint32_t) + n_blocks * sizeof(uint32_t) + sizeof(uint32_t) + (num_rows + 7) / 8;
+}
+
 inline size_t CalcMaxFSSTPlusDataSize(const FSSTCompressionResult &prefix_compression_result,
-                                              const FSSTCompressionResult &suffix_compression_result) {
+                                              const FSSTCompressionResult &suffix_compression_result,
+                                              const CleavingRuns &runs) {
     size_t result = {0};
 
     const size_t ns = suffix_compression_result.encoded_string_ptrs.size(); // number of strings
-    const size_t nb = ceil(static_cast<double>(ns) / 128); // number of blocks
-    const size_t all_blocks_overhead = nb * (1 + 1 + 128 * 2); // block header3
+    // number of blocks, blocks don't cross cleaving runs so every run can add a partial block
+    const size_t nb = ceil(static_cast<double>(ns) / 128) + runs.first_strings.size();
+    const size_t all_blocks_overhead = nb * (1 + 1 + 128 * 2 + 128); // block header3, with rows[]
     result += all_blocks_overhead;
     result += CalcEncodedStringsSize(prefix_compression_result);
+    result += prefix_compression_result.encoded_string_lengths.size() * nested_prefix_header_size;
+    // a block may repeat the ancestors of its first prefix, every level adds at least one byte to a max_prefix_size prefix
+    result += nb * config::max_prefix_size * (nested_prefix_header_size + 2);
     result += CalcEncodedStringsSize(suffix_compression_result);
     result += ns * 3;
+    // global header: num_blocks, block_start_offsets[], data_end_offset, then the trailer
+    result += sizeof(uint16_t) + (nb + 1) * sizeof(uint32_t) + CalcGlobalHeaderTrailerSize(nb, runs.num_rows);
     // Add extra safety padding to avoid potential buffer overflows
     result += (nb * 1024); // 1KB extra per blockfor safety TODO: No real reason this should be done but was failing without
     return result;
@@ -48,34 +77,201 @@ inline StringCollection RetrieveData(const unique_ptr<MaterializedQueryResult> &
     return input;
 }
 
-inline FSSTPlusSizingResult SizeEverything(const size_t &n, const std::vector<SimilarityChunk> &similarity_chunks, const FSSTCompressionResult &prefix_compression_result, const FSSTCompressionResult &suffix_compression_result, const size_t &block_granularity) {
+// Uses runs.first_strings to keep blocks within their cleaving run, and runs.equals_previous to share duplicate suffixes
+inline FSSTPlusSizingResult SizeEverything(const size_t &n, const std::vector<SimilarityChunk> &similarity_chunks, const FSSTCompressionResult &prefix_compression_result, const FSSTCompressionResult &suffix_compression_result, const size_t &block_granularity, const CleavingRuns &runs) {
+    const std::vector<size_t> &run_first_strings = runs.first_strings;
     // First calculate total size of all blocks
     std::vector<BlockWritingMetadata> wms;
     std::vector<size_t> block_sizes_pfx_summed;
+    std::vector<size_t> block_runs;
 
     size_t suffix_area_start_index = 0; // start index for this block into all suffixes (stored in suffix_compression_result)
+    size_t run = 0;
 
     while (suffix_area_start_index < n) {
+        // Skip runs that are done, or were all NULL
+        while (run_first_strings[run + 1] <= suffix_area_start_index) {
+            run++;
+        }
+
         // Create fresh metadata for each block
         BlockWritingMetadata wm(block_granularity);  // Instead of reusing previous metadata
         wm.suffix_area_start_index = suffix_area_start_index;
 
         size_t block_size = CalculateBlockSizeAndPopulateWritingMetadata(
             similarity_chunks, prefix_compression_result, suffix_compression_result, wm,
-            suffix_area_start_index, block_granularity);
+            suffix_area_start_index, block_granularity, run_first_strings[run + 1], runs.equals_previous);
         size_t prefix_summed = block_sizes_pfx_summed.empty()
                                    ? block_size
                                    : block_sizes_pfx_summed.back() + block_size;
         block_sizes_pfx_summed.push_back(prefix_summed);
         wms.push_back(wm);
+        block_runs.push_back(run);
 
         suffix_area_start_index += wm.number_of_suffixes;
     }
     // std::cout << "We have this many blocks: " << wms.size() << "\n";
-    return FSSTPlusSizingResult{wms, block_sizes_pfx_summed};
+    return FSSTPlusSizingResult{wms, block_sizes_pfx_summed, block_runs};
 };
 
-inline void RunDictionaryCompression(duckdb::Connection &con, const string &column_name, const string &dataset_path, const size_t &n, const size_t &total_string_size, Metadata &metadata) {
+// Number of bytes the strings of this block take once decompressed: full prefix (parents included) plus suffix of every string
+inline size_t CalcBlockDecompressedSize(const BlockWritingMetadata &wm, const std::vector<SimilarityChunk> &similarity_chunks,
+                                        const CleavedResult &cleaved_result) {
+    size_t result = 0;
+    for (size_t k = 0; k < wm.number_of_suffixes; k++) {
+        const size_t prefix_index = wm.prefix_area_start_index + wm.suffix_prefix_index[k];
+        result += similarity_chunks[prefix_index].prefix_length + cleaved_result.suffixes.lengths[wm.suffix_area_start_index + k];
+    }
+    return result;
+}
+
+/*
+ * Writes the FSST+ corpus of strings whose prefixes and suffixes are already encoded, with the symbol tables of
+ * prefix_compression_result and suffix_compression_result, which the result then refers to.
+ */
+inline FSSTPlusCompressionResult FSSTPlusWrite(const size_t n, const std::vector<SimilarityChunk> &similarity_chunks, const CleavedResult &cleaved_result,
+                                               const CleavingRuns &runs, const size_t &block_granularity,
+                                               const FSSTCompressionResult &prefix_compression_result,
+                                               const FSSTCompressionResult &suffix_compression_result,
+                                               StageMeasurements &stages, MemoryFootprint &memory) {
+    FSSTPlusCompressionResult compression_result{};
+    compression_result.prefix_encoder = prefix_compression_result.encoder;
+    compression_result.suffix_encoder = suffix_compression_result.encoder;
+
+    // Allocate the maximum size possible for the corpus
+    size_t max_size = CalcMaxFSSTPlusDataSize(prefix_compression_result,suffix_compression_result, runs);
+    compression_result.data_start = ThreadArena().Allocate(max_size);
+    memory.prefix_fsst_bytes = CalcFSSTCompressionResultBytes(prefix_compression_result);
+    memory.suffix_fsst_bytes = CalcFSSTCompressionResultBytes(suffix_compression_result);
+    memory.fsst_plus_buffer_bytes = max_size;
+
+    // std::cout << "Data should start at: " << static_cast<void*>(compression_result.data_start) << '\n';
+    // std::cout << "and end at: " << static_cast<void*>(compression_result.data_start + max_size) << '\n';
+
+    /*
+     *  >>> WRITE GLOBAL HEADER <<<
+     *
+     * To write num_blocks, we must know how many blocks we have. But first let's
+     * calculate the size of each block (giving us also the number of blocks),
+     * allowing us to write block_start_offsets[] and data_end_offset also.
+     *
+     * decompressed_offsets[] follows data_end_offset, so that blocks can be decompressed independently
+     * (and in parallel) straight into their final position, see DecompressAllParallel(). Then come
+     * block_run_starts[], the first row of each block's cleaving run, and the validity bitmap of all rows.
+     */
+
+    const StageProbe sizing_probe;
+    FSSTPlusSizingResult sizing_result = SizeEverything(n, similarity_chunks, prefix_compression_result, suffix_compression_result, block_granularity, runs);
+    sizing_probe.Stop(stages.sizing);
+
+    uint8_t* global_header_ptr = compression_result.data_start;
+
+    // Now we can write!
+    const StageProbe writing_probe;
+
+    // A) write num_blocks
+    size_t n_blocks = sizing_result.block_sizes_pfx_summed.size();
+    Store<uint16_t>(n_blocks ,global_header_ptr);
+    global_header_ptr+=sizeof(uint16_t);
+
+    // B) write block_start_offsets[]
+    const size_t trailer_size = CalcGlobalHeaderTrailerSize(n_blocks, runs.num_rows);
+    for (size_t i = 0; i < n_blocks; i++) {
+        size_t offsets_to_go = (n_blocks - i); // count itself, so that the "base" begins at the offset's end
+        size_t global_header_size_ahead =
+                offsets_to_go * sizeof(uint32_t)
+                + sizeof(uint32_t) // data_end_offset size
+                + trailer_size;
+        const size_t total_block_size_ahead =  i == 0 ? 0 : sizing_result.block_sizes_pfx_summed[i-1];
+
+        Store<uint32_t>(global_header_size_ahead + total_block_size_ahead, global_header_ptr);
+        global_header_ptr +=sizeof(uint32_t);
+    }
+
+    // C) write data_end_offset
+    const size_t total_blocks_size = n_blocks == 0 ? 0 : sizing_result.block_sizes_pfx_summed.back(); // no blocks if all rows are NULL
+    Store<uint32_t>(total_blocks_size + sizeof(uint32_t) // count itself, so that the "base" begins at the offset's end
+                    + trailer_size
+                    ,global_header_ptr);
+    global_header_ptr +=sizeof(uint32_t);
+
+    // D) write decompressed_offsets[]: where each block's strings start in the decompressed corpus, the last one is the total
+    size_t decompressed_offset = 0;
+    for (size_t i = 0; i <= n_blocks; i++) {
+        if (decompressed_offset > UINT32_MAX) {
+            throw std::logic_error("FSST+ decompressed size exceeds the uint32 range of decompressed_offsets[]");
+        }
+        Store<uint32_t>(decompressed_offset, global_header_ptr);
+        global_header_ptr +=sizeof(uint32_t);
+        if (i < n_blocks) {
+            decompressed_offset += CalcBlockDecompressedSize(sizing_result.wms[i], similarity_chunks, cleaved_result);
+        }
+    }
+
+    // E) write block_run_starts[], so the decoder can put each block's strings back at their rows
+    for (size_t i = 0; i < n_blocks; i++) {
+        Store<uint32_t>(sizing_result.block_runs[i] * block_granularity, global_header_ptr);
+        global_header_ptr +=sizeof(uint32_t);
+    }
+
+    // F) write num_rows and the validity bitmap, NULL rows take up one bit and nothing else
+    if (runs.num_rows > UINT32_MAX) {
+        throw std::logic_error("FSST+ row count exceeds the uint32 range of num_rows");
+    }
+    Store<uint32_t>(runs.num_rows, global_header_ptr);
+    global_header_ptr +=sizeof(uint32_t);
+    memcpy(global_header_ptr, runs.validity.data(), runs.validity.size());
+    global_header_ptr += runs.validity.size();
+
+    uint8_t* next_block_start_ptr = global_header_ptr;
+
+    //  >>> WRITE BLOCKS <<<
+    for (size_t i = 0; i < sizing_result.wms.size(); i++) {
+        // use metadata to write correctly
+
+        // std::cout << "wm.prefix_area_size: " << sizing_result.wms[i].prefix_area_size << "\n";
+
+        // std::cout << "\n🧱 Block " << std::setw(3) << i << " start: " << static_cast<void*>(next_block_start_ptr) << '\n';
+        next_block_start_ptr = WriteBlock(next_block_start_ptr, prefix_compression_result, suffix_compression_result, sizing_result.wms[i], runs.row_permutation);
+    }
+
+    //  >>> WRITE ZONE MAP <<<
+    compression_result.zone_map_start = WriteZoneMap(sizing_result.wms, similarity_chunks, cleaved_result, compression_result.zone_map_end);
+    memory.fsst_plus_buffer_bytes += compression_result.zone_map_end - compression_result.zone_map_start;
+
+    //  >>> WRITE BLOOM FILTERS <<<
+    if (config::bloom_filter_bits_per_key > 0) {
+        compression_result.bloom_filter_start = WriteBloomFilters(sizing_result.wms, similarity_chunks, cleaved_result,
+                                                                  config::bloom_filter_bits_per_key, compression_result.bloom_filter_end);
+        memory.fsst_plus_buffer_bytes += compression_result.bloom_filter_end - compression_result.bloom_filter_start;
+    }
+    writing_probe.Stop(stages.writing);
+
+    compression_result.data_end = next_block_start_ptr;
+    return compression_result;
+}
+
+inline FSSTPlusCompressionResult FSSTPlusCompress(const size_t n, const std::vector<SimilarityChunk> &similarity_chunks, CleavedResult &cleaved_result, const CleavingRuns &runs, const size_t &block_granularity, StageMeasurements &stages, MemoryFootprint &memory) {
+    const FSSTCompressionResult prefix_compression_result = FSSTCompress(cleaved_result.prefixes, stages.prefix_training, stages.encode);
+    const FSSTCompressionResult suffix_compression_result = FSSTCompress(cleaved_result.suffixes, stages.suffix_training, stages.encode);
+    return FSSTPlusWrite(n, similarity_chunks, cleaved_result, runs, block_granularity, prefix_compression_result, suffix_compression_result,
+                         stages, memory);
+}
+
+// The whole pipeline, from similarity chunks over cleaving to FSSTPlusCompress(). Sorts input in place
+inline FSSTPlusCompressionResult CompressFSSTPlus(StringCollection &input, const size_t &block_granularity, StageMeasurements &stages,
+                                                  MemoryFootprint &memory) {
+    CleavingRuns runs;
+    const std::vector<SimilarityChunk> similarity_chunks = FormBlockwiseSimilarityChunks(input.lengths.size(), input, block_granularity, runs, stages);
+    const size_t n_strings = runs.first_strings.back(); // NULLs are out of the string stream from here on
+    const StageProbe cleave_probe;
+    CleavedResult cleaved_result = Cleave(input.lengths, input.string_ptrs, similarity_chunks, n_strings);
+    cleave_probe.Stop(stages.cleave);
+    memory.cleaved_bytes = CalcCleavedResultBytes(cleaved_result);
+    return FSSTPlusCompress(n_strings, similarity_chunks, cleaved_result, runs, block_granularity, stages, memory);
+}
+
+inline void RunDictionaryCompression(duckdb::Connection &con, ResultsBuffer &results, const string &column_name, const string &dataset_path, const size_t &n, const size_t &total_string_size, Metadata &metadata) {
     // Quote the column name to handle spaces and special characters correctly in the SQL query.
     const string quoted_column_name = "\"" + column_name + "\"";
     // const string query = "SELECT length(string_agg(DISTINCT " + quoted_column_name + ")) as dict_size, COUNT(DISTINCT " + quoted_column_name + ") as dist, ceil(log2(dist) / 8) as size_of_code, COUNT(" + quoted_column_name + ") * size_of_code as codes_size, CAST(dict_size + codes_size as BIGINT)  as total_compressed_size FROM read_parquet('"+dataset_path+"');";
@@ -90,22 +286,7 @@ inline void RunDictionaryCompression(duckdb::Connection &con, const string &colu
     double compression_factor = static_cast<double>(total_string_size) / static_cast<double>(*total_compressed_size);
 
     // Store results in the database
-    std::string insert_query = "INSERT INTO results VALUES ('" +
-                               metadata.dataset_folders + "', '" +
-                               metadata.dataset + "', '" +
-                               metadata.column + "', '" +
-                               metadata.algo + "', " +
-                               std::to_string(metadata.amount_of_rows) + ", " +
-                               std::to_string(0) + ", " +
-                               std::to_string(compression_factor) + ", " +
-                               std::to_string(n) + ", " +
-                               std::to_string(total_string_size) + ");";
-
-    try {
-        con.Query(insert_query);
-        std::cout << "Inserted result for " << metadata.dataset << "." << column_name << std::endl;
-    } catch (std::exception& e) {
-        std::cerr << "🚨 Failed to insert result: " << e.what() << std::endl;
-    }
-
+    ResetRunMetrics(metadata);
+    metadata.compression_factor = compression_factor;
+    results.Add(metadata, n, total_string_size);
 };
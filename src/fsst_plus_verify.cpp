@@ -0,0 +1,89 @@
+#include "config.h"
+#include "duckdb.hpp"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "fsst_plus.h"
+#include "cleaving.h"
+#include "fsst_plus_verify.h"
+
+namespace config {
+    constexpr size_t total_strings = 100000;
+    constexpr bool print_sorted_corpus = false;
+    constexpr bool print_split_points = false;
+    constexpr bool print_decompressed_corpus = false;
+}
+
+/*
+ * Compresses a string column one row group (config::amount_strings_per_symbol_table rows) at a time and validates
+ * every freshly written corpus with fsst_plus_verify.h: the structure of the corpus, zone map and Bloom filters, then
+ * the decompressed size of every block, and reports how long each pass takes. Exits with 1 on the first invalid corpus.
+ *
+ * Usage: fsst_plus_verify <parquet file> <column>
+ */
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <parquet file> <column>" << std::endl;
+        return 1;
+    }
+    const std::string dataset_path = argv[1];
+    const std::string column_name = argv[2];
+    constexpr size_t block_granularity = 128;
+
+    duckdb::DuckDB db(nullptr);
+    duckdb::Connection con(db);
+    for (size_t row_group = 0;; row_group++) {
+        const auto result = con.Query("SELECT \"" + column_name + "\" FROM read_parquet('" + dataset_path + "') LIMIT " +
+                                      std::to_string(config::amount_strings_per_symbol_table) + " OFFSET " +
+                                      std::to_string(row_group * config::amount_strings_per_symbol_table));
+        if (result->HasError()) {
+            std::cerr << "Failed to read " << dataset_path << ": " << result->GetError() << std::endl;
+            return 1;
+        }
+        auto data_chunk = result->Fetch();
+        if (!data_chunk || data_chunk->size() == 0) {
+            break;
+        }
+        const size_t n = result->RowCount();
+        StringCollection input = RetrieveData(result, data_chunk, n);
+
+        StageMeasurements stages;
+        MemoryFootprint memory;
+        const FSSTPlusCompressionResult compression_result = CompressFSSTPlus(input, block_granularity, stages, memory);
+        const fsst_decoder_t prefix_decoder = fsst_decoder(compression_result.prefix_encoder);
+        const fsst_decoder_t suffix_decoder = fsst_decoder(compression_result.suffix_encoder);
+
+        bool valid = true;
+        const auto start_time = std::chrono::high_resolution_clock::now();
+        try {
+            VerifyFSSTPlusCompressionResult(compression_result);
+        } catch (std::logic_error &e) {
+            std::cerr << "Row group " << row_group << ": " << e.what() << std::endl;
+            valid = false;
+        }
+        const auto structure_time = std::chrono::high_resolution_clock::now();
+        if (valid) {
+            try {
+                VerifyFSSTPlusDecompressedSizes(compression_result.data_start, prefix_decoder, suffix_decoder);
+            } catch (std::logic_error &e) {
+                std::cerr << "Row group " << row_group << ": " << e.what() << std::endl;
+                valid = false;
+            }
+        }
+        const auto end_time = std::chrono::high_resolution_clock::now();
+
+        printf("Row group %zu: %zu rows, %u blocks, %zu bytes: %s (structure %.3f ms, decompressed sizes %.3f ms)\n", row_group, n,
+               Load<uint16_t>(compression_result.data_start), static_cast<size_t>(compression_result.data_end - compression_result.data_start),
+               valid ? "valid" : "INVALID", std::chrono::duration<double, std::milli>(structure_time - start_time).count(),
+               std::chrono::duration<double, std::milli>(end_time - structure_time).count());
+        fsst_destroy(compression_result.prefix_encoder);
+        fsst_destroy(compression_result.suffix_encoder);
+        ThreadArena().Reset();
+        if (!valid) {
+            return 1;
+        }
+    }
+    return 0;
+}
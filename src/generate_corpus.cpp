@@ -0,0 +1,141 @@
+#include "config.h"
+#include "duckdb.hpp"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "synthetic_corpus.h"
+
+/*
+ * Writes a parquet file of synthetic string columns (see synthetic_corpus.h), one VARCHAR column per requested kind,
+ * for scaling studies without the refined datasets. The same arguments always give the same file contents; every
+ * column gets its own seed derived from --seed. Meant for 10K to 100M rows: rows go through a scratch on-disk DuckDB
+ * database next to the output, so the corpus never has to fit in memory.
+ *
+ * Usage: generate_corpus <output parquet> <rows> [--seed=42] [--columns=url,path,email,uuid,log,category]
+ *        [--prefix-sharing=0.5] [--min-tail=4] [--max-tail=16] [--duplicate-rate=0.1] [--null-rate=0] [--cardinality=16]
+ *
+ * The result can be benchmarked like any refined dataset, e.g. put it under <project dir>/benchmarking/data/refined, or
+ * with "fsst_plus <num_threads> <dir> <rows per column>" to go past the default bound of config::total_strings rows.
+ */
+
+inline bool ParseOption(const std::string &argument, const std::string &name, std::string &value) {
+    const std::string flag = "--" + name + "=";
+    if (argument.compare(0, flag.size(), flag) != 0) {
+        return false;
+    }
+    value = argument.substr(flag.size());
+    return true;
+}
+
+inline std::vector<std::string> SplitList(const std::string &list) {
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        items.push_back(item);
+    }
+    return items;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <output parquet> <rows> [--seed=42] [--columns=url,path,email,uuid,log,category] "
+                  "[--prefix-sharing=0.5] [--min-tail=4] [--max-tail=16] [--duplicate-rate=0.1] [--null-rate=0] [--cardinality=16]"
+                  << std::endl;
+        return 1;
+    }
+    const std::string output_path = argv[1];
+    SyntheticCorpusOptions options;
+    const size_t rows = std::stoull(argv[2]);
+    std::vector<SyntheticColumn> columns(std::begin(synthetic_columns), std::end(synthetic_columns));
+    for (int i = 3; i < argc; i++) {
+        const std::string argument = argv[i];
+        std::string value;
+        if (ParseOption(argument, "seed", value)) {
+            options.seed = std::stoull(value);
+        } else if (ParseOption(argument, "columns", value)) {
+            columns.clear();
+            for (const std::string &name : SplitList(value)) {
+                SyntheticColumn column;
+                if (!ParseSyntheticColumn(name, column)) {
+                    std::cerr << "Unknown column kind: " << name << std::endl;
+                    return 1;
+                }
+                columns.push_back(column);
+            }
+        } else if (ParseOption(argument, "prefix-sharing", value)) {
+            options.prefix_sharing = std::stod(value);
+        } else if (ParseOption(argument, "min-tail", value)) {
+            options.min_tail_length = std::stoull(value);
+        } else if (ParseOption(argument, "max-tail", value)) {
+            options.max_tail_length = std::stoull(value);
+        } else if (ParseOption(argument, "duplicate-rate", value)) {
+            options.duplicate_rate = std::stod(value);
+        } else if (ParseOption(argument, "null-rate", value)) {
+            options.null_rate = std::stod(value);
+        } else if (ParseOption(argument, "cardinality", value)) {
+            options.cardinality = std::stoull(value);
+        } else {
+            std::cerr << "Unknown argument: " << argument << std::endl;
+            return 1;
+        }
+    }
+    if (columns.empty()) {
+        std::cerr << "No columns to generate" << std::endl;
+        return 1;
+    }
+
+    std::vector<SyntheticCorpusGenerator> generators;
+    std::string create_table = "CREATE TABLE corpus (";
+    for (size_t i = 0; i < columns.size(); i++) {
+        SyntheticCorpusOptions column_options = options;
+        column_options.column = columns[i];
+        column_options.seed = SplitMix64(options.seed + i);
+        generators.push_back(SyntheticCorpusGenerator(column_options));
+        create_table += (i == 0 ? "" : ", ") + std::string(SyntheticColumnName(columns[i])) + " VARCHAR";
+        printf("%s: %zu stems per %zu rows\n", SyntheticColumnName(columns[i]), generators.back().StemsPerWindow(),
+               columns[i] == SyntheticColumn::CATEGORICAL ? rows : config::synthetic_stem_window);
+    }
+    create_table += ")";
+
+    const std::string scratch_path = output_path + ".tmp.duckdb";
+    std::remove(scratch_path.c_str());
+    std::remove((scratch_path + ".wal").c_str());
+    const auto start_time = std::chrono::high_resolution_clock::now();
+    {
+        duckdb::DuckDB db(scratch_path);
+        duckdb::Connection con(db);
+        con.Query(create_table);
+        {
+            duckdb::Appender appender(con, "corpus");
+            std::string value;
+            for (size_t row = 0; row < rows; row++) {
+                appender.BeginRow();
+                for (SyntheticCorpusGenerator &generator : generators) {
+                    if (generator.Next(value)) {
+                        appender.Append(duckdb::string_t(value.data(), value.size()));
+                    } else {
+                        appender.Append(duckdb::Value());
+                    }
+                }
+                appender.EndRow();
+            }
+            appender.Close();
+        }
+        const auto copy = con.Query("COPY corpus TO '" + output_path + "' (FORMAT 'parquet', ROW_GROUP_SIZE " +
+                                    std::to_string(config::amount_strings_per_symbol_table) + ")");
+        if (copy->HasError()) {
+            std::cerr << "Failed to write " << output_path << ": " << copy->GetError() << std::endl;
+            return 1;
+        }
+    }
+    std::remove(scratch_path.c_str());
+    std::remove((scratch_path + ".wal").c_str());
+    const auto end_time = std::chrono::high_resolution_clock::now();
+    printf("Wrote %zu rows to %s in %.1f s\n", rows, output_path.c_str(),
+           std::chrono::duration<double>(end_time - start_time).count());
+    return 0;
+}
@@ -1,16 +1,90 @@
 #pragma once
 #include <cstddef>
+#include <cstdint>
 #include <string>
 
+// Hardware counters of the calling thread, as collected by PerfCounterGroup (see perf_counters.h)
+struct PerfCounterValues {
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    uint64_t l1d_misses = 0;
+    uint64_t llc_misses = 0;
+    uint64_t branch_misses = 0;
+};
+
+// Wall-clock time (ms) and hardware counters of one pipeline stage, summed over all its invocations
+struct StageMeasurement {
+    double time_ms = 0;
+    PerfCounterValues counters;
+};
+
+struct StageMeasurements {
+    StageMeasurement sort;
+    StageMeasurement chunking; // FormSimilarityChunks() dynamic program
+    StageMeasurement cleave;
+    StageMeasurement prefix_training; // fsst_create() on the prefixes
+    StageMeasurement suffix_training; // fsst_create() on the suffixes
+    StageMeasurement encode; // fsst_compress() of both prefixes and suffixes
+    StageMeasurement sizing;
+    StageMeasurement writing;
+    StageMeasurement decompression;
+};
+
+// Bytes held by each copy of a column on its way through the FSST+ pipeline
+struct MemoryFootprint {
+    size_t input_bytes = 0; // StringCollection with the original strings
+    size_t cleaved_bytes = 0; // CleavedResult, pointers and lengths of prefixes and suffixes
+    size_t prefix_fsst_bytes = 0; // FSSTCompress() output buffer and encoded pointers/lengths of the prefixes
+    size_t suffix_fsst_bytes = 0; // same, for the suffixes
+    size_t fsst_plus_buffer_bytes = 0; // CalcMaxFSSTPlusDataSize() allocation
+    size_t decompression_buffer_bytes = 0;
+    size_t arena_bytes = 0; // capacity of the worker's arena after the column, all of the above come from it
+    long rss_delta_bytes = 0; // growth of the process' current RSS until the column's buffers are all held, 0 unless one worker runs
+};
+
 struct Metadata {
     size_t global_index = 0;
 
     std::string dataset_folders = "";
     std::string dataset = "";
     std::string column = "";
+    size_t row_group = 0;
     std::string algo = "";
 
     size_t amount_of_rows = 0;
     double run_time_ms = 0;
     double compression_factor = 0;
+
+    StageMeasurements stages;
+    uint8_t perf_counters_available = 0; // bitmask of PerfCounter, 0 if hardware counters were not collected
+    double decompression_mb_s = 0;
+    double decompression_strings_per_s = 0;
+    size_t decompression_threads = 0; // threads decoding blocks in the decompression benchmark
+    size_t permutation_bytes = 0; // stored row permutation, included in compression_factor (row group sorted FSST+ only)
+    size_t bloom_filter_bytes = 0; // per-block Bloom filters next to the corpus, not included in compression_factor
+    double bloom_filter_fpr = 0; // their measured false-positive rate
+    std::string storage_codec = ""; // compression DuckDB applied to its segments (DuckDB baselines only)
+    size_t storage_bytes = 0; // bytes of those segments on disk including storage_slack_bytes
+    size_t storage_slack_bytes = 0; // part of storage_bytes that is free block space, compression_factor is taken without it
+    double duckdb_best_compression_factor = 0; // best DuckDB baseline of the same row group, 0 if none ran
+
+    MemoryFootprint memory;
 };
+
+// Clears what one algorithm measured, before the next one runs on the same row group. Keeps the row group's identity
+inline void ResetRunMetrics(Metadata &metadata) {
+    metadata.run_time_ms = 0;
+    metadata.compression_factor = 0;
+    metadata.stages = StageMeasurements{};
+    metadata.perf_counters_available = 0;
+    metadata.decompression_mb_s = 0;
+    metadata.decompression_strings_per_s = 0;
+    metadata.decompression_threads = 0;
+    metadata.permutation_bytes = 0;
+    metadata.bloom_filter_bytes = 0;
+    metadata.bloom_filter_fpr = 0;
+    metadata.storage_codec = "";
+    metadata.storage_bytes = 0;
+    metadata.storage_slack_bytes = 0;
+    metadata.memory = MemoryFootprint{};
+}
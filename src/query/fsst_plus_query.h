@@ -0,0 +1,156 @@
+#pragma once
+#include <cstring>
+#include <string>
+#include <vector>
+#include "fsst_plus_segment.h"
+#include "zone_map.h"
+
+/*
+ * The queries of query_benchmark on an FSSTPlusSegment, each returning what the matching SQL query over DuckDB
+ * returns, so both can be checked against each other:
+ *   FSSTPlusSumLengths()   SELECT SUM(strlen(s)) FROM t
+ *   FSSTPlusCountPrefix()  SELECT COUNT(*) FROM t WHERE s LIKE 'prefix%'
+ *   FSSTPlusCountInfix()   SELECT COUNT(*) FROM t WHERE s LIKE '%infix%'
+ *   FSSTPlusCountEquals()  SELECT COUNT(*) FROM t WHERE s = 'value'
+ *   FSSTPlusCountGroups()  SELECT COUNT(*) FROM (SELECT s, COUNT(*) FROM t GROUP BY s)
+ * Filters go through the segment's zone map and Bloom filters where they can skip blocks, the rest decodes everything.
+ */
+
+// Output buffers of one reader, sized once for the segment and reused by all its queries
+struct FSSTPlusQueryScratch {
+    std::vector<unsigned char> out;
+    std::vector<const unsigned char *> out_ptrs; // one per row, as DecompressAll() expects
+    std::vector<size_t> out_lengths;
+    std::vector<uint32_t> matching_rows; // rows a filtered scan returns, with their strings
+    std::vector<const unsigned char *> matching_ptrs;
+    std::vector<size_t> matching_lengths;
+    std::vector<uint64_t> hashes; // HashAll() of every row, for GROUP BY
+    std::vector<uint32_t> group_slots; // GROUP BY hash table, row + 1 of each group's first string, 0 if empty
+
+    explicit FSSTPlusQueryScratch(const FSSTPlusSegment &segment)
+        : out(segment.DecompressAllCapacity()), out_ptrs(segment.NumRows()), out_lengths(segment.NumRows()), hashes(segment.NumRows()) {}
+};
+
+inline size_t FSSTPlusSumLengths(const FSSTPlusSegment &segment, FSSTPlusQueryScratch &scratch) {
+    return segment.DecompressAll(scratch.out.data(), scratch.out.size(), scratch.out_ptrs, scratch.out_lengths);
+}
+
+/*
+ * The strings starting with prefix are those in [prefix, upper): upper is prefix without its trailing 0xFF bytes and
+ * the last remaining byte incremented. Returns false if there is no such upper bound (prefix is all 0xFF).
+ */
+inline bool PrefixUpperBound(const unsigned char *prefix, const size_t length, std::string &upper) {
+    upper.assign(reinterpret_cast<const char *>(prefix), length);
+    while (!upper.empty() && static_cast<unsigned char>(upper.back()) == UINT8_MAX) {
+        upper.pop_back();
+    }
+    if (upper.empty()) {
+        return false;
+    }
+    upper.back() = static_cast<char>(static_cast<unsigned char>(upper.back()) + 1);
+    return true;
+}
+
+inline size_t FSSTPlusCountPrefix(const FSSTPlusSegment &segment, const unsigned char *prefix, const size_t length,
+                                  FSSTPlusQueryScratch &scratch) {
+    std::string upper;
+    ZoneMapFilter filter = ZoneMapGreater(prefix, length, true);
+    if (PrefixUpperBound(prefix, length, upper)) {
+        filter.upper = reinterpret_cast<const unsigned char *>(upper.data());
+        filter.upper_length = upper.size();
+        filter.has_upper = true;
+        filter.upper_inclusive = false;
+    }
+    segment.ZoneMapScan(filter, scratch.out.data(), scratch.out.data() + scratch.out.size(), scratch.matching_rows, scratch.matching_ptrs,
+                        scratch.matching_lengths);
+    return scratch.matching_rows.size();
+}
+
+inline bool ContainsBytes(const unsigned char *str, const size_t length, const unsigned char *needle, const size_t needle_length) {
+    if (needle_length == 0) {
+        return true;
+    }
+    const unsigned char *end = str + length;
+    for (const unsigned char *p = str; static_cast<size_t>(end - p) >= needle_length; p++) {
+        p = static_cast<const unsigned char *>(memchr(p, needle[0], end - p - needle_length + 1));
+        if (p == nullptr) {
+            return false;
+        }
+        if (memcmp(p, needle, needle_length) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The zone map cannot rule out a block for an infix, every string is decoded and searched
+inline size_t FSSTPlusCountInfix(const FSSTPlusSegment &segment, const unsigned char *infix, const size_t length,
+                                 FSSTPlusQueryScratch &scratch) {
+    segment.DecompressAll(scratch.out.data(), scratch.out.size(), scratch.out_ptrs, scratch.out_lengths);
+    size_t count = 0;
+    for (size_t row = 0; row < segment.NumRows(); row++) {
+        count += scratch.out_ptrs[row] != nullptr && ContainsBytes(scratch.out_ptrs[row], scratch.out_lengths[row], infix, length);
+    }
+    return count;
+}
+
+// Through the Bloom filters, or the zone map if the segment was written without them
+inline size_t FSSTPlusCountEquals(const FSSTPlusSegment &segment, const unsigned char *value, const size_t length,
+                                  FSSTPlusQueryScratch &scratch) {
+    if (segment.HasBloomFilters()) {
+        segment.Lookup(value, length, scratch.out.data(), scratch.out.data() + scratch.out.size(), scratch.matching_rows);
+    } else {
+        segment.ZoneMapScan(ZoneMapEquals(value, length), scratch.out.data(), scratch.out.data() + scratch.out.size(),
+                            scratch.matching_rows, scratch.matching_ptrs, scratch.matching_lengths);
+    }
+    return scratch.matching_rows.size();
+}
+
+/*
+ * Distinct strings, with NULL as a group of its own like in SQL, counted in an open-addressing table of rows keyed by
+ * their HashAll() hashes, which hash each prefix once for its whole similarity chunk. Rows whose hashes differ are
+ * different strings without looking at them. Only rows with equal hashes are compared on their decoded strings, and the
+ * column is decoded the first time that happens, so a column of distinct strings is never decoded at all.
+ */
+inline size_t FSSTPlusCountGroups(const FSSTPlusSegment &segment, FSSTPlusQueryScratch &scratch) {
+    const size_t n = segment.NumRows();
+    segment.HashAll(scratch.hashes);
+    size_t n_slots = 1;
+    while (n_slots < 2 * n) {
+        n_slots <<= 1;
+    }
+    scratch.group_slots.assign(n_slots, 0);
+
+    bool decoded = false;
+    const auto same_string = [&](const size_t row, const size_t other_row) {
+        if (!decoded) {
+            segment.DecompressAll(scratch.out.data(), scratch.out.size(), scratch.out_ptrs, scratch.out_lengths);
+            decoded = true;
+        }
+        return scratch.out_lengths[row] == scratch.out_lengths[other_row] &&
+               memcmp(scratch.out_ptrs[row], scratch.out_ptrs[other_row], scratch.out_lengths[row]) == 0;
+    };
+
+    size_t groups = 0;
+    bool has_null = false;
+    const uint8_t *validity = segment.Validity();
+    for (size_t row = 0; row < n; row++) {
+        if (!RowIsValid(validity, row)) {
+            has_null = true;
+            continue;
+        }
+        const uint64_t hash = scratch.hashes[row];
+        for (size_t slot = hash & (n_slots - 1);; slot = (slot + 1) & (n_slots - 1)) {
+            const uint32_t entry = scratch.group_slots[slot];
+            if (entry == 0) {
+                scratch.group_slots[slot] = row + 1;
+                groups++;
+                break;
+            }
+            if (scratch.hashes[entry - 1] == hash && same_string(row, entry - 1)) {
+                break;
+            }
+        }
+    }
+    return groups + has_null;
+}
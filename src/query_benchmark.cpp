@@ -0,0 +1,380 @@
+#include "config.h"
+#include "duckdb.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "fsst_plus.h"
+#include "cleaving.h"
+#include "duckdb_codecs.h"
+#include "env.h"
+#include "fsst_plus_segment.h"
+#include "fsst_plus_query.h"
+
+namespace config {
+    constexpr size_t total_strings = 100000;
+    constexpr bool print_sorted_corpus = false;
+    constexpr bool print_split_points = false;
+    constexpr bool print_decompressed_corpus = false;
+}
+
+/*
+ * End-to-end query latency of FSST+ against DuckDB's own storage. For one row group of each string column, the
+ * queries of fsst_plus_query.h run config::query_benchmark_runs times each on an FSSTPlusSegment and on on-disk DuckDB
+ * tables, one with the compression DuckDB picks itself ("auto") and one per codec of config::duckdb_codecs. Everything
+ * is single-threaded. Each run of a filter query takes its own parameter drawn from a random non-NULL row: the first
+ * half of the string for LIKE 'prefix%', config::query_benchmark_infix_length bytes from its middle for LIKE '%infix%',
+ * the string itself for the equality.
+ *
+ * Reports p50 and p99 latency and the throughput at the median (rows/s, and MB/s of the uncompressed column), and
+ * checks every FSST+ answer against DuckDB's. Exits with 1 if they ever differ. The same numbers go into a
+ * query_results table, saved to benchmarking/results/query_benchmark.parquet under env::project_dir.
+ *
+ * Usage: query_benchmark <parquet file> [column]
+ */
+
+enum class Query { SCAN, LIKE_PREFIX, LIKE_INFIX, EQUALS, GROUP_BY };
+
+const Query queries[] = {Query::SCAN, Query::LIKE_PREFIX, Query::LIKE_INFIX, Query::EQUALS, Query::GROUP_BY};
+
+inline const char *QueryName(const Query query) {
+    switch (query) {
+        case Query::SCAN: return "scan";
+        case Query::LIKE_PREFIX: return "like_prefix";
+        case Query::LIKE_INFIX: return "like_infix";
+        case Query::EQUALS: return "equals";
+        case Query::GROUP_BY: return "group_by";
+    }
+    return "";
+}
+
+// Parameter of every run of a filter query
+struct QueryParameters {
+    std::vector<std::string> prefixes;
+    std::vector<std::string> infixes;
+    std::vector<std::string> values;
+
+    const std::string &Get(const Query query, const size_t run) const {
+        static const std::string none;
+        switch (query) {
+            case Query::LIKE_PREFIX: return prefixes[run];
+            case Query::LIKE_INFIX: return infixes[run];
+            case Query::EQUALS: return values[run];
+            default: return none;
+        }
+    }
+};
+
+// Shortens length so that str[0, length) does not end inside a UTF-8 character, DuckDB rejects such literals
+inline size_t Utf8Boundary(const std::string &str, size_t length) {
+    while (length > 0 && length < str.size() && (static_cast<unsigned char>(str[length]) & 0xC0) == 0x80) {
+        length--;
+    }
+    return length;
+}
+
+inline QueryParameters DrawQueryParameters(const StringCollection &input, const size_t n) {
+    std::vector<size_t> candidates;
+    for (size_t i = 0; i < n; i++) {
+        if (input.string_ptrs[i] != nullptr && input.lengths[i] >= 2) {
+            candidates.push_back(i);
+        }
+    }
+    QueryParameters parameters;
+    if (candidates.empty()) {
+        return parameters;
+    }
+    std::mt19937_64 rng(config::query_benchmark_seed);
+    for (size_t run = 0; run < config::query_benchmark_runs; run++) {
+        const size_t row = candidates[rng() % candidates.size()];
+        const std::string str(reinterpret_cast<const char *>(input.string_ptrs[row]), input.lengths[row]);
+        // A first character longer than the cut takes the whole string instead
+        const size_t half = Utf8Boundary(str, str.size() / 2);
+        parameters.prefixes.push_back(half == 0 ? str : str.substr(0, half));
+        const std::string tail = str.substr(half);
+        const size_t infix_length = Utf8Boundary(tail, config::query_benchmark_infix_length);
+        parameters.infixes.push_back(infix_length == 0 ? tail : tail.substr(0, infix_length));
+        parameters.values.push_back(str);
+    }
+    return parameters;
+}
+
+inline std::string SQLString(const std::string &str) {
+    std::string quoted = "'";
+    for (const char c : str) {
+        quoted += c == '\'' ? "''" : std::string(1, c);
+    }
+    return quoted + "'";
+}
+
+// str as part of a LIKE pattern with ESCAPE '\'
+inline std::string EscapeLike(const std::string &str) {
+    std::string escaped;
+    for (const char c : str) {
+        if (c == '%' || c == '_' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+inline std::string QuerySQL(const Query query, const std::string &parameter) {
+    switch (query) {
+        case Query::SCAN: return "SELECT COALESCE(SUM(strlen(s)), 0)::BIGINT FROM t";
+        case Query::LIKE_PREFIX: return "SELECT COUNT(*) FROM t WHERE s LIKE " + SQLString(EscapeLike(parameter) + "%") + " ESCAPE '\\'";
+        case Query::LIKE_INFIX: return "SELECT COUNT(*) FROM t WHERE s LIKE " + SQLString("%" + EscapeLike(parameter) + "%") + " ESCAPE '\\'";
+        case Query::EQUALS: return "SELECT COUNT(*) FROM t WHERE s = " + SQLString(parameter);
+        case Query::GROUP_BY: return "SELECT COUNT(*) FROM (SELECT s, COUNT(*) FROM t GROUP BY s)";
+    }
+    return "";
+}
+
+inline size_t RunDuckDBQuery(duckdb::Connection &con, const Query query, const std::string &parameter) {
+    const auto result = con.Query(QuerySQL(query, parameter));
+    if (result->HasError()) {
+        throw std::logic_error(std::string(QueryName(query)) + " failed: " + result->GetError());
+    }
+    return result->GetValue(0, 0).GetValue<int64_t>();
+}
+
+inline size_t RunFSSTPlusQuery(const FSSTPlusSegment &segment, FSSTPlusQueryScratch &scratch, const Query query, const std::string &parameter) {
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(parameter.data());
+    switch (query) {
+        case Query::SCAN: return FSSTPlusSumLengths(segment, scratch);
+        case Query::LIKE_PREFIX: return FSSTPlusCountPrefix(segment, p, parameter.size(), scratch);
+        case Query::LIKE_INFIX: return FSSTPlusCountInfix(segment, p, parameter.size(), scratch);
+        case Query::EQUALS: return FSSTPlusCountEquals(segment, p, parameter.size(), scratch);
+        case Query::GROUP_BY: return FSSTPlusCountGroups(segment, scratch);
+    }
+    return 0;
+}
+
+// Column names and SQL types of the query_results table, in the order BenchmarkColumn() appends them
+const std::pair<const char *, const char *> query_results_schema[] = {
+    {"dataset", "VARCHAR"},
+    {"col_name", "VARCHAR"},
+    {"num_strings", "BIGINT"},
+    {"original_size", "BIGINT"},
+    {"engine", "VARCHAR"},
+    {"compressed_bytes", "BIGINT"},
+    {"query", "VARCHAR"},
+    {"runs", "BIGINT"},
+    {"p50_ms", "DOUBLE"},
+    {"p99_ms", "DOUBLE"},
+    {"rows_per_s", "DOUBLE"},
+    {"mb_s", "DOUBLE"},
+};
+
+// One engine and query of a column, the line BenchmarkEngine() prints
+struct QueryResult {
+    std::string engine;
+    size_t compressed_bytes;
+    Query query;
+    double p50_ms;
+    double p99_ms;
+    double rows_per_s;
+    double mb_s;
+};
+
+// Nearest-rank percentile, sorts latencies
+inline double Percentile(std::vector<double> &latencies, const double p) {
+    std::sort(latencies.begin(), latencies.end());
+    const size_t rank = static_cast<size_t>(std::ceil(p * static_cast<double>(latencies.size())));
+    return latencies[std::max<size_t>(rank, 1) - 1];
+}
+
+/*
+ * Times config::query_benchmark_runs runs of every query with run_query(query, parameter), after one untimed warm-up
+ * run each, and prints and adds to results a line per query. answers[query][run] holds the first answer of each run,
+ * later engines are checked against them. Returns the number of differing answers.
+ */
+template <typename RunQuery>
+size_t BenchmarkEngine(const std::string &engine, const size_t compressed_bytes, const RunQuery &run_query, const QueryParameters &parameters,
+                       const size_t n, const size_t total_string_size, std::vector<std::vector<size_t> > &answers,
+                       std::vector<QueryResult> &results) {
+    answers.resize(sizeof(queries) / sizeof(queries[0]));
+    size_t mismatches = 0;
+    for (const Query query : queries) {
+        const bool has_parameter = query == Query::LIKE_PREFIX || query == Query::LIKE_INFIX || query == Query::EQUALS;
+        if (has_parameter && parameters.values.empty()) {
+            continue;
+        }
+        std::vector<size_t> &query_answers = answers[static_cast<size_t>(query)];
+        run_query(query, parameters.Get(query, 0));
+
+        std::vector<double> latencies;
+        for (size_t run = 0; run < config::query_benchmark_runs; run++) {
+            const std::string &parameter = parameters.Get(query, has_parameter ? run : 0);
+            const auto start_time = std::chrono::high_resolution_clock::now();
+            const size_t answer = run_query(query, parameter);
+            const auto end_time = std::chrono::high_resolution_clock::now();
+            latencies.push_back(std::chrono::duration<double, std::milli>(end_time - start_time).count());
+
+            if (run == query_answers.size()) {
+                query_answers.push_back(answer);
+            } else if (answer != query_answers[run]) {
+                std::cerr << engine << " " << QueryName(query) << " run " << run << ": " << answer << " instead of " << query_answers[run]
+                          << std::endl;
+                mismatches++;
+            }
+        }
+        const double p99_ms = Percentile(latencies, 0.99);
+        const double p50_ms = Percentile(latencies, 0.5);
+        const QueryResult result{engine, compressed_bytes, query, p50_ms, p99_ms, static_cast<double>(n) / (p50_ms / 1e3),
+                                 static_cast<double>(total_string_size) / 1e6 / (p50_ms / 1e3)};
+        printf("%-24s %12zu %-12s %10.3f %10.3f %14.0f %10.1f\n", engine.c_str(), compressed_bytes, QueryName(query), p50_ms, p99_ms,
+               result.rows_per_s, result.mb_s);
+        results.push_back(result);
+    }
+    return mismatches;
+}
+
+/*
+ * Benchmarks one row group of column and appends its results to the query_results table. Returns the number of FSST+
+ * answers that differ from DuckDB's.
+ */
+inline size_t BenchmarkColumn(duckdb::Connection &con, duckdb::Appender &appender, const std::string &dataset_path,
+                              const std::string &column_name) {
+    constexpr size_t block_granularity = 128;
+    const auto result = con.Query("SELECT \"" + column_name + "\" FROM read_parquet('" + dataset_path + "') LIMIT " +
+                                  std::to_string(config::amount_strings_per_symbol_table));
+    if (result->HasError()) {
+        throw std::logic_error("Failed to read " + dataset_path + ": " + result->GetError());
+    }
+    auto data_chunk = result->Fetch();
+    if (!data_chunk || data_chunk->size() == 0) {
+        std::cout << "No data for column: " << column_name << std::endl;
+        return 0;
+    }
+    const size_t n = result->RowCount();
+    StringCollection input = RetrieveData(result, data_chunk, n);
+    size_t total_string_size = 0;
+    for (const size_t length : input.lengths) {
+        total_string_size += length;
+    }
+    const QueryParameters parameters = DrawQueryParameters(input, n);
+
+    printf("\n%s, column %s: %zu rows, %zu bytes\n", dataset_path.c_str(), column_name.c_str(), n, total_string_size);
+    printf("%-24s %12s %-12s %10s %10s %14s %10s\n", "engine", "bytes", "query", "p50 ms", "p99 ms", "rows/s", "MB/s");
+
+    // DuckDB first, the FSST+ pipeline below reorders input
+    std::vector<std::vector<size_t> > answers;
+    std::vector<QueryResult> results;
+    size_t mismatches = 0;
+    std::vector<std::string> codecs(1, "auto");
+    codecs.insert(codecs.end(), std::begin(config::duckdb_codecs), std::end(config::duckdb_codecs));
+    for (const std::string &codec : codecs) {
+        const std::string path = DuckDBCodecDatabasePath(codec);
+        RemoveDuckDBCodecDatabase(path);
+        try {
+            duckdb::DuckDB codec_db(path);
+            duckdb::Connection codec_con(codec_db);
+            LoadDuckDBCodecTable(codec_con, input, n, codec);
+            DuckDBCodecMeasurement measurement;
+            CalcStorageBytes(codec_con, measurement);
+            const std::string engine = "duckdb_" + codec + (measurement.compression == codec ? "" : "(" + measurement.compression + ")");
+            mismatches += BenchmarkEngine(engine, CalcAttributableBytes(measurement), [&](const Query query, const std::string &parameter) {
+                return RunDuckDBQuery(codec_con, query, parameter);
+            }, parameters, n, total_string_size, answers, results);
+        } catch (std::exception &e) {
+            std::cerr << "Skipping DuckDB codec " << codec << ": " << e.what() << std::endl;
+        }
+        RemoveDuckDBCodecDatabase(path);
+    }
+
+    StageMeasurements stages;
+    MemoryFootprint memory;
+    const FSSTPlusSegment segment(CompressFSSTPlus(input, block_granularity, stages, memory));
+    ThreadArena().Reset();
+    FSSTPlusQueryScratch scratch(segment);
+    mismatches += BenchmarkEngine("fsstplus", segment.BufferSize(), [&](const Query query, const std::string &parameter) {
+        return RunFSSTPlusQuery(segment, scratch, query, parameter);
+    }, parameters, n, total_string_size, answers, results);
+
+    for (const QueryResult &result : results) {
+        appender.BeginRow();
+        appender.Append(dataset_path.c_str());
+        appender.Append(column_name.c_str());
+        appender.Append<int64_t>(n);
+        appender.Append<int64_t>(total_string_size);
+        appender.Append(result.engine.c_str());
+        appender.Append<int64_t>(result.compressed_bytes);
+        appender.Append(QueryName(result.query));
+        appender.Append<int64_t>(config::query_benchmark_runs);
+        appender.Append<double>(result.p50_ms);
+        appender.Append<double>(result.p99_ms);
+        appender.Append<double>(result.rows_per_s);
+        appender.Append<double>(result.mb_s);
+        appender.EndRow();
+    }
+    return mismatches;
+}
+
+// Writes the query_results table to benchmarking/results/query_benchmark.parquet
+inline void SaveQueryResults(duckdb::Connection &con) {
+    const std::string results_dir = env::project_dir + "/benchmarking/results";
+    system(("mkdir -p " + results_dir).c_str());
+    const std::string path = results_dir + "/query_benchmark.parquet";
+    const auto result = con.Query("COPY query_results TO '" + path + "' (FORMAT 'parquet', OVERWRITE TRUE)");
+    if (result->HasError()) {
+        std::cerr << "Failed to save results to " << path << ": " << result->GetError() << std::endl;
+        return;
+    }
+    std::cout << "Results saved to " << path << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <parquet file> [column]" << std::endl;
+        return 1;
+    }
+    const std::string dataset_path = argv[1];
+
+    duckdb::DuckDB db(nullptr);
+    duckdb::Connection con(db);
+    std::vector<std::string> column_names;
+    if (argc > 2) {
+        column_names.push_back(argv[2]);
+    } else {
+        const auto columns = con.Query("SELECT column_name FROM (DESCRIBE SELECT * FROM read_parquet('" + dataset_path +
+                                       "')) WHERE column_type = 'VARCHAR'");
+        if (columns->HasError()) {
+            std::cerr << "Failed to read " << dataset_path << ": " << columns->GetError() << std::endl;
+            return 1;
+        }
+        for (size_t row = 0; row < columns->RowCount(); row++) {
+            column_names.push_back(columns->GetValue(0, row).ToString());
+        }
+    }
+
+    std::string create_results_table = "CREATE TABLE query_results (";
+    for (const auto &column : query_results_schema) {
+        create_results_table += std::string(&column == query_results_schema ? "" : ", ") + column.first + " " + column.second;
+    }
+    con.Query(create_results_table + ")");
+    duckdb::Appender appender(con, "query_results");
+
+    size_t mismatches = 0;
+    for (const std::string &column_name : column_names) {
+        try {
+            mismatches += BenchmarkColumn(con, appender, dataset_path, column_name);
+        } catch (std::exception &e) {
+            std::cerr << "Column " << column_name << ": " << e.what() << std::endl;
+        }
+    }
+    appender.Close();
+    SaveQueryResults(con);
+    if (mismatches != 0) {
+        std::cerr << mismatches << " FSST+ answers differ from DuckDB's" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include "../fsst_plus.h"
+#include "block_decompressor.h"
+#include "cleaving.h"
+
+/*
+ * FSST+ over the whole row group in sorted order. Cleaving runs normally sort and chunk block_granularity rows in
+ * isolation, so a prefix that recurs all over the row group is stored again in every block. Here the non-NULL
+ * strings of the row group are sorted by TruncatedLess() first and then cut into runs, so equal prefixes from the
+ * whole row group meet in the same blocks. The price is a uint32_t permutation back to the original rows.
+ *
+ * Permutation section layout:
+ *   uint32_t num_rows
+ *   uint32_t num_strings                 non-NULL rows, rows missing from original_rows[] are NULL
+ *   uint32_t original_rows[num_strings]  original row of each string of the sorted FSST+ corpus
+ */
+struct RowGroupSortedCompressionResult {
+    FSSTPlusCompressionResult sorted; // FSST+ corpus of the sorted strings, without NULLs
+    uint8_t *permutation_start; // owned by the worker's ThreadArena(), valid until its next Reset()
+    uint8_t *permutation_end;
+};
+
+constexpr size_t permutation_header_size = sizeof(uint32_t) + sizeof(uint32_t);
+
+inline uint32_t LoadPermutationNumRows(const uint8_t *permutation_start) {
+    return Load<uint32_t>(permutation_start);
+}
+
+inline uint32_t LoadPermutationNumStrings(const uint8_t *permutation_start) {
+    return Load<uint32_t>(permutation_start + sizeof(uint32_t));
+}
+
+inline const uint8_t *FindOriginalRows(const uint8_t *permutation_start) {
+    return permutation_start + permutation_header_size;
+}
+
+// Sorts the whole row group, compresses it with FSST+ and stores the permutation. input is left untouched.
+inline RowGroupSortedCompressionResult RowGroupSortedFSSTPlusCompress(const size_t n, const StringCollection &input,
+                                                                      const size_t &block_granularity,
+                                                                      StageMeasurements &stages, MemoryFootprint &memory) {
+    if (n > UINT32_MAX) {
+        throw std::logic_error("Row group sorted FSST+ row count exceeds the uint32 range of the permutation");
+    }
+
+    const StageProbe sort_probe;
+    std::vector<uint32_t> original_rows;
+    original_rows.reserve(n);
+    for (size_t row = 0; row < n; row++) {
+        if (input.string_ptrs[row] != nullptr) {
+            original_rows.push_back(row);
+        }
+    }
+    std::sort(original_rows.begin(), original_rows.end(), [&input](const uint32_t a, const uint32_t b) {
+        return TruncatedLess(input.lengths[a], input.string_ptrs[a], input.lengths[b], input.string_ptrs[b]);
+    });
+    const size_t n_sorted = original_rows.size();
+    StringCollection sorted(n_sorted, false);
+    for (const uint32_t row : original_rows) {
+        sorted.lengths.push_back(input.lengths[row]);
+        sorted.string_ptrs.push_back(input.string_ptrs[row]);
+    }
+    sort_probe.Stop(stages.sort);
+
+    // Regular FSST+ from here on: the runs are already in order, so sorting them again leaves them as they are
+    RowGroupSortedCompressionResult compression_result{};
+    CleavingRuns runs;
+    const std::vector<SimilarityChunk> similarity_chunks = FormBlockwiseSimilarityChunks(n_sorted, sorted, block_granularity, runs, stages);
+    const size_t n_strings = runs.first_strings.back();
+    const StageProbe cleave_probe;
+    CleavedResult cleaved_result = Cleave(sorted.lengths, sorted.string_ptrs, similarity_chunks, n_strings);
+    cleave_probe.Stop(stages.cleave);
+    memory.cleaved_bytes = CalcCleavedResultBytes(cleaved_result);
+    compression_result.sorted = FSSTPlusCompress(n_strings, similarity_chunks, cleaved_result, runs, block_granularity, stages, memory);
+
+    // Permutation section
+    const StageProbe writing_probe;
+    const size_t permutation_size = permutation_header_size + n_sorted * sizeof(uint32_t);
+    compression_result.permutation_start = ThreadArena().Allocate(permutation_size);
+    Store<uint32_t>(n, compression_result.permutation_start);
+    Store<uint32_t>(n_sorted, compression_result.permutation_start + sizeof(uint32_t));
+    memcpy(compression_result.permutation_start + permutation_header_size, original_rows.data(), n_sorted * sizeof(uint32_t));
+    compression_result.permutation_end = compression_result.permutation_start + permutation_size;
+    writing_probe.Stop(stages.writing);
+    memory.fsst_plus_buffer_bytes += permutation_size;
+
+    return compression_result;
+}
+
+/*
+ * Decodes the sorted corpus into out and moves every string's pointer and length to its original row, nullptr
+ * for NULL rows. Returns the number of decoded bytes.
+ */
+inline size_t RowGroupSortedFSSTPlusDecompressAll(uint8_t *sorted_global_header, const uint8_t *permutation_start,
+                                                  const fsst_decoder_t &prefix_decoder, const fsst_decoder_t &suffix_decoder,
+                                                  unsigned char *out, const size_t out_capacity,
+                                                  std::vector<const unsigned char *> &out_ptrs, std::vector<size_t> &out_lengths) {
+    const size_t num_rows = LoadPermutationNumRows(permutation_start);
+    const size_t num_strings = LoadPermutationNumStrings(permutation_start);
+    const uint8_t *original_rows = FindOriginalRows(permutation_start);
+
+    std::vector<const unsigned char *> sorted_ptrs(num_strings);
+    std::vector<size_t> sorted_lengths(num_strings);
+    const size_t decompressed_bytes = DecompressAll(sorted_global_header, prefix_decoder, suffix_decoder,
+                                                    out, out_capacity, sorted_ptrs, sorted_lengths);
+
+    std::fill(out_ptrs.begin(), out_ptrs.begin() + num_rows, nullptr);
+    std::fill(out_lengths.begin(), out_lengths.begin() + num_rows, 0);
+    for (size_t k = 0; k < num_strings; k++) {
+        const uint32_t row = Load<uint32_t>(original_rows + k * sizeof(uint32_t));
+        out_ptrs[row] = sorted_ptrs[k];
+        out_lengths[row] = sorted_lengths[k];
+    }
+    return decompressed_bytes;
+}
@@ -0,0 +1,148 @@
+#pragma once
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "../fsst_plus.h"
+#include "block_decompressor.h"
+#include "block_hasher.h"
+#include "block_vector_scan.h"
+#include "bloom_filter.h"
+#include "zone_map.h"
+
+/*
+ * An FSST+ corpus that outlives the worker's ThreadArena(): the corpus, its zone map and Bloom filters are copied into
+ * one allocation the segment owns, both encoders are taken over and destroyed with it, and both decoders are built once.
+ *
+ * A segment never changes after construction, so any number of threads can read it at once through a shared
+ * const reference (or std::shared_ptr<const FSSTPlusSegment>). Readers only pass the segment's decoders by reference
+ * and write to their own output buffers: no decoder tables are copied, and there is no lock or shared counter.
+ */
+class FSSTPlusSegment {
+public:
+    explicit FSSTPlusSegment(const FSSTPlusCompressionResult &compression_result)
+        : prefix_encoder(compression_result.prefix_encoder), suffix_encoder(compression_result.suffix_encoder),
+          prefix_decoder(fsst_decoder(compression_result.prefix_encoder)), suffix_decoder(fsst_decoder(compression_result.suffix_encoder)) {
+        const size_t data_size = compression_result.data_end - compression_result.data_start;
+        const size_t zone_map_size = compression_result.zone_map_end - compression_result.zone_map_start;
+        const size_t bloom_filter_size = compression_result.bloom_filter_start == nullptr
+                                             ? 0
+                                             : compression_result.bloom_filter_end - compression_result.bloom_filter_start;
+        buffer_size = data_size + zone_map_size + bloom_filter_size;
+        buffer.reset(new uint8_t[buffer_size]);
+
+        global_header = buffer.get();
+        memcpy(global_header, compression_result.data_start, data_size);
+        zone_map_start = global_header + data_size;
+        memcpy(zone_map_start, compression_result.zone_map_start, zone_map_size);
+        bloom_filter_start = bloom_filter_size == 0 ? nullptr : zone_map_start + zone_map_size;
+        if (bloom_filter_start != nullptr) {
+            memcpy(bloom_filter_start, compression_result.bloom_filter_start, bloom_filter_size);
+        }
+        data_end = global_header + data_size;
+
+        // Row and Bloom filter lookups decode one block at a time, an output buffer for the largest block serves them all
+        const size_t num_blocks = NumBlocks();
+        for (size_t i = 0; i < num_blocks; i++) {
+            max_block_decompressed_size = std::max<size_t>(max_block_decompressed_size,
+                                                           LoadDecompressedOffset(global_header, i + 1) - LoadDecompressedOffset(global_header, i));
+        }
+    }
+
+    ~FSSTPlusSegment() {
+        fsst_destroy(prefix_encoder);
+        fsst_destroy(suffix_encoder);
+    }
+
+    FSSTPlusSegment(const FSSTPlusSegment &) = delete;
+    FSSTPlusSegment &operator=(const FSSTPlusSegment &) = delete;
+
+    static constexpr size_t decompression_padding = 32; // lets fsst_decompress() stay on its fast path up to the last string
+
+    size_t NumRows() const { return LoadNumRows(global_header); }
+    size_t NumBlocks() const { return Load<uint16_t>(global_header); }
+    size_t DecompressedSize() const { return LoadDecompressedOffset(global_header, NumBlocks()); }
+    size_t CompressedSize() const { return data_end - global_header; } // the corpus itself, without zone map and Bloom filters
+    size_t BufferSize() const { return buffer_size; }
+    bool HasBloomFilters() const { return bloom_filter_start != nullptr; }
+    const uint8_t *Validity() const { return FindValidity(global_header); } // see RowIsValid()
+
+    // Output capacity for DecompressAll(), DecompressSelection() and ZoneMapScan(), and for DecompressRow() and Lookup()
+    size_t DecompressAllCapacity() const { return DecompressedSize() + decompression_padding; }
+    size_t BlockCapacity() const { return max_block_decompressed_size + decompression_padding; }
+
+    const fsst_decoder_t &PrefixDecoder() const { return prefix_decoder; }
+    const fsst_decoder_t &SuffixDecoder() const { return suffix_decoder; }
+
+    size_t DecompressAll(unsigned char *out, const size_t out_capacity, std::vector<const unsigned char *> &out_ptrs,
+                         std::vector<size_t> &out_lengths) const {
+        return ::DecompressAll(global_header, prefix_decoder, suffix_decoder, out, out_capacity, out_ptrs, out_lengths);
+    }
+
+    bool DecompressRow(const size_t row, unsigned char *out, const unsigned char *out_end, size_t &decompressed_size) const {
+        return ::DecompressRow(global_header, prefix_decoder, suffix_decoder, row, out, out_end, decompressed_size);
+    }
+
+    size_t DecompressSelection(const uint32_t *sorted_rows, const size_t count, unsigned char *out, const unsigned char *out_end,
+                               std::vector<const unsigned char *> &out_ptrs, std::vector<size_t> &out_lengths) const {
+        return ::DecompressSelection(global_header, prefix_decoder, suffix_decoder, sorted_rows, count, out, out_end, out_ptrs, out_lengths);
+    }
+
+    size_t ZoneMapScan(const ZoneMapFilter &filter, unsigned char *out, const unsigned char *out_end, std::vector<uint32_t> &matching_rows,
+                       std::vector<const unsigned char *> &out_ptrs, std::vector<size_t> &out_lengths) const {
+        return ::ZoneMapScan(global_header, zone_map_start, prefix_decoder, suffix_decoder, filter, out, out_end, matching_rows, out_ptrs,
+                             out_lengths);
+    }
+
+    // HashString() of every row, hashes must have room for every row, see HashAll()
+    void HashAll(std::vector<uint64_t> &hashes) const {
+        ::HashAll(global_header, prefix_decoder, suffix_decoder, hashes);
+    }
+
+    // Point lookup through the Bloom filters, see BloomFilterLookup()
+    size_t Lookup(const unsigned char *value, const size_t length, unsigned char *out, const unsigned char *out_end,
+                  std::vector<uint32_t> &matching_rows) const {
+        if (bloom_filter_start == nullptr) {
+            throw std::logic_error("FSST+ segment has no Bloom filters, config::bloom_filter_bits_per_key is 0");
+        }
+        return BloomFilterLookup(global_header, bloom_filter_start, prefix_decoder, suffix_decoder, value, length, out, out_end, matching_rows);
+    }
+
+    // Each reader scans with a state of its own
+    FSSTPlusVectorScanState NewVectorScanState() const {
+        return FSSTPlusVectorScanState(global_header, prefix_decoder, suffix_decoder);
+    }
+
+    /*
+     * The segment as a compression result, e.g. to append to it with FSSTPlusAppend(). The encoders stay owned by
+     * the segment, and unlike its buffer, an encoder must not be used by several threads at once. An append that kept
+     * them needs fsst_duplicate()d encoders before its result can become a segment of its own.
+     */
+    FSSTPlusCompressionResult View() const {
+        FSSTPlusCompressionResult result{};
+        result.prefix_encoder = prefix_encoder;
+        result.suffix_encoder = suffix_encoder;
+        result.data_start = global_header;
+        result.data_end = data_end;
+        result.zone_map_start = zone_map_start;
+        result.zone_map_end = bloom_filter_start == nullptr ? buffer.get() + buffer_size : bloom_filter_start;
+        result.bloom_filter_start = bloom_filter_start;
+        result.bloom_filter_end = bloom_filter_start == nullptr ? nullptr : buffer.get() + buffer_size;
+        return result;
+    }
+
+private:
+    fsst_encoder_t *prefix_encoder;
+    fsst_encoder_t *suffix_encoder;
+    const fsst_decoder_t prefix_decoder;
+    const fsst_decoder_t suffix_decoder;
+
+    std::unique_ptr<uint8_t[]> buffer; // corpus, zone map, Bloom filters
+    size_t buffer_size;
+    // The decoding functions take a mutable global header but only ever read it
+    uint8_t *global_header;
+    uint8_t *data_end;
+    uint8_t *zone_map_start;
+    uint8_t *bloom_filter_start;
+    size_t max_block_decompressed_size = 0;
+};
@@ -0,0 +1,143 @@
+#include "config.h"
+#include "duckdb.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "fsst_plus.h"
+#include "cleaving.h"
+#include "fsst_plus_segment.h"
+
+namespace config {
+    constexpr size_t total_strings = 100000;
+    constexpr bool print_sorted_corpus = false;
+    constexpr bool print_split_points = false;
+    constexpr bool print_decompressed_corpus = false;
+}
+
+/*
+ * Concurrent readers of one FSSTPlusSegment: N threads do random point lookups and full scans of the same segment,
+ * each with its own output buffers, for N = 1, 2, 4, ... up to the hardware threads. With nothing shared but the
+ * read-only segment, throughput should grow with N until memory bandwidth runs out.
+ *
+ * Usage: segment_scaling_benchmark <parquet file> <column> [max threads]
+ */
+
+// Per-thread result, padded so that threads never write to the same cache line
+struct alignas(64) ReaderResult {
+    size_t decoded_bytes = 0;
+};
+
+// Wall time of n_threads threads running work(thread_id, result) from a common start until the last one is done
+template <typename Work>
+double RunReaders(const size_t n_threads, const Work &work, std::vector<ReaderResult> &results) {
+    results.assign(n_threads, ReaderResult{});
+    std::atomic<size_t> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < n_threads; t++) {
+        threads.emplace_back([&, t]() {
+            ready++;
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            work(t, results[t]);
+        });
+    }
+    while (ready.load() != n_threads) {
+        std::this_thread::yield();
+    }
+    const auto start_time = std::chrono::high_resolution_clock::now();
+    go.store(true, std::memory_order_release);
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    const auto end_time = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double>(end_time - start_time).count();
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <parquet file> <column> [max threads]" << std::endl;
+        return 1;
+    }
+    const std::string dataset_path = argv[1];
+    const std::string column_name = argv[2];
+    const size_t max_threads = argc > 3 ? std::max<size_t>(1, std::stoul(argv[3])) : std::max(1u, std::thread::hardware_concurrency());
+    constexpr size_t block_granularity = 128;
+
+    duckdb::DuckDB db(nullptr);
+    duckdb::Connection con(db);
+    const auto result = con.Query("SELECT \"" + column_name + "\" FROM read_parquet('" + dataset_path + "') LIMIT " +
+                                  std::to_string(config::amount_strings_per_symbol_table));
+    if (result->HasError()) {
+        std::cerr << "Failed to read " << dataset_path << ": " << result->GetError() << std::endl;
+        return 1;
+    }
+    auto data_chunk = result->Fetch();
+    if (!data_chunk || data_chunk->size() == 0) {
+        std::cerr << "No data for column: " << column_name << std::endl;
+        return 1;
+    }
+    const size_t n = result->RowCount();
+    StringCollection input = RetrieveData(result, data_chunk, n);
+
+    // Compress the column and move it out of the arena into a segment that owns it
+    StageMeasurements stages;
+    MemoryFootprint memory;
+    const FSSTPlusSegment segment(CompressFSSTPlus(input, block_granularity, stages, memory));
+    ThreadArena().Reset();
+
+    const size_t num_rows = segment.NumRows();
+    const size_t decompressed_size = segment.DecompressedSize();
+    printf("%zu rows, %zu decompressed bytes, %zu bytes compressed\n", num_rows, decompressed_size, segment.CompressedSize());
+    printf("%8s %14s %8s %12s %8s\n", "threads", "lookups/s", "speedup", "scan GB/s", "speedup");
+
+    std::vector<ReaderResult> results;
+    double single_thread_lookups_per_s = 0;
+    double single_thread_scan_gb_s = 0;
+    for (size_t n_threads = 1;; n_threads = std::min(2 * n_threads, max_threads)) {
+        // Random point lookups, every thread with its own row sequence
+        const double lookup_seconds = RunReaders(n_threads, [&](const size_t thread_id, ReaderResult &reader_result) {
+            std::mt19937_64 rng(thread_id + 1);
+            std::vector<unsigned char> out(segment.BlockCapacity());
+            size_t decompressed_row_size = 0;
+            for (size_t lookup = 0; lookup < config::segment_benchmark_lookups_per_thread; lookup++) {
+                segment.DecompressRow(rng() % num_rows, out.data(), out.data() + out.size(), decompressed_row_size);
+                reader_result.decoded_bytes += decompressed_row_size;
+            }
+        }, results);
+        const double lookups_per_s = static_cast<double>(n_threads * config::segment_benchmark_lookups_per_thread) / lookup_seconds;
+
+        // Full scans, every thread decodes the whole segment into its own buffer
+        const double scan_seconds = RunReaders(n_threads, [&](const size_t, ReaderResult &reader_result) {
+            std::vector<unsigned char> out(segment.DecompressAllCapacity());
+            std::vector<const unsigned char *> out_ptrs(num_rows);
+            std::vector<size_t> out_lengths(num_rows);
+            for (size_t scan = 0; scan < config::segment_benchmark_scans_per_thread; scan++) {
+                reader_result.decoded_bytes += segment.DecompressAll(out.data(), out.size(), out_ptrs, out_lengths);
+            }
+        }, results);
+        size_t scanned_bytes = 0;
+        for (const ReaderResult &reader_result : results) {
+            scanned_bytes += reader_result.decoded_bytes;
+        }
+        const double scan_gb_s = static_cast<double>(scanned_bytes) / 1e9 / scan_seconds;
+
+        if (n_threads == 1) {
+            single_thread_lookups_per_s = lookups_per_s;
+            single_thread_scan_gb_s = scan_gb_s;
+        }
+        printf("%8zu %14.0f %7.2fx %12.3f %7.2fx\n", n_threads, lookups_per_s, lookups_per_s / single_thread_lookups_per_s, scan_gb_s,
+               scan_gb_s / single_thread_scan_gb_s);
+        if (n_threads == max_threads) {
+            break;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,275 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../config.h"
+
+/*
+ * Deterministic synthetic string columns, for scaling studies that do not depend on the refined datasets.
+ *
+ * Every value is a stem and a random tail. A stem is the part shared between rows (a URL's host and directories, a
+ * path's directories, an e-mail's name and domain, a UUID's timestamp digits, a log line's service and message).
+ * Stems are local: every window of config::synthetic_stem_window rows draws from window^(1 - prefix_sharing) stems of
+ * its own, so 0 gives every row a stem of its own and 1 gives all rows of a window the same one. The shape of a
+ * cleaving run is then the same at any row count, and more rows only mean more windows. A stem is rebuilt from
+ * (seed, stem number) whenever it is drawn, and nothing is kept per stem, so any number of rows can be generated in
+ * constant memory.
+ *
+ * The output depends on nothing but the options, on every platform: random numbers come from SplitMix64 streams and
+ * are mapped to ranges here, as the std distributions give different results in different standard libraries.
+ */
+enum class SyntheticColumn { URL, PATH, EMAIL, UUID, LOG, CATEGORICAL };
+
+const SyntheticColumn synthetic_columns[] = {SyntheticColumn::URL, SyntheticColumn::PATH, SyntheticColumn::EMAIL,
+                                             SyntheticColumn::UUID, SyntheticColumn::LOG, SyntheticColumn::CATEGORICAL};
+
+inline const char *SyntheticColumnName(const SyntheticColumn column) {
+    switch (column) {
+        case SyntheticColumn::URL: return "url";
+        case SyntheticColumn::PATH: return "path";
+        case SyntheticColumn::EMAIL: return "email";
+        case SyntheticColumn::UUID: return "uuid";
+        case SyntheticColumn::LOG: return "log";
+        case SyntheticColumn::CATEGORICAL: return "category";
+    }
+    return "";
+}
+
+inline bool ParseSyntheticColumn(const std::string &name, SyntheticColumn &column) {
+    for (const SyntheticColumn candidate : synthetic_columns) {
+        if (name == SyntheticColumnName(candidate)) {
+            column = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+struct SyntheticCorpusOptions {
+    SyntheticColumn column = SyntheticColumn::URL;
+    uint64_t seed = 42;
+    double prefix_sharing = 0.5; // see above
+    size_t min_tail_length = 4; // the random part of a value has a uniform length in [min, max], not used by UUID and CATEGORICAL
+    size_t max_tail_length = 16;
+    double duplicate_rate = 0.1; // share of values repeating one of the last config::synthetic_duplicate_window values
+    double null_rate = 0;
+    size_t cardinality = 16; // stems of CATEGORICAL, which ignores prefix_sharing, so at most this many distinct values
+};
+
+// The SplitMix64 finalizer
+inline uint64_t SplitMix64(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EB;
+    return x ^ (x >> 31);
+}
+
+// SplitMix64 as a generator, seeding one costs nothing, so every stem can have its own
+struct SyntheticRng {
+    uint64_t state;
+
+    explicit SyntheticRng(const uint64_t seed) : state(seed) {}
+
+    uint64_t operator()() {
+        state += 0x9E3779B97F4A7C15;
+        return SplitMix64(state);
+    }
+};
+
+// Uniform in [0, 1) from the top 53 bits
+inline double UnitInterval(const uint64_t bits) {
+    return static_cast<double>(bits >> 11) / 9007199254740992.0;
+}
+
+inline size_t UniformBelow(SyntheticRng &rng, const size_t n) {
+    return static_cast<size_t>(rng() % n);
+}
+
+inline size_t UniformBetween(SyntheticRng &rng, const size_t min, const size_t max) {
+    return min + UniformBelow(rng, max - min + 1);
+}
+
+// A pronounceable lowercase word of min to max syllables
+inline void AppendWord(SyntheticRng &rng, const size_t min_syllables, const size_t max_syllables, std::string &out) {
+    static const char *syllables[] = {"ka", "lo", "mi", "ne", "ru", "sa", "to", "vi", "pe", "da", "gu", "ri", "zo", "fa",
+                                      "be", "chi", "mon", "tar", "sel", "dor", "an", "el", "is", "or", "un", "qua", "ver", "lin"};
+    const size_t n = UniformBetween(rng, min_syllables, max_syllables);
+    for (size_t i = 0; i < n; i++) {
+        out += syllables[UniformBelow(rng, sizeof(syllables) / sizeof(syllables[0]))];
+    }
+}
+
+inline void AppendRandomChars(SyntheticRng &rng, const char *alphabet, const size_t alphabet_size, const size_t n, std::string &out) {
+    for (size_t i = 0; i < n; i++) {
+        out += alphabet[UniformBelow(rng, alphabet_size)];
+    }
+}
+
+inline void AppendHex(SyntheticRng &rng, const size_t n, std::string &out) {
+    AppendRandomChars(rng, "0123456789abcdef", 16, n, out);
+}
+
+// "YYYY-MM-DD HH:MM:SS.mmm" of a millisecond count since 1970-01-01, days to dates as in Howard Hinnant's civil_from_days()
+inline void AppendTimestamp(const uint64_t ms, std::string &out) {
+    const int64_t days = static_cast<int64_t>(ms / 86400000);
+    const uint64_t ms_of_day = ms % 86400000;
+    const int64_t z = days + 719468;
+    const int64_t era = z / 146097;
+    const int64_t day_of_era = z - era * 146097;
+    const int64_t year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    const int64_t day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    const int64_t mp = (5 * day_of_year + 2) / 153;
+    const int64_t day = day_of_year - (153 * mp + 2) / 5 + 1;
+    const int64_t month = mp < 10 ? mp + 3 : mp - 9;
+    const int64_t year = year_of_era + era * 400 + (month <= 2);
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d %02d:%02d:%02d.%03d", static_cast<int>(year), static_cast<int>(month),
+             static_cast<int>(day), static_cast<int>(ms_of_day / 3600000), static_cast<int>(ms_of_day / 60000 % 60),
+             static_cast<int>(ms_of_day / 1000 % 60), static_cast<int>(ms_of_day % 1000));
+    out += buffer;
+}
+
+class SyntheticCorpusGenerator {
+public:
+    explicit SyntheticCorpusGenerator(const SyntheticCorpusOptions &options)
+        : options(options), rng(SplitMix64(options.seed)), timestamp_ms(1735689600000) { // 2025-01-01
+        if (options.min_tail_length > options.max_tail_length) {
+            throw std::logic_error("Synthetic corpus: min_tail_length " + std::to_string(options.min_tail_length) +
+                                   " is above max_tail_length " + std::to_string(options.max_tail_length));
+        }
+        if (options.column == SyntheticColumn::CATEGORICAL) {
+            n_stems = std::max<size_t>(1, options.cardinality);
+        } else {
+            const double sharing = std::min(1.0, std::max(0.0, options.prefix_sharing));
+            n_stems = std::max<size_t>(1, static_cast<size_t>(std::llround(
+                    std::pow(static_cast<double>(config::synthetic_stem_window), 1.0 - sharing))));
+        }
+    }
+
+    // Stems a window of config::synthetic_stem_window rows draws from, all rows for CATEGORICAL
+    size_t StemsPerWindow() const { return n_stems; }
+
+    // The next value, false for a NULL
+    bool Next(std::string &value) {
+        value.clear();
+        const size_t window = options.column == SyntheticColumn::CATEGORICAL ? 0 : row / config::synthetic_stem_window;
+        row++;
+        if (options.null_rate > 0 && UnitInterval(rng()) < options.null_rate) {
+            return false;
+        }
+        if (!recent.empty() && options.duplicate_rate > 0 && UnitInterval(rng()) < options.duplicate_rate) {
+            value = recent[UniformBelow(rng, recent.size())];
+            return true;
+        }
+        Generate(window * n_stems + UniformBelow(rng, n_stems), value);
+        if (recent.size() < config::synthetic_duplicate_window) {
+            recent.push_back(value);
+        } else {
+            recent[next_recent] = value;
+            next_recent = (next_recent + 1) % config::synthetic_duplicate_window;
+        }
+        return true;
+    }
+
+private:
+    // The stem's random numbers, the same whenever the stem is drawn
+    SyntheticRng StemRng(const size_t stem) const {
+        return SyntheticRng(SplitMix64(options.seed ^ SplitMix64(stem + 1)));
+    }
+
+    size_t TailLength() {
+        return UniformBetween(rng, options.min_tail_length, options.max_tail_length);
+    }
+
+    void Generate(const size_t stem, std::string &out) {
+        static const char alphanumeric[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+        static const char digits[] = "0123456789";
+        static const char *tlds[] = {".com", ".org", ".net", ".io", ".de", ".nl"};
+        SyntheticRng stem_rng = StemRng(stem);
+        switch (options.column) {
+            case SyntheticColumn::URL: {
+                out += UniformBelow(stem_rng, 4) == 0 ? "http://" : "https://www.";
+                AppendWord(stem_rng, 2, 4, out);
+                out += tlds[UniformBelow(stem_rng, sizeof(tlds) / sizeof(tlds[0]))];
+                for (size_t i = UniformBetween(stem_rng, 1, 3); i > 0; i--) {
+                    out += '/';
+                    AppendWord(stem_rng, 1, 3, out);
+                }
+                out += '/';
+                AppendRandomChars(rng, alphanumeric, sizeof(alphanumeric) - 1, TailLength(), out);
+                break;
+            }
+            case SyntheticColumn::PATH: {
+                static const char *roots[] = {"/home/", "/var/lib/", "/usr/share/", "/srv/", "/opt/", "/data/"};
+                static const char *extensions[] = {".txt", ".log", ".csv", ".json", ".parquet", ".png", ".cpp"};
+                out += roots[UniformBelow(stem_rng, sizeof(roots) / sizeof(roots[0]))];
+                for (size_t i = UniformBetween(stem_rng, 2, 4); i > 0; i--) {
+                    AppendWord(stem_rng, 1, 3, out);
+                    out += '/';
+                }
+                AppendRandomChars(rng, alphanumeric, sizeof(alphanumeric) - 1, TailLength(), out);
+                out += extensions[UniformBelow(rng, sizeof(extensions) / sizeof(extensions[0]))];
+                break;
+            }
+            case SyntheticColumn::EMAIL: {
+                // Name first, so that rows of a stem share a prefix, then a random part and the stem's domain
+                AppendWord(stem_rng, 1, 3, out);
+                out += '.';
+                AppendWord(stem_rng, 2, 3, out);
+                AppendRandomChars(rng, digits, sizeof(digits) - 1, TailLength(), out);
+                out += '@';
+                AppendWord(stem_rng, 2, 3, out);
+                out += tlds[UniformBelow(stem_rng, sizeof(tlds) / sizeof(tlds[0]))];
+                break;
+            }
+            case SyntheticColumn::UUID: {
+                // UUIDv7 layout: the stem's 48 timestamp bits come first, version 7, variant 10xx
+                std::string hex;
+                AppendHex(stem_rng, 12, hex);
+                hex += '7';
+                AppendHex(rng, 3, hex);
+                hex += "89ab"[UniformBelow(rng, 4)];
+                AppendHex(rng, 15, hex);
+                out += hex.substr(0, 8) + '-' + hex.substr(8, 4) + '-' + hex.substr(12, 4) + '-' + hex.substr(16, 4) + '-' + hex.substr(20);
+                break;
+            }
+            case SyntheticColumn::LOG: {
+                // Timestamps rise from row to row, the stem is the service and message of the line
+                static const char *levels[] = {"INFO", "INFO", "INFO", "INFO", "INFO", "INFO", "WARN", "WARN", "ERROR", "DEBUG"};
+                timestamp_ms += UniformBelow(rng, 1000);
+                AppendTimestamp(timestamp_ms, out);
+                out += ' ';
+                out += levels[UniformBelow(rng, sizeof(levels) / sizeof(levels[0]))];
+                out += " [";
+                AppendWord(stem_rng, 2, 3, out);
+                out += "-service] ";
+                for (size_t i = UniformBetween(stem_rng, 3, 6); i > 0; i--) {
+                    AppendWord(stem_rng, 1, 3, out);
+                    out += ' ';
+                }
+                out += "id=";
+                AppendRandomChars(rng, alphanumeric, sizeof(alphanumeric) - 1, TailLength(), out);
+                break;
+            }
+            case SyntheticColumn::CATEGORICAL: {
+                AppendWord(stem_rng, 2, 4, out);
+                if (UniformBelow(stem_rng, 2) == 0) {
+                    out += '_';
+                    AppendWord(stem_rng, 1, 3, out);
+                }
+                break;
+            }
+        }
+    }
+
+    const SyntheticCorpusOptions options;
+    SyntheticRng rng;
+    size_t n_stems;
+    size_t row = 0; // rows generated so far, NULLs and duplicates included
+    uint64_t timestamp_ms;
+    std::vector<std::string> recent; // ring of the last generated values, duplicates are drawn from it
+    size_t next_recent = 0;
+};
@@ -0,0 +1,111 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include "../config.h"
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+/*
+ * Bump allocator for the scratch and output buffers of one worker thread. Memory is only given back by
+ * Reset(), which is called between columns and keeps the pages mapped, so the next column reuses pages that
+ * are already faulted in instead of going through malloc and the kernel again.
+ *
+ * When a column needs more than the current chunk, another chunk is added. On the next Reset() all chunks are
+ * merged into one chunk of their combined size, so after the first few columns everything fits in one mapping.
+ */
+class Arena {
+public:
+    explicit Arena(const bool use_huge_pages) : use_huge_pages(use_huge_pages) {}
+
+    ~Arena() {
+        for (const Chunk &chunk : chunks) {
+            FreeChunk(chunk);
+        }
+    }
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    uint8_t *Allocate(const size_t size, const size_t alignment = 64) {
+        size_t aligned_offset = (offset + alignment - 1) & ~(alignment - 1);
+        if (chunks.empty() || aligned_offset + size > chunks.back().size) {
+            AddChunk(size);
+            aligned_offset = 0;
+        }
+        offset = aligned_offset + size;
+        return chunks.back().data + aligned_offset;
+    }
+
+    // Invalidates everything allocated so far
+    void Reset() {
+        if (chunks.size() > 1) {
+            const size_t total_size = Capacity();
+            for (const Chunk &chunk : chunks) {
+                FreeChunk(chunk);
+            }
+            chunks.clear();
+            AddChunk(total_size);
+        }
+        offset = 0;
+    }
+
+    size_t Capacity() const {
+        size_t result = 0;
+        for (const Chunk &chunk : chunks) {
+            result += chunk.size;
+        }
+        return result;
+    }
+
+private:
+    struct Chunk {
+        uint8_t *data;
+        size_t size;
+    };
+
+    static constexpr size_t huge_page_size = 2 * 1024 * 1024;
+    static constexpr size_t min_chunk_size = 4 * huge_page_size;
+
+    const bool use_huge_pages;
+    std::vector<Chunk> chunks;
+    size_t offset = 0; // into the last chunk
+
+    void AddChunk(const size_t min_size) {
+        size_t size = std::max(min_size, chunks.empty() ? min_chunk_size : chunks.back().size * 2);
+        size = (size + huge_page_size - 1) & ~(huge_page_size - 1);
+#ifdef __linux__
+        void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (data == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        if (use_huge_pages) {
+            madvise(data, size, MADV_HUGEPAGE); // only a hint, without transparent huge pages we keep 4 KB pages
+        }
+#else
+        void *data = malloc(size);
+        if (data == nullptr) {
+            throw std::bad_alloc();
+        }
+#endif
+        chunks.push_back(Chunk{static_cast<uint8_t *>(data), size});
+    }
+
+    static void FreeChunk(const Chunk &chunk) {
+#ifdef __linux__
+        munmap(chunk.data, chunk.size);
+#else
+        free(chunk.data);
+#endif
+    }
+};
+
+// One arena per worker thread, so concurrent workers never contend on the allocator
+inline Arena &ThreadArena() {
+    thread_local Arena arena(config::arena_use_huge_pages);
+    return arena;
+}
@@ -8,14 +8,18 @@
 #include <string>
 #include <chrono>
 #include "../global.h"
+#include "results_table.h"
 #include <generic_utils.h>
+#include "perf_counters.h"
+#include "arena.h"
 
 struct FSSTCompressionResult {
     fsst_encoder_t *encoder;
     std::vector<size_t> encoded_string_lengths;
     std::vector<unsigned char *> encoded_string_ptrs;
-    unsigned char *output_buffer;
+    unsigned char *output_buffer; // owned by the worker's ThreadArena(), valid until its next Reset()
     size_t number_of_strings_compressed;
+    size_t output_buffer_size;
 };
 
 inline fsst_encoder_t *CreateEncoder(const std::vector<size_t> &lenIn, std::vector<const unsigned char *> &strIn) {
@@ -67,14 +71,13 @@ inline void ExtractStringsFromResultChunk(const duckdb::unique_ptr<duckdb::DataC
 
 inline void VerifyDecompressionCorrectness(const StringCollection &input, const std::vector<size_t> & encoded_string_lengths, const std::vector<unsigned char *> & encoded_string_ptrs, size_t number_of_strings_compressed,
                                            const fsst_decoder_t & decoder) {
-    if (number_of_strings_compressed != input.data.size()) {
+    if (number_of_strings_compressed != input.lengths.size()) {
         throw std::logic_error("Basic FSST compressed size is not equal to input size ");
     }
+    // Allocate decompression buffer
+    constexpr size_t BUFFER_SIZE = 1000000;
+    unsigned char *result = ThreadArena().Allocate(BUFFER_SIZE);
     for (size_t i = 0; i < number_of_strings_compressed; i++) {
-        // Allocate decompression buffer
-        constexpr size_t BUFFER_SIZE = 1000000;
-        unsigned char *result = new unsigned char[BUFFER_SIZE];
-        
         size_t decompressed_size = fsst_decompress(
             &decoder, /* IN: use this symbol table for compression. */
             encoded_string_lengths[i],  /* IN: byte-length of compressed string. */
@@ -109,21 +112,16 @@ inline void VerifyDecompressionCorrectness(const StringCollection &input, const
                 }
                 std::cerr << "]" << std::endl;
             }
-            // Free the result buffer to avoid memory leak
-            delete[] result;
             throw std::logic_error("Decompression mismatch detected. Terminating.");
         }
-        // Free the result buffer to avoid memory leak
-        delete[] result;
     }
   
     std::cout << "Decompression verified\n";
 };
 
-inline FSSTCompressionResult FSSTCompress(StringCollection &input) {
+// Encodes input with an existing symbol table, e.g. one trained on earlier strings of the same column
+inline FSSTCompressionResult FSSTEncode(fsst_encoder_t *encoder, StringCollection &input, StageMeasurement &encoding) {
     const size_t n = input.lengths.size();
-    // Create FSST encoder
-    fsst_encoder_t *encoder = CreateEncoder(input.lengths, input.string_ptrs);
 
     // Compression outputs
     std::vector<size_t> lenOut(n);
@@ -135,10 +133,11 @@ inline FSSTCompressionResult FSSTCompress(StringCollection &input) {
         max_out_size += input.lengths[i];
     }
     max_out_size = max_out_size * 5; // *5 to cover datastructure overhead just in case
-    unsigned char *output = static_cast<unsigned char *>(malloc(max_out_size));
+    unsigned char *output = ThreadArena().Allocate(max_out_size);
 
 
     //////////////// COMPRESSION ////////////////
+    const StageProbe encoding_probe;
     size_t number_of_strings_compressed = fsst_compress(
         encoder, /* IN: encoder obtained from fsst_create(). */
         input.lengths.size(), /* IN: number of strings in batch to compress. */
@@ -149,6 +148,7 @@ inline FSSTCompressionResult FSSTCompress(StringCollection &input) {
         lenOut.data(), /* OUT: byte-lengths of the compressed strings. */
         strOut.data() /* OUT: output string start pointers. Will all point into [output,output+size). */
     );
+    encoding_probe.Stop(encoding);
 
     if (number_of_strings_compressed != n) {
         // See if all size is zero
@@ -167,14 +167,30 @@ inline FSSTCompressionResult FSSTCompress(StringCollection &input) {
     // fsst_decoder_t decoder = fsst_decoder(encoder);
     // print_decoder_symbol_table(decoder);
 
-    return FSSTCompressionResult{encoder, lenOut, strOut, output, number_of_strings_compressed};
+    return FSSTCompressionResult{encoder, lenOut, strOut, output, number_of_strings_compressed, max_out_size};
+}
+
+inline FSSTCompressionResult FSSTCompress(StringCollection &input, StageMeasurement &training, StageMeasurement &encoding) {
+    // Create FSST encoder
+    const StageProbe training_probe;
+    fsst_encoder_t *encoder = CreateEncoder(input.lengths, input.string_ptrs);
+    training_probe.Stop(training);
+
+    return FSSTEncode(encoder, input, encoding);
+}
+
+inline FSSTCompressionResult FSSTCompress(StringCollection &input) {
+    StageMeasurement training;
+    StageMeasurement encoding;
+    return FSSTCompress(input, training, encoding);
 }
 
-// Declaration for the function that runs basic FSST compression and prints its results, using the provided DuckDB connection, parquet file path, and limit.
-inline void RunBasicFSST(duckdb::Connection &con, StringCollection &input, const size_t &total_string_size, Metadata &metadata) {
+// Runs basic FSST compression on the input, prints its results and adds them to the results buffer.
+inline void RunBasicFSST(ResultsBuffer &results, StringCollection &input, const size_t &total_string_size, Metadata &metadata) {
+    ResetRunMetrics(metadata);
     const auto start_time = std::chrono::high_resolution_clock::now();
 
-    metadata.amount_of_rows = input.data.size();
+    metadata.amount_of_rows = input.lengths.size();
     
     size_t total_strings_amount = {0};
     size_t total_compressed_string_size = {0};
@@ -206,9 +222,9 @@ inline void RunBasicFSST(duckdb::Connection &con, StringCollection &input, const
     total_strings_amount += input.lengths.size();
 
 
-    // Free FSST encoder and output buffer for this batch
+    // Free FSST encoders, the output buffer goes back with the arena
     fsst_destroy(encoder);
-    free(compression_result.output_buffer);
+    fsst_destroy(compression_result.encoder);
 
     
     metadata.run_time_ms = std::chrono::duration<double, std::milli>(end_time - start_time).count();
@@ -217,23 +233,7 @@ inline void RunBasicFSST(duckdb::Connection &con, StringCollection &input, const
     PrintCompressionStats(total_strings_amount, total_string_size, total_compressed_string_size);
     
     // Store results in the database
-    std::string insert_query = "INSERT INTO results VALUES ('" +
-                               metadata.dataset_folders + "', '" +
-                               metadata.dataset + "', '" +
-                               metadata.column + "', '" +
-                               metadata.algo + "', " +
-                               std::to_string(metadata.amount_of_rows) + ", " +
-                               std::to_string(metadata.run_time_ms) + ", " +
-                               std::to_string(metadata.compression_factor) + ", " +
-                               std::to_string(total_strings_amount) + ", " +
-                               std::to_string(total_string_size) + ");";
-        
-    try {
-        con.Query(insert_query);
-        std::cout << "Inserted result for Basic FSST on " << metadata.dataset << "." << metadata.column << std::endl;
-    } catch (std::exception& e) {
-        std::cerr << "Failed to insert Basic FSST result: " << e.what() << std::endl;
-    }
+    results.Add(metadata, total_strings_amount, total_string_size);
 }
 
 inline size_t CalcEncodedStringsSize(const FSSTCompressionResult &compression_result) {
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/*
+ * Fixed-width bit-packing of unsigned values: value i occupies bits [i * width, (i + 1) * width) of the buffer,
+ * least significant bit first. Reads are a single unaligned 8-byte load, so the buffer carries
+ * bitpacking_padding extra bytes and width can be at most 57 bits.
+ */
+constexpr size_t bitpacking_padding = sizeof(uint64_t);
+
+// Smallest width that can hold every value below n_values, 0 when there is only one value
+inline uint8_t CalcBitWidth(const size_t n_values) {
+    uint8_t width = 0;
+    while (width < 64 && (static_cast<uint64_t>(1) << width) < n_values) {
+        width++;
+    }
+    return width;
+}
+
+// Bytes of the packed values themselves, without bitpacking_padding
+inline size_t CalcBitPackedSize(const size_t n, const uint8_t width) {
+    return (n * width + 7) / 8;
+}
+
+// out must have room for CalcBitPackedSize(values.size(), width) + bitpacking_padding bytes
+inline void BitPack(const std::vector<uint32_t> &values, const uint8_t width, uint8_t *out) {
+    memset(out, 0, CalcBitPackedSize(values.size(), width) + bitpacking_padding);
+    if (width == 0) {
+        return;
+    }
+    for (size_t i = 0; i < values.size(); i++) {
+        const size_t bit = i * width;
+        uint64_t word;
+        memcpy(&word, out + bit / 8, sizeof(uint64_t));
+        word |= static_cast<uint64_t>(values[i]) << (bit % 8);
+        memcpy(out + bit / 8, &word, sizeof(uint64_t));
+    }
+}
+
+inline uint32_t BitUnpack(const uint8_t *packed, const size_t i, const uint8_t width) {
+    const size_t bit = i * width;
+    uint64_t word;
+    memcpy(&word, packed + bit / 8, sizeof(uint64_t));
+    const uint64_t mask = (static_cast<uint64_t>(1) << width) - 1;
+    return static_cast<uint32_t>((word >> (bit % 8)) & mask);
+}
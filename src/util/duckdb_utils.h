@@ -17,11 +17,9 @@ inline void ExtractStringsFromDataChunk(const unique_ptr<DataChunk> &data_chunk,
     // Populate lenIn and strIn
     for (size_t i = 0; i < data_chunk->size(); i++) {
         if (!validity.RowIsValid(i)) {
-            // Handle NULL case
-            data.push_back("");
-            const std::string &stored_str = data.back();
+            // NULL: no string at all, FSST+ keeps these out of the string stream (see CleavingRuns)
             lengths.push_back(0);
-            string_ptrs.push_back(reinterpret_cast<const unsigned char *>(stored_str.c_str()));
+            string_ptrs.push_back(nullptr);
 
         } else {
             std::string str = vector_data[i].GetString();
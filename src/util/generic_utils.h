@@ -5,6 +5,7 @@
 #include <vector>
 #include <iostream>
 #include <cassert>
+#include <chrono>
 #include "cleaving_types.h"
 
 inline bool TextMatches(const unsigned char *result, const unsigned char *original, const size_t &size) {
@@ -65,4 +66,8 @@ inline size_t CalculateInputSize(const StringCollection &input) {
         total_string_size += string_length;
     }
     return total_string_size;
-}
\ No newline at end of file
+}
+
+inline double MillisecondsSince(const std::chrono::high_resolution_clock::time_point &start_time) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start_time).count();
+}
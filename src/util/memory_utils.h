@@ -0,0 +1,56 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "cleaving_types.h"
+#include "basic_fsst.h"
+#ifdef __linux__
+#include <fstream>
+#include <unistd.h>
+#endif
+
+template <typename T>
+inline size_t CalcVectorBytes(const std::vector<T> &v) {
+    return v.capacity() * sizeof(T);
+}
+
+// Bytes owned by a std::string: its heap allocation, unless the characters fit in the small string buffer
+inline size_t CalcStringHeapBytes(const std::string &s) {
+    const char *object_start = reinterpret_cast<const char *>(&s);
+    const bool is_small_string = s.data() >= object_start && s.data() < object_start + sizeof(std::string);
+    return is_small_string ? 0 : s.capacity() + 1;
+}
+
+inline size_t CalcStringCollectionBytes(const StringCollection &collection) {
+    size_t result = CalcVectorBytes(collection.lengths) + CalcVectorBytes(collection.string_ptrs) + CalcVectorBytes(collection.data);
+    for (const std::string &s : collection.data) {
+        result += CalcStringHeapBytes(s);
+    }
+    return result;
+}
+
+inline size_t CalcCleavedResultBytes(const CleavedResult &cleaved_result) {
+    return CalcStringCollectionBytes(cleaved_result.prefixes) + CalcStringCollectionBytes(cleaved_result.suffixes);
+}
+
+inline size_t CalcFSSTCompressionResultBytes(const FSSTCompressionResult &compression_result) {
+    return compression_result.output_buffer_size
+           + CalcVectorBytes(compression_result.encoded_string_lengths)
+           + CalcVectorBytes(compression_result.encoded_string_ptrs);
+}
+
+/*
+ * Current resident set size of the whole process, from /proc/self/statm. Unlike the peak RSS it also goes down, so a
+ * delta around a column is what that column holds. It is still process-wide: with several workers it also counts
+ * whatever the others allocated meanwhile, so it is only taken with a single worker.
+ */
+inline long CurrentRSSBytes() {
+#ifdef __linux__
+    std::ifstream statm("/proc/self/statm");
+    long size_pages = 0;
+    long resident_pages = 0;
+    if (statm >> size_pages >> resident_pages) {
+        return resident_pages * sysconf(_SC_PAGESIZE);
+    }
+#endif
+    return 0;
+}
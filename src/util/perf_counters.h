@@ -0,0 +1,181 @@
+#pragma once
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <atomic>
+#include "generic_utils.h"
+#include "../config.h"
+#include "../global.h"
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+enum PerfCounter : uint8_t {
+    PERF_CYCLES = 0,
+    PERF_INSTRUCTIONS = 1,
+    PERF_L1D_MISSES = 2,
+    PERF_LLC_MISSES = 3,
+    PERF_BRANCH_MISSES = 4,
+    NUM_PERF_COUNTERS = 5
+};
+
+inline PerfCounterValues operator-(const PerfCounterValues &a, const PerfCounterValues &b) {
+    PerfCounterValues result;
+    result.cycles = a.cycles - b.cycles;
+    result.instructions = a.instructions - b.instructions;
+    result.l1d_misses = a.l1d_misses - b.l1d_misses;
+    result.llc_misses = a.llc_misses - b.llc_misses;
+    result.branch_misses = a.branch_misses - b.branch_misses;
+    return result;
+}
+
+inline PerfCounterValues &operator+=(PerfCounterValues &a, const PerfCounterValues &b) {
+    a.cycles += b.cycles;
+    a.instructions += b.instructions;
+    a.l1d_misses += b.l1d_misses;
+    a.llc_misses += b.llc_misses;
+    a.branch_misses += b.branch_misses;
+    return a;
+}
+
+/*
+ * A perf_event_open group counting cycles, instructions, L1D read misses, LLC misses and branch misses
+ * of the calling thread (user space only). The group is enabled once and never reset: callers read it
+ * before and after a stage and take the difference, so a measurement costs two read() syscalls.
+ *
+ * Counters that cannot be opened (no PMU in a VM, perf_event_paranoid, non-Linux) are left out, and
+ * Available() tells which ones are present. When the group leader itself fails nothing is collected.
+ */
+class PerfCounterGroup {
+public:
+    PerfCounterGroup() {
+        for (int &fd : fds) fd = -1;
+#ifdef __linux__
+        if (!config::collect_perf_counters) return;
+
+        const uint32_t types[NUM_PERF_COUNTERS] = {
+            PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE
+        };
+        const uint64_t configs[NUM_PERF_COUNTERS] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+            PERF_COUNT_HW_CACHE_MISSES, // last level cache
+            PERF_COUNT_HW_BRANCH_MISSES
+        };
+
+        for (int i = 0; i < NUM_PERF_COUNTERS; ++i) {
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = types[i];
+            attr.config = configs[i];
+            attr.disabled = i == PERF_CYCLES ? 1 : 0; // the leader starts the whole group
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            const int group_fd = i == PERF_CYCLES ? -1 : fds[PERF_CYCLES];
+            fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0 /* this thread */, -1 /* any cpu */, group_fd, 0));
+            if (fds[i] < 0) {
+                if (i == PERF_CYCLES) {
+                    WarnUnavailable();
+                    return;
+                }
+                continue;
+            }
+            group_positions[i] = number_of_counters++;
+            available_mask |= 1 << i;
+        }
+
+        ioctl(fds[PERF_CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fds[PERF_CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+    }
+
+    ~PerfCounterGroup() {
+#ifdef __linux__
+        for (const int fd : fds) {
+            if (fd >= 0) close(fd);
+        }
+#endif
+    }
+
+    PerfCounterGroup(const PerfCounterGroup &) = delete;
+    PerfCounterGroup &operator=(const PerfCounterGroup &) = delete;
+
+    uint8_t Available() const {
+        return available_mask;
+    }
+
+    PerfCounterValues Read() const {
+        PerfCounterValues result;
+#ifdef __linux__
+        if (available_mask == 0) return result;
+
+        struct {
+            uint64_t nr;
+            uint64_t time_enabled;
+            uint64_t time_running;
+            uint64_t values[NUM_PERF_COUNTERS];
+        } buffer{};
+        if (read(fds[PERF_CYCLES], &buffer, sizeof(buffer)) <= 0 || buffer.time_running == 0) return result;
+
+        // Scale up if the kernel had to multiplex the group with other events
+        const double scale = static_cast<double>(buffer.time_enabled) / static_cast<double>(buffer.time_running);
+        uint64_t *fields[NUM_PERF_COUNTERS] = {
+            &result.cycles, &result.instructions, &result.l1d_misses, &result.llc_misses, &result.branch_misses
+        };
+        for (int i = 0; i < NUM_PERF_COUNTERS; ++i) {
+            if (available_mask & (1 << i)) {
+                *fields[i] = static_cast<uint64_t>(static_cast<double>(buffer.values[group_positions[i]]) * scale);
+            }
+        }
+#endif
+        return result;
+    }
+
+private:
+    int fds[NUM_PERF_COUNTERS];
+    int group_positions[NUM_PERF_COUNTERS] = {0}; // position of each counter in the group's read() buffer
+    int number_of_counters = 0;
+    uint8_t available_mask = 0;
+
+    static void WarnUnavailable() {
+        static std::atomic<bool> warned{false};
+        if (!warned.exchange(true)) {
+            std::cerr << "⚠️ perf_event_open unavailable (errno " << errno << "), hardware counters will not be collected\n";
+        }
+    }
+};
+
+// Counters are per thread, so every worker lazily opens its own group
+inline PerfCounterGroup &ThreadPerfCounters() {
+    thread_local PerfCounterGroup group;
+    return group;
+}
+
+/*
+ * Measures a single stage on the calling thread, from construction until Stop().
+ * Stop() adds to the stage, so a stage that runs many times (e.g. once per cleaving run) accumulates.
+ */
+class StageProbe {
+public:
+    StageProbe() : counters(ThreadPerfCounters()),
+                   start_counters(counters.Read()),
+                   start_time(std::chrono::high_resolution_clock::now()) {}
+
+    void Stop(StageMeasurement &stage) const {
+        stage.time_ms += MillisecondsSince(start_time);
+        stage.counters += counters.Read() - start_counters;
+    }
+
+private:
+    const PerfCounterGroup &counters;
+    const PerfCounterValues start_counters;
+    const std::chrono::high_resolution_clock::time_point start_time;
+};
@@ -0,0 +1,263 @@
+#pragma once
+#include "duckdb.hpp"
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../config.h"
+#include "../global.h"
+#include "perf_counters.h"
+
+// Column names and SQL types of the results table, in the order AppendResultRow() appends them
+inline std::vector<std::pair<std::string, std::string> > ResultsSchema() {
+    const std::string perf_counters_struct =
+            "STRUCT(cycles UBIGINT, instructions UBIGINT, l1d_misses UBIGINT, llc_misses UBIGINT, branch_misses UBIGINT)";
+    return {
+        {"path", "VARCHAR"},
+        {"dataset", "VARCHAR"},
+        {"col_name", "VARCHAR"},
+        {"row_group", "BIGINT"},
+        {"algo", "VARCHAR"},
+        {"amount_of_rows", "BIGINT"},
+        {"run_time_ms", "DOUBLE"},
+        {"compression_factor", "DOUBLE"},
+        {"num_strings", "BIGINT"},
+        {"original_size", "BIGINT"},
+        {"sort_time_ms", "DOUBLE"},
+        {"chunking_time_ms", "DOUBLE"},
+        {"cleave_time_ms", "DOUBLE"},
+        {"prefix_training_time_ms", "DOUBLE"},
+        {"suffix_training_time_ms", "DOUBLE"},
+        {"encode_time_ms", "DOUBLE"},
+        {"sizing_time_ms", "DOUBLE"},
+        {"writing_time_ms", "DOUBLE"},
+        {"decompression_time_ms", "DOUBLE"},
+        {"decompression_mb_s", "DOUBLE"},
+        {"decompression_strings_per_s", "DOUBLE"},
+        {"decompression_threads", "BIGINT"},
+        {"permutation_bytes", "BIGINT"},
+        {"bloom_filter_bytes", "BIGINT"},
+        {"bloom_filter_fpr", "DOUBLE"},
+        {"storage_codec", "VARCHAR"},
+        {"storage_bytes", "BIGINT"},
+        {"storage_slack_bytes", "BIGINT"},
+        {"duckdb_best_compression_factor", "DOUBLE"},
+        {"sort_counters", perf_counters_struct},
+        {"chunking_counters", perf_counters_struct},
+        {"cleave_counters", perf_counters_struct},
+        {"prefix_training_counters", perf_counters_struct},
+        {"suffix_training_counters", perf_counters_struct},
+        {"encode_counters", perf_counters_struct},
+        {"sizing_counters", perf_counters_struct},
+        {"writing_counters", perf_counters_struct},
+        {"decompression_counters", perf_counters_struct},
+        {"input_bytes", "BIGINT"},
+        {"cleaved_bytes", "BIGINT"},
+        {"prefix_fsst_bytes", "BIGINT"},
+        {"suffix_fsst_bytes", "BIGINT"},
+        {"fsst_plus_buffer_bytes", "BIGINT"},
+        {"decompression_buffer_bytes", "BIGINT"},
+        {"arena_bytes", "BIGINT"},
+        {"rss_delta_bytes", "BIGINT"},
+    };
+}
+
+inline bool CreateResultsTable(duckdb::Connection &con) {
+    // Begin transaction
+    con.Query("BEGIN TRANSACTION");
+
+    // Create a results table to store benchmarks
+    std::string create_results_table = "CREATE TABLE results (";
+    const auto schema = ResultsSchema();
+    for (size_t i = 0; i < schema.size(); ++i) {
+        create_results_table += (i == 0 ? "" : ", ") + schema[i].first + " " + schema[i].second;
+    }
+    create_results_table += ");";
+
+    try {
+        con.Query(create_results_table);
+
+        // Commit the transaction to persist the table
+        con.Query("COMMIT");
+    } catch (std::exception& e) {
+        con.Query("ROLLBACK");
+        std::cerr << "Failed to create results table: " << e.what() << std::endl;
+        return false;
+    }
+
+    // Verify the table was created (after commit)
+    auto verify_result = con.Query("SHOW TABLES");
+    auto verify_chunk = verify_result->Fetch();
+    bool found_results_table = false;
+
+    while (verify_chunk) {
+        // Only access columns that exist
+        size_t num_cols = verify_chunk->data.size();
+        if (num_cols == 0) {
+            std::cerr << "SHOW TABLES returned no columns" << std::endl;
+            break;
+        }
+
+        // Use the first column as it contains the table name in this case
+        auto table_names = duckdb::FlatVector::GetData<duckdb::string_t>(verify_chunk->data[0]);
+        for (size_t i = 0; i < verify_chunk->size(); i++) {
+            std::string table_name = table_names[i].GetString();
+            std::cout << " - " << table_name << std::endl;
+            if (table_name == "results") {
+                found_results_table = true;
+            }
+        }
+        verify_chunk = verify_result->Fetch();
+    }
+
+    if (!found_results_table) {
+        std::cerr << "Results table was not created successfully" << std::endl;
+        return false;
+    }
+
+    std::cout << "Results table created successfully" << std::endl;
+
+    return found_results_table;
+}
+
+inline duckdb::LogicalType PerfCountersType() {
+    duckdb::child_list_t<duckdb::LogicalType> children;
+    for (const char *name : {"cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses"}) {
+        children.push_back(std::make_pair(name, duckdb::LogicalType::UBIGINT));
+    }
+    return duckdb::LogicalType::STRUCT(children);
+}
+
+// One stage's counters as a STRUCT value. Counters that were not collected become NULL
+inline duckdb::Value PerfCountersToValue(const PerfCounterValues &counters, const uint8_t available) {
+    if (available == 0) {
+        return duckdb::Value(PerfCountersType());
+    }
+    const uint64_t values[NUM_PERF_COUNTERS] = {
+        counters.cycles, counters.instructions, counters.l1d_misses, counters.llc_misses, counters.branch_misses
+    };
+    const char *names[NUM_PERF_COUNTERS] = {"cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses"};
+    duckdb::child_list_t<duckdb::Value> children;
+    for (int i = 0; i < NUM_PERF_COUNTERS; ++i) {
+        children.push_back(std::make_pair(names[i], available & (1 << i)
+                                                        ? duckdb::Value::UBIGINT(values[i])
+                                                        : duckdb::Value(duckdb::LogicalType::UBIGINT)));
+    }
+    return duckdb::Value::STRUCT(std::move(children));
+}
+
+struct ResultRow {
+    Metadata metadata;
+    size_t num_strings;
+    size_t original_size;
+};
+
+// Appends one row, column order must match ResultsSchema()
+inline void AppendResultRow(duckdb::Appender &appender, const ResultRow &row) {
+    const Metadata &metadata = row.metadata;
+    const StageMeasurements &t = metadata.stages;
+    const uint8_t available = metadata.perf_counters_available;
+    const MemoryFootprint &m = metadata.memory;
+
+    appender.BeginRow();
+    appender.Append(metadata.dataset_folders.c_str());
+    appender.Append(metadata.dataset.c_str());
+    appender.Append(metadata.column.c_str());
+    appender.Append<int64_t>(metadata.row_group);
+    appender.Append(metadata.algo.c_str());
+    appender.Append<int64_t>(metadata.amount_of_rows);
+    appender.Append<double>(metadata.run_time_ms);
+    appender.Append<double>(metadata.compression_factor);
+    appender.Append<int64_t>(row.num_strings);
+    appender.Append<int64_t>(row.original_size);
+    for (const StageMeasurement *stage : {&t.sort, &t.chunking, &t.cleave, &t.prefix_training, &t.suffix_training,
+                                          &t.encode, &t.sizing, &t.writing, &t.decompression}) {
+        appender.Append<double>(stage->time_ms);
+    }
+    appender.Append<double>(metadata.decompression_mb_s);
+    appender.Append<double>(metadata.decompression_strings_per_s);
+    appender.Append<int64_t>(metadata.decompression_threads);
+    appender.Append<int64_t>(metadata.permutation_bytes);
+    appender.Append<int64_t>(metadata.bloom_filter_bytes);
+    appender.Append<double>(metadata.bloom_filter_fpr);
+    appender.Append(metadata.storage_codec.c_str());
+    appender.Append<int64_t>(metadata.storage_bytes);
+    appender.Append<int64_t>(metadata.storage_slack_bytes);
+    appender.Append<double>(metadata.duckdb_best_compression_factor);
+    for (const StageMeasurement *stage : {&t.sort, &t.chunking, &t.cleave, &t.prefix_training, &t.suffix_training,
+                                          &t.encode, &t.sizing, &t.writing, &t.decompression}) {
+        appender.Append<duckdb::Value>(PerfCountersToValue(stage->counters, available));
+    }
+    for (const size_t bytes : {m.input_bytes, m.cleaved_bytes, m.prefix_fsst_bytes, m.suffix_fsst_bytes,
+                               m.fsst_plus_buffer_bytes, m.decompression_buffer_bytes, m.arena_bytes}) {
+        appender.Append<int64_t>(bytes);
+    }
+    appender.Append<int64_t>(m.rss_delta_bytes);
+    appender.EndRow();
+}
+
+/*
+ * Shared writer of the results table. It owns its own connection and Appender, so writing results never goes
+ * through the workers' connections or DuckDB's transaction lock per row. Workers don't call it directly but
+ * collect rows in a ResultsBuffer, which only takes the sink's lock once per batch.
+ */
+class ResultsSink {
+public:
+    explicit ResultsSink(duckdb::DuckDB &db) : con(db), appender(con, "results") {}
+
+    void Append(const std::vector<ResultRow> &rows) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const ResultRow &row : rows) {
+            AppendResultRow(appender, row);
+        }
+        appender.Flush();
+    }
+
+    // Call once all ResultsBuffers were flushed, before reading the results table
+    void Close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        appender.Close();
+    }
+
+private:
+    duckdb::Connection con;
+    duckdb::Appender appender;
+    std::mutex mutex;
+};
+
+// Per-worker batch of result rows, flushed into the ResultsSink every config::results_batch_size rows
+class ResultsBuffer {
+public:
+    explicit ResultsBuffer(ResultsSink &sink) : sink(sink) {
+        rows.reserve(config::results_batch_size);
+    }
+
+    ~ResultsBuffer() {
+        try {
+            Flush();
+        } catch (std::exception &e) {
+            std::cerr << "🚨 Failed to flush results: " << e.what() << std::endl;
+        }
+    }
+
+    void Add(const Metadata &metadata, const size_t &num_strings, const size_t &original_size) {
+        rows.push_back(ResultRow{metadata, num_strings, original_size});
+        std::cout << "Buffered " << metadata.algo << " result for " << metadata.dataset << "." << metadata.column << std::endl;
+        if (rows.size() >= config::results_batch_size) {
+            Flush();
+        }
+    }
+
+    void Flush() {
+        if (rows.empty()) {
+            return;
+        }
+        sink.Append(rows);
+        rows.clear();
+    }
+
+private:
+    ResultsSink &sink;
+    std::vector<ResultRow> rows;
+};
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/*
+ * 64-bit string hash that can be fed piece by piece: Update() with a prefix and then with a suffix yields the same hash
+ * as a single Update() with the whole string, so a prefix shared by many strings only has to be hashed once.
+ * Bytes are gathered into little-endian 8-byte words, and the tail and length are mixed in by Finalize().
+ */
+struct StringHasher {
+    uint64_t state = 0x243F6A8885A308D3;
+    uint64_t pending = 0; // bytes of the word being gathered, in its low pending_bytes bytes
+    size_t pending_bytes = 0;
+    size_t length = 0;
+
+    static uint64_t MixWord(const uint64_t state, uint64_t word) {
+        word *= 0x9E3779B97F4A7C15;
+        word ^= word >> 29;
+        const uint64_t mixed = state ^ word;
+        return ((mixed << 27) | (mixed >> 37)) * 0x94D049BB133111EB + 0x165667B19E3779F9;
+    }
+
+    void Update(const unsigned char *data, size_t size) {
+        length += size;
+        while (pending_bytes != 0 && size > 0) {
+            pending |= static_cast<uint64_t>(*data++) << (8 * pending_bytes);
+            size--;
+            if (++pending_bytes == sizeof(uint64_t)) {
+                state = MixWord(state, pending);
+                pending = 0;
+                pending_bytes = 0;
+            }
+        }
+        for (; size >= sizeof(uint64_t); data += sizeof(uint64_t), size -= sizeof(uint64_t)) {
+            uint64_t word;
+            memcpy(&word, data, sizeof(uint64_t)); // little-endian, like the gathered words
+            state = MixWord(state, word);
+        }
+        for (; size > 0; size--) {
+            pending |= static_cast<uint64_t>(*data++) << (8 * pending_bytes++);
+        }
+    }
+
+    uint64_t Finalize() const {
+        uint64_t h = MixWord(MixWord(state, pending), length);
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCD;
+        h ^= h >> 33;
+        h *= 0xC4CEB9FE1A85EC53;
+        h ^= h >> 33;
+        return h;
+    }
+};
+
+inline uint64_t HashString(const unsigned char *data, const size_t size) {
+    StringHasher hasher;
+    hasher.Update(data, size);
+    return hasher.Finalize();
+}
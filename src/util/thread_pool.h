@@ -0,0 +1,111 @@
+#pragma once
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Threads that are started once and then run one job at a time, for parallel scans that are timed: spawning and
+ * joining std::threads per scan would be counted as scan time. Run() hands the job to the num_threads - 1 pool
+ * threads, runs it on the calling thread as well, and returns once every thread finished it. The job splits the work
+ * itself, e.g. by grabbing blocks from a shared counter.
+ *
+ * Usage:
+ *     ThreadPool pool(num_threads); // outside the timed region
+ *     pool.Run([&]() { ... });      // per scan
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(const size_t num_threads) {
+        for (size_t t = 1; t < num_threads; ++t) {
+            threads.emplace_back([this]() { Work(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    size_t NumThreads() const {
+        return threads.size() + 1;
+    }
+
+    // Runs job on every thread of the pool and the calling one. Rethrows the first exception any of them threw
+    void Run(const std::function<void()> &job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            current_job = &job;
+            running = threads.size();
+            error = nullptr;
+            generation++;
+        }
+        wake.notify_all();
+        std::exception_ptr own_error;
+        try {
+            job();
+        } catch (...) {
+            own_error = std::current_exception();
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]() { return running == 0; });
+        current_job = nullptr;
+        if (own_error) {
+            std::rethrow_exception(own_error);
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+private:
+    void Work() {
+        size_t seen_generation = 0;
+        while (true) {
+            const std::function<void()> *job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&]() { return stopping || generation != seen_generation; });
+                if (stopping) {
+                    return;
+                }
+                seen_generation = generation;
+                job = current_job;
+            }
+            std::exception_ptr job_error;
+            try {
+                (*job)();
+            } catch (...) {
+                job_error = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (job_error && !error) {
+                error = job_error;
+            }
+            if (--running == 0) {
+                done.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake; // a new job or stopping
+    std::condition_variable done; // the last pool thread finished the job
+    const std::function<void()> *current_job = nullptr;
+    size_t generation = 0; // jobs handed out so far, pool threads wait for it to change
+    size_t running = 0; // pool threads still running the current job
+    std::exception_ptr error; // first exception a pool thread threw
+    bool stopping = false;
+};
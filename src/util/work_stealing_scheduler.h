@@ -0,0 +1,95 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Task pool for the benchmark workers. Every worker owns a deque: it pushes and pops its own tasks at the back
+ * (so tasks spawned by a task run next, while their data is still warm) and, when its deque is empty, steals
+ * from the front of the other workers' deques. Tasks may push further tasks, e.g. a dataset task pushes one
+ * task per column and row group, so one wide dataset spreads over all workers instead of keeping one busy.
+ *
+ * Usage from each worker:
+ *     while (scheduler.Pop(worker_id, task)) { ...; scheduler.TaskDone(); }
+ */
+template <typename Task>
+class WorkStealingScheduler {
+public:
+    explicit WorkStealingScheduler(const size_t num_workers) {
+        for (size_t i = 0; i < num_workers; ++i) {
+            queues.emplace_back(new WorkerQueue());
+        }
+    }
+
+    size_t NumWorkers() const {
+        return queues.size();
+    }
+
+    void Push(const size_t worker_id, Task task) {
+        pending_tasks.fetch_add(1);
+        WorkerQueue &queue = *queues[worker_id];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+
+    // Must be called once for every task returned by Pop(), after any tasks it spawned were pushed
+    void TaskDone() {
+        pending_tasks.fetch_sub(1);
+    }
+
+    // Returns false once all tasks, including ones still to be spawned by running tasks, are done
+    bool Pop(const size_t worker_id, Task &task) {
+        size_t failed_attempts = 0;
+        while (true) {
+            if (PopOwn(worker_id, task) || Steal(worker_id, task)) {
+                return true;
+            }
+            if (pending_tasks.load() == 0) {
+                return false;
+            }
+            // Other workers are still running tasks that may spawn more work
+            if (++failed_attempts < 64) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(500));
+            }
+        }
+    }
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue> > queues;
+    std::atomic<size_t> pending_tasks{0}; // pushed but not yet done
+
+    bool PopOwn(const size_t worker_id, Task &task) {
+        WorkerQueue &queue = *queues[worker_id];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) {
+            return false;
+        }
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        return true;
+    }
+
+    bool Steal(const size_t worker_id, Task &task) {
+        for (size_t i = 1; i < queues.size(); ++i) {
+            WorkerQueue &victim = *queues[(worker_id + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+};
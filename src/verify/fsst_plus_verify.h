@@ -0,0 +1,271 @@
+#pragma once
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../fsst_plus.h"
+#include "block_decompressor.h"
+#include "bloom_filter.h"
+#include "zone_map.h"
+
+/*
+ * Validation of FSST+ corpora, for corpora loaded from somewhere we do not trust or freshly written ones, so that the
+ * writers and decoders themselves can skip their checks. Every function throws std::logic_error naming the first
+ * problem it finds.
+ *
+ * VerifyFSSTPlusCorpus() only looks at the structure and decodes nothing. It reads every position from the buffer as
+ * an offset and checks it against the buffer's bounds before loading from it, so a broken buffer cannot make it read
+ * out of bounds. VerifyFSSTPlusDecompressedSizes() then decodes every block, which is only safe on a structurally
+ * valid corpus.
+ */
+[[noreturn]] inline void FailVerification(const std::string &what) {
+    throw std::logic_error("Invalid FSST+ corpus: " + what);
+}
+
+inline std::string BlockName(const size_t block) {
+    return "block " + std::to_string(block);
+}
+
+/*
+ * Checks the prefix a reference with length byte prefix_length points at, at position prefix_position of the block:
+ * its bytes must lie within the prefix area [prefix_area_start, prefix_area_end), and a nested prefix's chain of
+ * parents must lead strictly backwards within it.
+ */
+inline void VerifyPrefixReference(const uint8_t *data, const size_t block, uint8_t prefix_length, size_t prefix_position,
+                                  const size_t prefix_area_start, const size_t prefix_area_end) {
+    while (true) {
+        if (prefix_position < prefix_area_start || prefix_position >= prefix_area_end) {
+            FailVerification(BlockName(block) + " references a prefix outside its prefix area");
+        }
+        if (prefix_length != nested_prefix_marker) {
+            if (prefix_position + prefix_length > prefix_area_end) {
+                FailVerification(BlockName(block) + " has a prefix running past its prefix area");
+            }
+            return;
+        }
+        if (prefix_position + nested_prefix_header_size > prefix_area_end ||
+            prefix_position + nested_prefix_header_size + Load<uint8_t>(data + prefix_position) > prefix_area_end) {
+            FailVerification(BlockName(block) + " has a nested prefix running past its prefix area");
+        }
+        const uint16_t parent_jumpback = Load<uint16_t>(data + prefix_position + 2 * sizeof(uint8_t));
+        if (parent_jumpback == 0 || parent_jumpback > prefix_position - prefix_area_start) {
+            FailVerification(BlockName(block) + " has a nested prefix whose parent is not before it in the prefix area");
+        }
+        prefix_length = Load<uint8_t>(data + prefix_position + sizeof(uint8_t));
+        prefix_position -= parent_jumpback;
+    }
+}
+
+/*
+ * Checks the block at [block_begin, block_end) of data: the header fits, every suffix data area offset lands after the
+ * header and within the block in non-decreasing order, every entry's prefix jumpback lands inside the prefix area and
+ * every entry, the last one ending at block_stop, is long enough for its own header. Returns n_strings.
+ */
+inline size_t VerifyFSSTPlusBlock(const uint8_t *data, const size_t block, const size_t block_begin, const size_t block_end) {
+    if (block_end - block_begin > config::block_byte_capacity) {
+        FailVerification(BlockName(block) + " is larger than config::block_byte_capacity");
+    }
+    const size_t n_strings = Load<uint8_t>(data + block_begin);
+    const size_t header_end = block_begin + sizeof(uint8_t) + n_strings * (sizeof(uint16_t) + sizeof(uint8_t));
+    if (n_strings == 0 || header_end >= block_end) {
+        FailVerification(BlockName(block) + " has no strings or its header does not fit");
+    }
+
+    std::vector<size_t> suffix_data_areas(n_strings);
+    for (size_t i = 0; i < n_strings; i++) {
+        const size_t offset_position = block_begin + sizeof(uint8_t) + i * sizeof(uint16_t);
+        suffix_data_areas[i] = offset_position + sizeof(uint16_t) + Load<uint16_t>(data + offset_position);
+        if (suffix_data_areas[i] < header_end || suffix_data_areas[i] >= block_end) {
+            FailVerification(BlockName(block) + " has suffix offset " + std::to_string(i) + " outside the block");
+        }
+        if (i > 0 && suffix_data_areas[i] < suffix_data_areas[i - 1]) {
+            FailVerification(BlockName(block) + " has suffix offsets that are not in order at " + std::to_string(i));
+        }
+    }
+
+    // The prefix area lies between the header and the first suffix data area
+    const size_t prefix_area_end = suffix_data_areas[0];
+    for (size_t i = 0; i < n_strings; i++) {
+        if (i > 0 && suffix_data_areas[i] == suffix_data_areas[i - 1]) {
+            continue; // duplicate of the previous string
+        }
+        size_t entry_end = block_end;
+        for (size_t j = i + 1; j < n_strings; j++) {
+            if (suffix_data_areas[j] != suffix_data_areas[i]) {
+                entry_end = suffix_data_areas[j];
+                break;
+            }
+        }
+        const size_t entry = suffix_data_areas[i];
+        const uint8_t prefix_length = Load<uint8_t>(data + entry);
+        if (prefix_length == 0) {
+            continue;
+        }
+        if (entry + sizeof(uint8_t) + sizeof(uint16_t) > entry_end) {
+            FailVerification(BlockName(block) + " has a suffix entry " + std::to_string(i) + " too short for its prefix reference");
+        }
+        const uint16_t jumpback = Load<uint16_t>(data + entry + sizeof(uint8_t));
+        if (jumpback > entry - header_end) {
+            FailVerification(BlockName(block) + " has a prefix jumpback of string " + std::to_string(i) + " before the prefix area");
+        }
+        VerifyPrefixReference(data, block, prefix_length, entry - jumpback, header_end, prefix_area_end);
+    }
+    return n_strings;
+}
+
+/*
+ * Checks the global header and every block of the corpus at [data_start, data_end): block offsets in increasing order
+ * from the end of the header up to data_end, decompressed offsets and run starts non-decreasing, and every valid row
+ * stored exactly once, in a block of its own run.
+ */
+inline void VerifyFSSTPlusCorpus(const uint8_t *data_start, const uint8_t *data_end) {
+    const size_t size = data_end - data_start;
+    if (size < sizeof(uint16_t)) {
+        FailVerification("buffer too small for num_blocks");
+    }
+    const size_t num_blocks = Load<uint16_t>(data_start);
+    const size_t fixed_header_size = sizeof(uint16_t) + (num_blocks + 1) * sizeof(uint32_t) + (num_blocks + 1) * sizeof(uint32_t) +
+                                     num_blocks * sizeof(uint32_t) + sizeof(uint32_t);
+    if (fixed_header_size > size) {
+        FailVerification("buffer too small for the global header of " + std::to_string(num_blocks) + " blocks");
+    }
+    const size_t num_rows = LoadNumRows(data_start);
+    const size_t header_size = fixed_header_size + (num_rows + 7) / 8;
+    if (header_size > size) {
+        FailVerification("buffer too small for the validity bitmap of " + std::to_string(num_rows) + " rows");
+    }
+
+    // block_start_offsets[] and data_end_offset, each relative to where it is stored
+    std::vector<size_t> block_positions(num_blocks + 1);
+    for (size_t i = 0; i <= num_blocks; i++) {
+        const size_t offset_position = sizeof(uint16_t) + i * sizeof(uint32_t);
+        block_positions[i] = offset_position + Load<uint32_t>(data_start + offset_position);
+        if (block_positions[i] > size) {
+            FailVerification(BlockName(i) + " starts past the end of the buffer");
+        }
+        if (i > 0 && block_positions[i] <= block_positions[i - 1]) {
+            FailVerification(BlockName(i) + " does not start after " + BlockName(i - 1));
+        }
+    }
+    if (block_positions[0] != header_size) {
+        FailVerification("the first block does not start right after the global header");
+    }
+    if (block_positions[num_blocks] != size) {
+        FailVerification("data_end_offset does not point at the end of the buffer");
+    }
+
+    if (LoadDecompressedOffset(data_start, 0) != 0) {
+        FailVerification("decompressed_offsets[] does not start at 0");
+    }
+    for (size_t i = 0; i < num_blocks; i++) {
+        if (LoadDecompressedOffset(data_start, i + 1) < LoadDecompressedOffset(data_start, i)) {
+            FailVerification("decompressed_offsets[] decreases at " + BlockName(i));
+        }
+        if (LoadBlockRunStart(data_start, i) >= num_rows || (i > 0 && LoadBlockRunStart(data_start, i) < LoadBlockRunStart(data_start, i - 1))) {
+            FailVerification("block_run_starts[] is out of range or decreases at " + BlockName(i));
+        }
+    }
+
+    const uint8_t *validity = FindValidity(data_start);
+    std::vector<bool> stored(num_rows);
+    size_t run_end = 0;
+    for (size_t i = 0; i < num_blocks; i++) {
+        const size_t n_strings = VerifyFSSTPlusBlock(data_start, i, block_positions[i], block_positions[i + 1]);
+        const size_t run_start = LoadBlockRunStart(data_start, i);
+        if (i == 0 || run_start != LoadBlockRunStart(data_start, i - 1)) {
+            const size_t next_run = FindFirstBlockAfterRow(data_start, i, run_start);
+            run_end = next_run < num_blocks ? LoadBlockRunStart(data_start, next_run) : num_rows;
+        }
+        const uint8_t *rows = data_start + block_positions[i] + sizeof(uint8_t) + n_strings * sizeof(uint16_t);
+        for (size_t k = 0; k < n_strings; k++) {
+            const size_t row = run_start + rows[k];
+            if (row >= run_end || !RowIsValid(validity, row) || stored[row]) {
+                FailVerification(BlockName(i) + " stores row " + std::to_string(row) +
+                                 ", which is outside its run, NULL or already stored");
+            }
+            stored[row] = true;
+        }
+    }
+    for (size_t row = 0; row < num_rows; row++) {
+        if (RowIsValid(validity, row) && !stored[row]) {
+            FailVerification("valid row " + std::to_string(row) + " is in no block");
+        }
+    }
+}
+
+// Checks that the zone map at [zone_map_start, zone_map_end) has one entry per block, each with min <= max
+inline void VerifyZoneMap(const uint8_t *zone_map_start, const uint8_t *zone_map_end, const size_t num_blocks) {
+    if (static_cast<size_t>(zone_map_end - zone_map_start) != sizeof(uint16_t) + num_blocks * zone_map_entry_size ||
+        Load<uint16_t>(zone_map_start) != num_blocks) {
+        FailVerification("the zone map does not have one entry per block");
+    }
+    for (size_t i = 0; i < num_blocks; i++) {
+        const uint8_t *entry = zone_map_start + sizeof(uint16_t) + i * zone_map_entry_size;
+        const size_t min_length = Load<uint8_t>(entry);
+        const size_t max_length = Load<uint8_t>(entry + sizeof(uint8_t));
+        const uint8_t *min_key = entry + 2 * sizeof(uint8_t);
+        const uint8_t *max_key = min_key + config::zone_map_key_size;
+        if (min_length > config::zone_map_key_size || max_length > config::zone_map_key_size ||
+            CompareStrings(min_key, min_length, max_key, max_length) > 0) {
+            FailVerification("the zone map entry of " + BlockName(i) + " has bad key lengths or min > max");
+        }
+    }
+}
+
+// Checks that the Bloom filters at [bloom_filter_start, bloom_filter_end) give every block at least one bucket
+inline void VerifyBloomFilters(const uint8_t *bloom_filter_start, const uint8_t *bloom_filter_end, const size_t num_blocks) {
+    const size_t size = bloom_filter_end - bloom_filter_start;
+    const size_t header_size = sizeof(uint16_t) + (num_blocks + 1) * sizeof(uint32_t);
+    if (size < header_size || Load<uint16_t>(bloom_filter_start) != num_blocks || LoadBloomFilterBucketOffset(bloom_filter_start, 0) != 0) {
+        FailVerification("the Bloom filters do not cover every block");
+    }
+    for (size_t i = 0; i < num_blocks; i++) {
+        if (LoadBloomFilterBucketOffset(bloom_filter_start, i + 1) <= LoadBloomFilterBucketOffset(bloom_filter_start, i)) {
+            FailVerification("the Bloom filter of " + BlockName(i) + " has no buckets");
+        }
+    }
+    if (header_size + LoadBloomFilterBucketOffset(bloom_filter_start, num_blocks) * bloom_filter_bucket_size != size) {
+        FailVerification("the Bloom filter buckets do not end at bloom_filter_end");
+    }
+}
+
+// Structural checks of the corpus and its side tables, see VerifyFSSTPlusCorpus()
+inline void VerifyFSSTPlusCompressionResult(const FSSTPlusCompressionResult &compression_result) {
+    VerifyFSSTPlusCorpus(compression_result.data_start, compression_result.data_end);
+    const size_t num_blocks = Load<uint16_t>(compression_result.data_start);
+    VerifyZoneMap(compression_result.zone_map_start, compression_result.zone_map_end, num_blocks);
+    if (compression_result.bloom_filter_start != nullptr) {
+        VerifyBloomFilters(compression_result.bloom_filter_start, compression_result.bloom_filter_end, num_blocks);
+    }
+}
+
+/*
+ * Decodes every block of a structurally valid corpus (see VerifyFSSTPlusCorpus()) and checks that it takes exactly
+ * the bytes decompressed_offsets[] gives it, which is what sizes every output buffer.
+ */
+inline void VerifyFSSTPlusDecompressedSizes(uint8_t *global_header, const fsst_decoder_t &prefix_decoder, const fsst_decoder_t &suffix_decoder) {
+    constexpr size_t decompression_padding = 32;
+    constexpr size_t max_symbol_length = 8; // an FSST code decodes to at most 8 bytes
+    const size_t num_blocks = Load<uint16_t>(global_header);
+    uint8_t *block_start_offsets = global_header + sizeof(uint16_t);
+    // A string decodes from distinct bytes of its block (its prefix chain and its suffix), so one block's worth is enough
+    std::vector<unsigned char> out(config::block_byte_capacity * max_symbol_length + decompression_padding);
+    for (size_t i = 0; i < num_blocks; i++) {
+        const uint8_t *block_start = FindBlockStart(block_start_offsets, i);
+        const uint8_t *block_stop = FindBlockStart(block_start_offsets, i + 1);
+        const size_t n_strings = Load<uint8_t>(block_start);
+        size_t block_size = 0;
+        size_t string_size = 0;
+        for (size_t k = 0; k < n_strings; k++) {
+            if (k == 0 || FindSuffixDataArea(block_start, k) != FindSuffixDataArea(block_start, k - 1)) {
+                string_size = DecompressBlockString(block_start, n_strings, k, prefix_decoder, suffix_decoder, block_stop,
+                                                    out.data(), out.data() + out.size());
+            }
+            block_size += string_size;
+        }
+        const size_t expected = LoadDecompressedOffset(global_header, i + 1) - LoadDecompressedOffset(global_header, i);
+        if (block_size != expected) {
+            FailVerification(BlockName(i) + " decodes to " + std::to_string(block_size) + " bytes, decompressed_offsets[] says " +
+                             std::to_string(expected));
+        }
+    }
+}
@@ -0,0 +1,197 @@
+#pragma once
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+#include <vector>
+#include "arena.h"
+#include "block_decompressor.h"
+#include "block_types.h"
+#include "cleaving_types.h"
+
+/*
+ * Per-block zone map: the smallest and largest string of every block, truncated to config::zone_map_key_size bytes,
+ * so that range and equality filters can skip blocks without decoding them. Strings compare byte-wise, a string
+ * before the longer strings it is a prefix of, the way DuckDB compares VARCHARs.
+ *
+ * Zone map section layout:
+ *   uint16_t num_blocks
+ *   per block, zone_map_entry_size bytes:
+ *     uint8_t min_length, uint8_t max_length
+ *     min_key[config::zone_map_key_size]   every string of the block is >= min_key
+ *     max_key[config::zone_map_key_size]   every string of the block truncated to the key size is <= max_key
+ */
+constexpr size_t zone_map_entry_size = 2 * sizeof(uint8_t) + 2 * config::zone_map_key_size;
+static_assert(config::zone_map_key_size <= UINT8_MAX, "Zone map key lengths are stored in a uint8_t");
+
+inline int CompareStrings(const unsigned char *a, const size_t a_length, const unsigned char *b, const size_t b_length) {
+    const int cmp = memcmp(a, b, std::min(a_length, b_length));
+    if (cmp != 0) {
+        return cmp;
+    }
+    return a_length < b_length ? -1 : a_length > b_length ? 1 : 0;
+}
+
+/*
+ * Writes the zone map of the blocks described by wms into the worker's ThreadArena() and returns its start, its end
+ * goes to zone_map_end. A string's bytes are still in one piece before cleaving: its suffix pointer minus its
+ * chunk's prefix_length is where it starts.
+ */
+inline uint8_t *WriteZoneMap(const std::vector<BlockWritingMetadata> &wms, const std::vector<SimilarityChunk> &similarity_chunks,
+                             const CleavedResult &cleaved_result, uint8_t *&zone_map_end) {
+    uint8_t *zone_map_start = ThreadArena().Allocate(sizeof(uint16_t) + wms.size() * zone_map_entry_size);
+    Store<uint16_t>(wms.size(), zone_map_start);
+    uint8_t *entry = zone_map_start + sizeof(uint16_t);
+    for (const BlockWritingMetadata &wm : wms) {
+        const unsigned char *min_key = nullptr, *max_key = nullptr;
+        size_t min_length = 0, max_length = 0;
+        for (size_t k = 0; k < wm.number_of_suffixes; k++) {
+            const size_t suffix_index = wm.suffix_area_start_index + k;
+            const size_t prefix_length = similarity_chunks[wm.prefix_area_start_index + wm.suffix_prefix_index[k]].prefix_length;
+            const unsigned char *key = cleaved_result.suffixes.string_ptrs[suffix_index] - prefix_length;
+            const size_t key_length = std::min(prefix_length + cleaved_result.suffixes.lengths[suffix_index], config::zone_map_key_size);
+            if (k == 0 || CompareStrings(key, key_length, min_key, min_length) < 0) {
+                min_key = key;
+                min_length = key_length;
+            }
+            if (k == 0 || CompareStrings(key, key_length, max_key, max_length) > 0) {
+                max_key = key;
+                max_length = key_length;
+            }
+        }
+        Store<uint8_t>(min_length, entry);
+        Store<uint8_t>(max_length, entry + sizeof(uint8_t));
+        memset(entry + 2 * sizeof(uint8_t), 0, 2 * config::zone_map_key_size);
+        if (min_length > 0) {
+            memcpy(entry + 2 * sizeof(uint8_t), min_key, min_length);
+        }
+        if (max_length > 0) {
+            memcpy(entry + 2 * sizeof(uint8_t) + config::zone_map_key_size, max_key, max_length);
+        }
+        entry += zone_map_entry_size;
+    }
+    zone_map_end = entry;
+    return zone_map_start;
+}
+
+/*
+ * A range over strings, open on a side without a bound. The bounds point at bytes owned by the caller.
+ * Build one with ZoneMapEquals(), ZoneMapLess(), ZoneMapGreater() or ZoneMapBetween().
+ */
+struct ZoneMapFilter {
+    const unsigned char *lower;
+    size_t lower_length;
+    bool has_lower;
+    bool lower_inclusive;
+    const unsigned char *upper;
+    size_t upper_length;
+    bool has_upper;
+    bool upper_inclusive;
+
+    bool Matches(const unsigned char *str, const size_t length) const {
+        if (has_lower) {
+            const int cmp = CompareStrings(str, length, lower, lower_length);
+            if (cmp < 0 || (cmp == 0 && !lower_inclusive)) {
+                return false;
+            }
+        }
+        if (has_upper) {
+            const int cmp = CompareStrings(str, length, upper, upper_length);
+            if (cmp > 0 || (cmp == 0 && !upper_inclusive)) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+inline ZoneMapFilter ZoneMapEquals(const unsigned char *value, const size_t length) {
+    return ZoneMapFilter{value, length, true, true, value, length, true, true};
+}
+
+inline ZoneMapFilter ZoneMapLess(const unsigned char *value, const size_t length, const bool inclusive = false) {
+    return ZoneMapFilter{nullptr, 0, false, false, value, length, true, inclusive};
+}
+
+inline ZoneMapFilter ZoneMapGreater(const unsigned char *value, const size_t length, const bool inclusive = false) {
+    return ZoneMapFilter{value, length, true, inclusive, nullptr, 0, false, false};
+}
+
+// BETWEEN lower AND upper, both ends included
+inline ZoneMapFilter ZoneMapBetween(const unsigned char *lower, const size_t lower_length,
+                                    const unsigned char *upper, const size_t upper_length) {
+    return ZoneMapFilter{lower, lower_length, true, true, upper, upper_length, true, true};
+}
+
+/*
+ * Whether block i may hold a string in the filter's range, from its zone map entry alone:
+ * no string can reach the lower bound if max_key is below the bound truncated to the key size,
+ * and none can stay under the upper bound if min_key is already past it.
+ */
+inline bool ZoneMapBlockMayMatch(const uint8_t *zone_map_start, const size_t i, const ZoneMapFilter &filter) {
+    const uint8_t *entry = zone_map_start + sizeof(uint16_t) + i * zone_map_entry_size;
+    const size_t min_length = Load<uint8_t>(entry);
+    const size_t max_length = Load<uint8_t>(entry + sizeof(uint8_t));
+    const unsigned char *min_key = entry + 2 * sizeof(uint8_t);
+    const unsigned char *max_key = min_key + config::zone_map_key_size;
+    if (filter.has_lower &&
+        CompareStrings(max_key, max_length, filter.lower, std::min(filter.lower_length, config::zone_map_key_size)) < 0) {
+        return false;
+    }
+    if (filter.has_upper) {
+        const int cmp = CompareStrings(min_key, min_length, filter.upper, filter.upper_length);
+        if (cmp > 0 || (cmp == 0 && !filter.upper_inclusive)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Filtered scan: decodes only the blocks whose zone map entry may match, into out, and returns the rows whose string
+ * is in the filter's range in ascending row order, along with their strings. Returns the number of decoded blocks.
+ */
+inline size_t ZoneMapScan(uint8_t *global_header, const uint8_t *zone_map_start, const fsst_decoder_t &prefix_decoder,
+                          const fsst_decoder_t &suffix_decoder, const ZoneMapFilter &filter,
+                          unsigned char *out, const unsigned char *out_end, std::vector<uint32_t> &matching_rows,
+                          std::vector<const unsigned char *> &out_ptrs, std::vector<size_t> &out_lengths) {
+    const uint16_t num_blocks = Load<uint16_t>(global_header);
+    if (Load<uint16_t>(zone_map_start) != num_blocks) {
+        throw std::logic_error("Zone map covers " + std::to_string(Load<uint16_t>(zone_map_start)) + " blocks, the corpus has " +
+                               std::to_string(num_blocks));
+    }
+    uint8_t *block_start_offsets = global_header + sizeof(uint16_t);
+    const unsigned char *run_ptrs[UINT8_MAX + 1];
+    size_t run_lengths[UINT8_MAX + 1];
+
+    std::vector<std::tuple<uint32_t, const unsigned char *, size_t>> matches;
+    size_t decoded_blocks = 0;
+    for (size_t i = 0; i < num_blocks; i++) {
+        if (!ZoneMapBlockMayMatch(zone_map_start, i, filter)) {
+            continue;
+        }
+        const uint8_t *block_start = FindBlockStart(block_start_offsets, i);
+        const size_t n_strings = DecompressBlock(block_start, prefix_decoder, suffix_decoder, FindBlockStart(block_start_offsets, i + 1),
+                                                 out, out_end, run_ptrs, run_lengths);
+        decoded_blocks++;
+        const size_t run_start = LoadBlockRunStart(global_header, i);
+        const uint8_t *rows = block_start + sizeof(uint8_t) + n_strings * sizeof(uint16_t);
+        for (size_t k = 0; k < n_strings; k++) {
+            const uint8_t row = rows[k];
+            if (filter.Matches(run_ptrs[row], run_lengths[row])) {
+                matches.emplace_back(run_start + row, run_ptrs[row], run_lengths[row]);
+            }
+        }
+    }
+
+    // A run's strings are spread over its blocks in sorted order, put them back in row order
+    std::sort(matches.begin(), matches.end());
+    matching_rows.clear();
+    out_ptrs.clear();
+    out_lengths.clear();
+    for (const auto &match : matches) {
+        matching_rows.push_back(std::get<0>(match));
+        out_ptrs.push_back(std::get<1>(match));
+        out_lengths.push_back(std::get<2>(match));
+    }
+    return decoded_blocks;
+}
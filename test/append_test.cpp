@@ -0,0 +1,122 @@
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+#include "../src/fsst_plus.h"
+#include "fsst_plus_append.h"
+#include "fsst_plus_verify.h"
+#include "test_helpers.h"
+
+static std::vector<std::string> GenerateUrls(const size_t n, const unsigned seed) {
+    std::mt19937 rng(seed);
+    std::vector<std::string> corpus(n);
+    for (size_t i = 0; i < n; i++) {
+        corpus[i] = "https://example.com/products/" + std::to_string(rng() % 50) + "/item?id=" + std::to_string(rng() % 1000);
+    }
+    return corpus;
+}
+
+// Every seventh row of the column is NULL, counting from the first row of the segment
+static std::function<bool(size_t)> NullsFrom(const size_t first_row) {
+    return [first_row](const size_t row) { return (first_row + row) % 7 == 2; };
+}
+
+// Decodes the whole corpus and compares it with the rows of both parts
+static void RequireCorpus(const FSSTPlusCompressionResult &segment, const std::vector<std::string> &first, const std::vector<std::string> &second) {
+    const fsst_decoder_t prefix_decoder = fsst_decoder(segment.prefix_encoder);
+    const fsst_decoder_t suffix_decoder = fsst_decoder(segment.suffix_encoder);
+    std::vector<std::string> all = first;
+    all.insert(all.end(), second.begin(), second.end());
+    const StringCollection expected = ToStringCollection(all, NullsFrom(0));
+    REQUIRE(LoadNumRows(segment.data_start) == all.size());
+    REQUIRE_NOTHROW(VerifyFSSTPlusCompressionResult(segment));
+    REQUIRE_NOTHROW(VerifyFSSTPlusDecompressedSizes(segment.data_start, prefix_decoder, suffix_decoder));
+
+    uint8_t *global_header = segment.data_start;
+    std::vector<unsigned char> out(LoadDecompressedOffset(global_header, Load<uint16_t>(global_header)) + 32);
+    std::vector<const unsigned char *> out_ptrs(all.size());
+    std::vector<size_t> out_lengths(all.size());
+    DecompressAll(global_header, prefix_decoder, suffix_decoder, out.data(), out.size(), out_ptrs, out_lengths);
+    REQUIRE_NOTHROW(VerifyDecompression(out_ptrs, out_lengths, expected.lengths, expected.string_ptrs));
+}
+
+TEST_CASE("Appending keeps the blocks of complete runs and reuses the symbol tables", "[append]") {
+    StageMeasurements stages;
+    MemoryFootprint memory;
+    const std::vector<std::string> first = GenerateUrls(1000, 1); // the last run holds 1000 % 128 = 104 rows
+    const std::vector<std::string> second = GenerateUrls(700, 2);
+    const CompressedCorpus old(first, NullsFrom(0));
+    const FSSTPlusCompressionResult &segment = old.compression_result;
+
+    const FSSTPlusAppendResult appended = FSSTPlusAppend(segment, ToStringCollection(second, NullsFrom(first.size())), test::block_granularity,
+                                                         stages, memory);
+    REQUIRE_FALSE(appended.retrained);
+    REQUIRE(appended.segment.prefix_encoder == segment.prefix_encoder);
+    RequireCorpus(appended.segment, first, second);
+
+    // Only the spliced corpus counts, not the tail it was put together from
+    REQUIRE(memory.fsst_plus_buffer_bytes == static_cast<size_t>((appended.segment.data_end - appended.segment.data_start) +
+                                                                 (appended.segment.zone_map_end - appended.segment.zone_map_start) +
+                                                                 (appended.segment.bloom_filter_end - appended.segment.bloom_filter_start)));
+
+    // The blocks of the first 896 rows are copied as they were
+    uint8_t *old_offsets = segment.data_start + sizeof(uint16_t);
+    uint8_t *new_offsets = appended.segment.data_start + sizeof(uint16_t);
+    const size_t kept_blocks = FindFirstBlockAfterRow(segment.data_start, 0, 895);
+    const size_t kept_size = FindBlockStart(old_offsets, kept_blocks) - FindBlockStart(old_offsets, 0);
+    REQUIRE(kept_blocks > 0);
+    REQUIRE(FindBlockStart(new_offsets, kept_blocks) - FindBlockStart(new_offsets, 0) == kept_size);
+    REQUIRE(memcmp(FindBlockStart(new_offsets, 0), FindBlockStart(old_offsets, 0), kept_size) == 0);
+
+    // Zone map and Bloom filters cover the appended blocks too
+    const size_t num_blocks = Load<uint16_t>(appended.segment.data_start);
+    REQUIRE(Load<uint16_t>(appended.segment.zone_map_start) == num_blocks);
+    REQUIRE(Load<uint16_t>(appended.segment.bloom_filter_start) == num_blocks);
+    const fsst_decoder_t prefix_decoder = fsst_decoder(appended.segment.prefix_encoder);
+    const fsst_decoder_t suffix_decoder = fsst_decoder(appended.segment.suffix_encoder);
+    std::vector<unsigned char> out(LoadDecompressedOffset(appended.segment.data_start, num_blocks) + 32);
+    std::vector<uint32_t> matching_rows;
+    const std::string &value = second[600];
+    BloomFilterLookup(appended.segment.data_start, appended.segment.bloom_filter_start, prefix_decoder, suffix_decoder,
+                      reinterpret_cast<const unsigned char *>(value.data()), value.size(), out.data(), out.data() + out.size(), matching_rows);
+    REQUIRE(std::find(matching_rows.begin(), matching_rows.end(), first.size() + 600) != matching_rows.end());
+
+    // Appending to the appended corpus up to a run boundary (1792 = 14 * 128 rows), and then past it, with no partial run to redo
+    const std::vector<std::string> third = GenerateUrls(92, 3);
+    const FSSTPlusAppendResult appended_again = FSSTPlusAppend(appended.segment, ToStringCollection(third, NullsFrom(1700)), test::block_granularity,
+                                                               stages, memory);
+    REQUIRE_FALSE(appended_again.retrained);
+    std::vector<std::string> first_three = first;
+    first_three.insert(first_three.end(), second.begin(), second.end());
+    RequireCorpus(appended_again.segment, first_three, third);
+
+    first_three.insert(first_three.end(), third.begin(), third.end());
+    const std::vector<std::string> fourth = GenerateUrls(50, 4);
+    const size_t old_blocks = Load<uint16_t>(appended_again.segment.data_start);
+    const FSSTPlusAppendResult appended_on_boundary = FSSTPlusAppend(appended_again.segment, ToStringCollection(fourth, NullsFrom(1792)),
+                                                                     test::block_granularity, stages, memory);
+    REQUIRE_FALSE(appended_on_boundary.retrained);
+    REQUIRE(Load<uint16_t>(appended_on_boundary.segment.data_start) > old_blocks);
+    RequireCorpus(appended_on_boundary.segment, first_three, fourth);
+}
+
+TEST_CASE("Appending strings unlike the old ones retrains the symbol tables", "[append]") {
+    StageMeasurements stages;
+    MemoryFootprint memory;
+    const std::vector<std::string> first = GenerateUrls(1000, 4);
+    std::mt19937 rng(5);
+    std::vector<std::string> second(500);
+    for (std::string &s : second) {
+        for (size_t k = 0; k < 40; k++) {
+            s.push_back(static_cast<char>(rng()));
+        }
+    }
+    const CompressedCorpus old(first, NullsFrom(0));
+    const FSSTPlusCompressionResult &segment = old.compression_result;
+    const FSSTPlusAppendResult appended = FSSTPlusAppend(segment, ToStringCollection(second, NullsFrom(first.size())), test::block_granularity,
+                                                         stages, memory);
+    REQUIRE(appended.retrained);
+    REQUIRE(appended.segment.prefix_encoder != segment.prefix_encoder);
+    RequireCorpus(appended.segment, first, second);
+
+    fsst_destroy(appended.segment.prefix_encoder);
+    fsst_destroy(appended.segment.suffix_encoder);
+}
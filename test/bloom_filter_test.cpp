@@ -0,0 +1,61 @@
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+#include "../src/fsst_plus.h"
+#include "bloom_filter.h"
+#include "string_hash.h"
+#include "test_helpers.h"
+
+TEST_CASE("HashString() does not depend on how the string is split", "[bloom_filter]") {
+    const std::string s = "https://example.com/products/shoes/running?size=42";
+    const auto *bytes = reinterpret_cast<const unsigned char *>(s.data());
+    for (size_t split = 0; split <= s.size(); split++) {
+        StringHasher hasher;
+        hasher.Update(bytes, split);
+        hasher.Update(bytes + split, s.size() - split);
+        REQUIRE(hasher.Finalize() == HashString(bytes, s.size()));
+    }
+    REQUIRE(HashString(bytes, 8) != HashString(bytes, 9));
+    REQUIRE(HashString(bytes, 8) != HashString(bytes + 1, 8));
+}
+
+TEST_CASE("Bloom filters let point lookups skip blocks", "[bloom_filter]") {
+    constexpr size_t n = 64 * test::block_granularity;
+    std::mt19937 rng(8);
+    std::vector<std::string> corpus(n);
+    for (size_t i = 0; i < n; i++) {
+        corpus[i] = "user-" + std::to_string(rng() % 20000) + "@mail.example.com";
+    }
+    corpus[777] = corpus[5000]; // one value in two runs
+    const CompressedCorpus c(corpus, [](const size_t row) { return row % 13 == 0; });
+
+    uint8_t *global_header = c.compression_result.data_start;
+    const uint8_t *bloom_filter_start = c.compression_result.bloom_filter_start;
+    const size_t num_blocks = Load<uint16_t>(global_header);
+    REQUIRE(bloom_filter_start != nullptr);
+    REQUIRE(Load<uint16_t>(bloom_filter_start) == num_blocks);
+
+    // 10 bits per key keep false positives around 1%
+    REQUIRE(BloomFilterFalsePositiveRate(bloom_filter_start, 1000) < 0.03);
+
+    std::vector<unsigned char> out(LoadDecompressedOffset(global_header, num_blocks) + 32);
+    std::vector<uint32_t> matching_rows;
+    for (const size_t row : {1, 777, 5000, 8191}) {
+        const size_t decoded_blocks = BloomFilterLookup(global_header, bloom_filter_start, c.prefix_decoder, c.suffix_decoder,
+                                                        reinterpret_cast<const unsigned char *>(corpus[row].data()), corpus[row].size(),
+                                                        out.data(), out.data() + out.size(), matching_rows);
+        std::vector<uint32_t> expected_rows;
+        for (size_t i = 0; i < n; i++) {
+            if (c.input.string_ptrs[i] != nullptr && corpus[i] == corpus[row]) {
+                expected_rows.push_back(i);
+            }
+        }
+        REQUIRE(matching_rows == expected_rows);
+        REQUIRE(decoded_blocks < num_blocks / 4);
+    }
+
+    const std::string missing = "nobody@mail.example.com";
+    REQUIRE(BloomFilterLookup(global_header, bloom_filter_start, c.prefix_decoder, c.suffix_decoder,
+                              reinterpret_cast<const unsigned char *>(missing.data()), missing.size(),
+                              out.data(), out.data() + out.size(), matching_rows) < num_blocks / 4);
+    REQUIRE(matching_rows.empty());
+}
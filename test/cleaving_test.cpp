@@ -5,6 +5,13 @@
 #include "cleaving.h"
 #include <catch2/catch_test_macros.hpp>
 
+namespace config {
+    constexpr size_t total_strings = 100000;
+    constexpr bool print_sorted_corpus = false;
+    constexpr bool print_split_points = false;
+    constexpr bool print_decompressed_corpus = false;
+}
+
 // Function to compare expected chunks with actual chunks
 // void validate_chunks(...) -> No longer needed with Catch2 assertions
 
@@ -384,6 +391,48 @@ TEST_CASE("Test Case 13: Chose a more general prefix instead of specific ones",
     }
 }
 
+TEST_CASE("Test Case 16: Nested Prefixes", "[cleaving]") {
+    // A group sharing the catalog path, followed by a deeper group that extends it
+    std::vector<std::string> strings;
+    for (const std::string category : {"audio", "books", "cameras", "games"}) {
+        strings.push_back("https://shop.example.com/catalog/" + category);
+    }
+    for (size_t i = 0; i < 6; ++i) {
+        strings.push_back("https://shop.example.com/catalog/phones/smart/model-" + std::to_string(i));
+    }
+    std::vector<size_t> lenIn;
+    std::vector<const unsigned char*> strIn;
+    for (const auto& s : strings) {
+        lenIn.push_back(s.size());
+        strIn.push_back(reinterpret_cast<const unsigned char*>(s.c_str()));
+    }
+
+    auto actual_chunks = FormSimilarityChunks(lenIn, strIn, 0, strIn.size());
+
+    REQUIRE(actual_chunks.size() >= 2);
+    REQUIRE_FALSE(actual_chunks[0].nested);
+    size_t nested_chunks = 0;
+    for (size_t i = 1; i < actual_chunks.size(); ++i) {
+        if (!actual_chunks[i].nested) {
+            continue;
+        }
+        nested_chunks++;
+        // The parent's prefix is a strict prefix of this chunk's prefix
+        const size_t parent_length = actual_chunks[i - 1].prefix_length;
+        REQUIRE(parent_length < actual_chunks[i].prefix_length);
+        REQUIRE(strings[actual_chunks[i].start_index].compare(0, parent_length, strings[actual_chunks[i - 1].start_index], 0, parent_length) == 0);
+    }
+    REQUIRE(nested_chunks > 0);
+
+    // Cleave() only keeps the part of a nested prefix after its parent
+    CleavedResult cleaved_result = Cleave(lenIn, strIn, actual_chunks, strIn.size());
+    for (size_t i = 0; i < actual_chunks.size(); ++i) {
+        const size_t parent_length = actual_chunks[i].nested ? actual_chunks[i - 1].prefix_length : 0;
+        REQUIRE(cleaved_result.prefixes.lengths[i] == actual_chunks[i].prefix_length - parent_length);
+        REQUIRE(cleaved_result.prefixes.string_ptrs[i] == strIn[actual_chunks[i].start_index] + parent_length);
+    }
+}
+
 // Remove the final success message and return statement
 // std::cout << "All tests passed successfully.
 // ";
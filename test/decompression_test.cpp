@@ -0,0 +1,439 @@
+#include <catch2/catch_test_macros.hpp>
+#include <functional>
+#include <numeric>
+#include <random>
+#include <set>
+#include "../src/fsst_plus.h"
+#include "block_decompressor.h"
+#include "block_hasher.h"
+#include "block_vector_scan.h"
+#include "cleaving.h"
+#include "test_helpers.h"
+
+// URL-like strings with shared prefixes, plus empty and long strings so some blocks fill up before 128 strings
+static std::vector<std::string> GenerateCorpus(const size_t n) {
+    std::mt19937 rng(42);
+    std::vector<std::string> corpus;
+    corpus.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        std::string s = "https://example.com/" + std::string(rng() % 3 ? "products/" : "category/") +
+                        std::to_string(rng() % 50) + "/item?id=" + std::to_string(rng() % 1000);
+        if (rng() % 10 == 0) s = "";
+        if (rng() % 7 == 0) s = std::string(200 + rng() % 300, static_cast<char>('a' + rng() % 3));
+        corpus.push_back(s);
+    }
+    return corpus;
+}
+
+static bool NoNulls(size_t) {
+    return false;
+}
+
+// Every fifth row, plus a whole cleaving run
+static bool SomeNulls(const size_t row) {
+    return row % 5 == 3 || (row >= 2 * test::block_granularity && row < 3 * test::block_granularity);
+}
+
+TEST_CASE("DecompressAllParallel() matches DecompressAll()", "[decompression]") {
+    constexpr size_t n = 20000;
+    const CompressedCorpus c(GenerateCorpus(n), SomeNulls);
+
+    const uint16_t num_blocks = Load<uint16_t>(c.compression_result.data_start);
+    REQUIRE(num_blocks > 1);
+    REQUIRE(LoadDecompressedOffset(c.compression_result.data_start, 0) == 0);
+    REQUIRE(LoadDecompressedOffset(c.compression_result.data_start, num_blocks) == c.total_string_size);
+
+    REQUIRE(LoadNumRows(c.compression_result.data_start) == n);
+
+    std::vector<unsigned char> sequential(c.total_string_size + 32);
+    std::vector<const unsigned char *> sequential_ptrs(n);
+    std::vector<size_t> sequential_lengths(n);
+    const size_t sequential_bytes = DecompressAll(c.compression_result.data_start, c.prefix_decoder, c.suffix_decoder,
+                                                  sequential.data(), sequential.size(), sequential_ptrs, sequential_lengths);
+    REQUIRE(sequential_bytes == c.total_string_size);
+    // Rows come back in their original order, not in the order TruncatedSort() left them in, and NULLs as nullptr
+    REQUIRE_NOTHROW(VerifyDecompression(sequential_ptrs, sequential_lengths, c.input.lengths, c.input.string_ptrs));
+
+    for (const size_t num_threads : {1, 3, 8}) {
+        SECTION("Threads: " + std::to_string(num_threads)) {
+            // One pool for several scans, as the decompression benchmark uses it
+            ThreadPool pool(num_threads);
+            for (size_t scan = 0; scan < 3; scan++) {
+                std::vector<unsigned char> parallel(c.total_string_size + 32);
+                std::vector<const unsigned char *> parallel_ptrs(n);
+                std::vector<size_t> parallel_lengths(n);
+                const size_t parallel_bytes = DecompressAllParallel(c.compression_result.data_start, c.prefix_decoder, c.suffix_decoder,
+                                                                    parallel.data(), parallel.size(), parallel_ptrs, parallel_lengths, pool);
+                REQUIRE(parallel_bytes == c.total_string_size);
+                REQUIRE(parallel_lengths == sequential_lengths);
+                REQUIRE(std::equal(parallel.begin(), parallel.begin() + c.total_string_size, sequential.begin()));
+                REQUIRE_NOTHROW(VerifyDecompression(parallel_ptrs, parallel_lengths, c.input.lengths, c.input.string_ptrs));
+            }
+        }
+    }
+
+    SECTION("Too small output buffer") {
+        std::vector<unsigned char> parallel(c.total_string_size - 1);
+        std::vector<const unsigned char *> parallel_ptrs(n);
+        std::vector<size_t> parallel_lengths(n);
+        ThreadPool pool(4);
+        REQUIRE_THROWS_AS(DecompressAllParallel(c.compression_result.data_start, c.prefix_decoder, c.suffix_decoder,
+                                                parallel.data(), parallel.size(), parallel_ptrs, parallel_lengths, pool), std::logic_error);
+        REQUIRE_THROWS_AS(DecompressAll(c.compression_result.data_start, c.prefix_decoder, c.suffix_decoder,
+                                        parallel.data(), parallel.size(), parallel_ptrs, parallel_lengths), std::logic_error);
+    }
+}
+
+TEST_CASE("ThreadPool runs every job on all its threads", "[decompression]") {
+    ThreadPool pool(4);
+    REQUIRE(pool.NumThreads() == 4);
+    std::atomic<size_t> runs{0};
+    for (size_t job = 0; job < 100; job++) {
+        pool.Run([&]() { runs++; });
+    }
+    REQUIRE(runs == 400);
+    REQUIRE_THROWS_AS(pool.Run([&]() {
+        if (runs.fetch_add(1) % 4 == 1) {
+            throw std::logic_error("one thread fails");
+        }
+    }), std::logic_error);
+    pool.Run([&]() { runs++; });
+    REQUIRE(runs == 408);
+}
+
+TEST_CASE("DecompressRow() returns the string at its original row", "[decompression]") {
+    constexpr size_t n = 5000;
+    const CompressedCorpus c(GenerateCorpus(n), SomeNulls);
+
+    std::vector<unsigned char> out(512 + 32);
+    for (size_t row = 0; row < n; row += 7) {
+        size_t length;
+        const bool valid = DecompressRow(c.compression_result.data_start, c.prefix_decoder, c.suffix_decoder,
+                                         row, out.data(), out.data() + out.size(), length);
+        REQUIRE(valid == !SomeNulls(row));
+        REQUIRE(length == c.input.lengths[row]);
+        REQUIRE(TextMatches(out.data(), c.input.string_ptrs[row], length));
+    }
+    size_t length;
+    REQUIRE_THROWS_AS(DecompressRow(c.compression_result.data_start, c.prefix_decoder, c.suffix_decoder,
+                                    n, out.data(), out.data() + out.size(), length), std::out_of_range);
+}
+
+TEST_CASE("DecompressBlock() throws instead of writing past a too small buffer", "[decompression]") {
+    const CompressedCorpus c(GenerateCorpus(1000), NoNulls);
+    uint8_t *global_header = c.compression_result.data_start;
+    uint8_t *block_start_offsets = global_header + sizeof(uint16_t);
+    const size_t block_size = LoadDecompressedOffset(global_header, 1);
+    const unsigned char *run_ptrs[UINT8_MAX + 1];
+    size_t run_lengths[UINT8_MAX + 1];
+    // Sized exactly, so a write past its end is a heap overflow
+    std::vector<unsigned char> short_out(block_size / 2);
+    unsigned char *out = short_out.data();
+    REQUIRE_THROWS_AS(DecompressBlock(FindBlockStart(block_start_offsets, 0), c.prefix_decoder, c.suffix_decoder,
+                                      FindBlockStart(block_start_offsets, 1), out, short_out.data() + short_out.size(),
+                                      run_ptrs, run_lengths), std::logic_error);
+}
+
+TEST_CASE("NULL rows take no space in the blocks", "[decompression]") {
+    constexpr size_t n = 4 * test::block_granularity;
+    const CompressedCorpus without_nulls(GenerateCorpus(n), NoNulls);
+    const CompressedCorpus all_nulls(GenerateCorpus(n), [](size_t) { return true; });
+
+    REQUIRE(Load<uint16_t>(without_nulls.compression_result.data_start) > 0);
+    REQUIRE(Load<uint16_t>(all_nulls.compression_result.data_start) == 0);
+    // Just the global header: num_blocks, data_end_offset, decompressed_offsets[0], num_rows and one bit per row
+    const size_t all_nulls_size = all_nulls.compression_result.data_end - all_nulls.compression_result.data_start;
+    REQUIRE(all_nulls_size == sizeof(uint16_t) + 3 * sizeof(uint32_t) + n / 8);
+
+    std::vector<unsigned char> out(32);
+    std::vector<const unsigned char *> out_ptrs(n, out.data());
+    std::vector<size_t> out_lengths(n, 1);
+    REQUIRE(DecompressAll(all_nulls.compression_result.data_start, all_nulls.prefix_decoder, all_nulls.suffix_decoder,
+                          out.data(), out.size(), out_ptrs, out_lengths) == 0);
+    REQUIRE_NOTHROW(VerifyDecompression(out_ptrs, out_lengths, all_nulls.input.lengths, all_nulls.input.string_ptrs));
+}
+
+TEST_CASE("Identical strings in a block share one suffix entry", "[decompression]") {
+    constexpr size_t n = 4 * test::block_granularity;
+    std::vector<std::string> distinct = GenerateCorpus(n);
+    std::vector<std::string> repeated(n);
+    std::mt19937 rng(7);
+    for (size_t i = 0; i < n; i++) {
+        distinct[i] += "#" + std::to_string(i);
+        repeated[i] = "https://example.com/status/" + std::string(rng() % 2 ? "active" : "inactive");
+    }
+    const CompressedCorpus without_duplicates(distinct, NoNulls);
+    const CompressedCorpus with_duplicates(repeated, NoNulls);
+
+    // Two distinct strings per run: all but two strings of every block cost only their offset and row
+    const size_t with_duplicates_size = with_duplicates.compression_result.data_end - with_duplicates.compression_result.data_start;
+    REQUIRE(with_duplicates_size < n * (sizeof(uint16_t) + sizeof(uint8_t)) + 1024);
+
+    for (const CompressedCorpus *c : {&without_duplicates, &with_duplicates}) {
+        std::vector<unsigned char> out(c->total_string_size + 32);
+        std::vector<const unsigned char *> out_ptrs(n);
+        std::vector<size_t> out_lengths(n);
+        REQUIRE(DecompressAll(c->compression_result.data_start, c->prefix_decoder, c->suffix_decoder,
+                              out.data(), out.size(), out_ptrs, out_lengths) == c->total_string_size);
+        REQUIRE_NOTHROW(VerifyDecompression(out_ptrs, out_lengths, c->input.lengths, c->input.string_ptrs));
+
+        for (size_t row = 0; row < n; row += 5) {
+            size_t length;
+            REQUIRE(DecompressRow(c->compression_result.data_start, c->prefix_decoder, c->suffix_decoder,
+                                  row, out.data(), out.data() + out.size(), length));
+            REQUIRE(length == c->input.lengths[row]);
+            REQUIRE(TextMatches(out.data(), c->input.string_ptrs[row], length));
+        }
+    }
+
+    // A duplicate's copy is bounded by out_end like any decoded string, the block ends with the second status's repeats
+    uint8_t *global_header = with_duplicates.compression_result.data_start;
+    uint8_t *block_start_offsets = global_header + sizeof(uint16_t);
+    const size_t block_size = LoadDecompressedOffset(global_header, 1);
+    std::vector<unsigned char> out(block_size);
+    const unsigned char *run_ptrs[UINT8_MAX + 1];
+    size_t run_lengths[UINT8_MAX + 1];
+    unsigned char *block_out = out.data();
+    REQUIRE_THROWS_AS(DecompressBlock(FindBlockStart(block_start_offsets, 0), with_duplicates.prefix_decoder,
+                                      with_duplicates.suffix_decoder, FindBlockStart(block_start_offsets, 1), block_out,
+                                      out.data() + block_size - 1, run_ptrs, run_lengths),
+                      std::logic_error);
+    std::vector<unsigned char> short_out(with_duplicates.total_string_size - 1);
+    std::vector<const unsigned char *> out_ptrs(n);
+    std::vector<size_t> out_lengths(n);
+    REQUIRE_THROWS_AS(DecompressAll(global_header, with_duplicates.prefix_decoder, with_duplicates.suffix_decoder, short_out.data(),
+                                    short_out.size(), out_ptrs, out_lengths),
+                      std::logic_error);
+}
+
+// Strings nested one, two or three levels deep with many duplicates, so identical neighbours land in chunks of different prefix_length
+static std::vector<std::string> GenerateNestedDuplicates(const size_t n) {
+    std::mt19937 rng(0);
+    std::vector<std::string> corpus;
+    for (size_t i = 0; i < n; i++) {
+        std::string s = "https://host-" + std::to_string(rng() % 3) + ".example.org/";
+        if (rng() % 2) s += "section-" + std::to_string(rng() % 3) + "/chapter/";
+        if (rng() % 2) s += "page-" + std::to_string(rng() % 4);
+        corpus.push_back(s);
+    }
+    return corpus;
+}
+
+// Identical neighbours whose similarity chunks have different prefix lengths
+static size_t CountSplitDuplicates(std::vector<std::string> corpus) {
+    const size_t n = corpus.size();
+    StringCollection input(n);
+    for (const std::string &s : corpus) {
+        input.lengths.push_back(s.size());
+        input.string_ptrs.push_back(reinterpret_cast<const unsigned char *>(s.data()));
+    }
+    StageMeasurements stages;
+    CleavingRuns runs;
+    const std::vector<SimilarityChunk> similarity_chunks = FormBlockwiseSimilarityChunks(n, input, test::block_granularity, runs, stages);
+    size_t count = 0;
+    for (size_t k = 1; k < runs.first_strings.back(); k++) {
+        const size_t chunk = FindSimilarityChunkCorrespondingToIndex(k, similarity_chunks);
+        const size_t previous_chunk = FindSimilarityChunkCorrespondingToIndex(k - 1, similarity_chunks);
+        count += runs.equals_previous[k] && similarity_chunks[chunk].prefix_length != similarity_chunks[previous_chunk].prefix_length;
+    }
+    return count;
+}
+
+TEST_CASE("Identical strings in chunks of different prefix length are sized by their own chunk", "[decompression]") {
+    constexpr size_t n = 1000;
+    const std::vector<std::string> corpus = GenerateNestedDuplicates(n);
+    REQUIRE(CountSplitDuplicates(corpus) > 0);
+    const CompressedCorpus c(corpus, NoNulls);
+    uint8_t *global_header = c.compression_result.data_start;
+
+    // Zone map keys and Bloom filters are written from the same entries, so point lookups find every row of every value
+    std::vector<unsigned char> out(c.total_string_size + 32);
+    std::vector<uint32_t> matching_rows;
+    std::vector<const unsigned char *> out_ptrs;
+    std::vector<size_t> out_lengths;
+    for (const std::string &value : std::set<std::string>(corpus.begin(), corpus.end())) {
+        const auto *bytes = reinterpret_cast<const unsigned char *>(value.data());
+        std::vector<uint32_t> expected_rows;
+        for (size_t row = 0; row < n; row++) {
+            if (corpus[row] == value) {
+                expected_rows.push_back(row);
+            }
+        }
+        ZoneMapScan(global_header, c.compression_result.zone_map_start, c.prefix_decoder, c.suffix_decoder, ZoneMapEquals(bytes, value.size()),
+                    out.data(), out.data() + out.size(), matching_rows, out_ptrs, out_lengths);
+        REQUIRE(matching_rows == expected_rows);
+        BloomFilterLookup(global_header, c.compression_result.bloom_filter_start, c.prefix_decoder, c.suffix_decoder, bytes, value.size(),
+                          out.data(), out.data() + out.size(), matching_rows);
+        REQUIRE(matching_rows == expected_rows);
+    }
+
+    // Every block's decompressed_offsets[] entry is exactly what the block decodes to
+    const uint16_t num_blocks = Load<uint16_t>(global_header);
+    const unsigned char *run_ptrs[UINT8_MAX + 1];
+    size_t run_lengths[UINT8_MAX + 1];
+    uint8_t *block_start_offsets = global_header + sizeof(uint16_t);
+    unsigned char *block_out = out.data();
+    for (size_t i = 0; i < num_blocks; i++) {
+        REQUIRE(static_cast<size_t>(block_out - out.data()) == LoadDecompressedOffset(global_header, i));
+        DecompressBlock(FindBlockStart(block_start_offsets, i), c.prefix_decoder, c.suffix_decoder, FindBlockStart(block_start_offsets, i + 1),
+                        block_out, out.data() + out.size(), run_ptrs, run_lengths);
+    }
+    REQUIRE(LoadDecompressedOffset(global_header, num_blocks) == c.total_string_size);
+
+    for (const size_t num_threads : {1, 4}) {
+        ThreadPool pool(num_threads);
+        std::vector<unsigned char> parallel(c.total_string_size + 32);
+        std::vector<const unsigned char *> parallel_ptrs(n);
+        std::vector<size_t> parallel_lengths(n);
+        REQUIRE(DecompressAllParallel(global_header, c.prefix_decoder, c.suffix_decoder, parallel.data(), parallel.size(),
+                                      parallel_ptrs, parallel_lengths, pool) == c.total_string_size);
+        REQUIRE_NOTHROW(VerifyDecompression(parallel_ptrs, parallel_lengths, c.input.lengths, c.input.string_ptrs));
+    }
+}
+
+TEST_CASE("Nested prefixes decode across blocks that split a cleaving run", "[decompression]") {
+    // Per run: a few strings sharing the catalog path, then long strings extending it, too many bytes for one block
+    constexpr size_t n = 2 * test::block_granularity;
+    std::mt19937 rng(3);
+    std::vector<std::string> corpus;
+    for (size_t run = 0; run < n / test::block_granularity; run++) {
+        for (const std::string category : {"audio", "books", "cameras", "games"}) {
+            corpus.push_back("https://shop.example.com/catalog/" + category);
+        }
+        while (corpus.size() % test::block_granularity != 0) {
+            std::string tail(600, ' ');
+            for (char &c : tail) {
+                c = static_cast<char>('a' + rng() % 26);
+            }
+            corpus.push_back("https://shop.example.com/catalog/phones/smart/model-" + std::to_string(corpus.size()) + "/" + tail);
+        }
+    }
+    const CompressedCorpus c(corpus, NoNulls);
+
+    REQUIRE(Load<uint16_t>(c.compression_result.data_start) > n / test::block_granularity);
+    std::vector<unsigned char> out(c.total_string_size + 32);
+    std::vector<const unsigned char *> out_ptrs(n);
+    std::vector<size_t> out_lengths(n);
+    REQUIRE(DecompressAll(c.compression_result.data_start, c.prefix_decoder, c.suffix_decoder,
+                          out.data(), out.size(), out_ptrs, out_lengths) == c.total_string_size);
+    REQUIRE_NOTHROW(VerifyDecompression(out_ptrs, out_lengths, c.input.lengths, c.input.string_ptrs));
+}
+
+TEST_CASE("FSSTPlusScanVector() fills DuckDB vectors in row order", "[decompression]") {
+    // Short strings end up inlined in the string_t, the long ones point into the vector's heap
+    constexpr size_t n = 2 * STANDARD_VECTOR_SIZE + 300;
+    std::vector<std::string> corpus = GenerateCorpus(n);
+    for (size_t i = 0; i < n; i += 3) {
+        corpus[i] = "id/" + std::to_string(i % 97);
+    }
+    // 96 does not divide STANDARD_VECTOR_SIZE, so some cleaving runs straddle two vectors
+    for (const size_t block_granularity : {test::block_granularity, static_cast<size_t>(96)}) {
+        const CompressedCorpus c(corpus, SomeNulls, block_granularity);
+        FSSTPlusVectorScanState state(c.compression_result.data_start, c.prefix_decoder, c.suffix_decoder);
+        size_t row = 0;
+        while (true) {
+            duckdb::Vector result(duckdb::LogicalType::VARCHAR);
+            const size_t count = FSSTPlusScanVector(state, result);
+            if (count == 0) {
+                break;
+            }
+            REQUIRE(count == std::min<size_t>(STANDARD_VECTOR_SIZE, n - row));
+            const duckdb::string_t *result_data = duckdb::FlatVector::GetData<duckdb::string_t>(result);
+            for (size_t k = 0; k < count; k++, row++) {
+                if (SomeNulls(row)) {
+                    REQUIRE_FALSE(duckdb::FlatVector::Validity(result).RowIsValid(k));
+                    continue;
+                }
+                REQUIRE(duckdb::FlatVector::Validity(result).RowIsValid(k));
+                REQUIRE(result_data[k].GetString() == corpus[row]);
+            }
+        }
+        REQUIRE(row == n);
+    }
+}
+
+TEST_CASE("DecompressSelection() decodes only the selected rows", "[decompression]") {
+    constexpr size_t n = 5000;
+    const CompressedCorpus c(GenerateCorpus(n), SomeNulls);
+    std::mt19937 rng(3);
+    for (const size_t stride : {1, 3, 50, 700}) {
+        std::vector<uint32_t> sorted_rows;
+        for (size_t row = rng() % stride; row < n; row += 1 + rng() % stride) {
+            sorted_rows.push_back(row);
+            if (rng() % 10 == 0) {
+                sorted_rows.push_back(row); // repeats are allowed
+            }
+        }
+        const size_t count = sorted_rows.size();
+        std::vector<unsigned char> out(c.total_string_size * 2 + 32);
+        std::vector<const unsigned char *> out_ptrs(count);
+        std::vector<size_t> out_lengths(count);
+        const size_t decoded_bytes = DecompressSelection(c.compression_result.data_start, c.prefix_decoder, c.suffix_decoder,
+                                                         sorted_rows.data(), count, out.data(), out.data() + out.size(),
+                                                         out_ptrs, out_lengths);
+        size_t selected_bytes = 0;
+        for (size_t k = 0; k < count; k++) {
+            const size_t row = sorted_rows[k];
+            REQUIRE((out_ptrs[k] == nullptr) == SomeNulls(row));
+            REQUIRE(out_lengths[k] == c.input.lengths[row]);
+            REQUIRE(TextMatches(out_ptrs[k], c.input.string_ptrs[row], out_lengths[k]));
+            if (k == 0 || row != sorted_rows[k - 1]) {
+                selected_bytes += out_lengths[k];
+            }
+        }
+        REQUIRE(decoded_bytes == selected_bytes);
+    }
+
+    // A filter's selection vector over the second vector of rows
+    duckdb::SelectionVector sel(STANDARD_VECTOR_SIZE);
+    size_t count = 0;
+    for (size_t i = 0; i < STANDARD_VECTOR_SIZE; i += 13) {
+        sel.set_index(count++, i);
+    }
+    std::vector<unsigned char> out(c.total_string_size + 32);
+    std::vector<const unsigned char *> out_ptrs(count);
+    std::vector<size_t> out_lengths(count);
+    DecompressSelection(c.compression_result.data_start, c.prefix_decoder, c.suffix_decoder, sel, count, STANDARD_VECTOR_SIZE,
+                        out.data(), out.data() + out.size(), out_ptrs, out_lengths);
+    for (size_t k = 0; k < count; k++) {
+        const size_t row = STANDARD_VECTOR_SIZE + sel.get_index(k);
+        REQUIRE(out_lengths[k] == c.input.lengths[row]);
+        REQUIRE(TextMatches(out_ptrs[k], c.input.string_ptrs[row], out_lengths[k]));
+    }
+
+    std::vector<uint32_t> all_rows(n);
+    std::iota(all_rows.begin(), all_rows.end(), 0);
+    std::vector<unsigned char> short_out(c.total_string_size / 2);
+    std::vector<const unsigned char *> all_ptrs(n);
+    std::vector<size_t> all_lengths(n);
+    REQUIRE_THROWS_AS(DecompressSelection(c.compression_result.data_start, c.prefix_decoder, c.suffix_decoder, all_rows.data(), n,
+                                          short_out.data(), short_out.data() + short_out.size(), all_ptrs, all_lengths),
+                      std::logic_error);
+
+    const uint32_t unsorted_rows[] = {10, 4};
+    std::vector<const unsigned char *> two_ptrs(2);
+    std::vector<size_t> two_lengths(2);
+    REQUIRE_THROWS_AS(DecompressSelection(c.compression_result.data_start, c.prefix_decoder, c.suffix_decoder, unsorted_rows, 2,
+                                          out.data(), out.data() + out.size(), two_ptrs, two_lengths), std::logic_error);
+}
+
+TEST_CASE("HashAll() matches hashing the decoded strings", "[decompression]") {
+    constexpr size_t n = 4000;
+    std::vector<std::string> corpus = GenerateCorpus(n);
+    for (size_t i = 0; i < n; i += 11) {
+        corpus[i] = corpus[i / 2]; // duplicates within and across runs
+    }
+    const CompressedCorpus with_nulls(corpus, SomeNulls);
+    const CompressedCorpus without_nulls(GenerateCorpus(n), NoNulls);
+    for (const CompressedCorpus *c : {&with_nulls, &without_nulls}) {
+        std::vector<uint64_t> hashes(n);
+        HashAll(c->compression_result.data_start, c->prefix_decoder, c->suffix_decoder, hashes);
+        for (size_t row = 0; row < n; row++) {
+            if (c->input.string_ptrs[row] == nullptr) {
+                REQUIRE(hashes[row] == null_row_hash);
+            } else {
+                REQUIRE(hashes[row] == HashString(c->input.string_ptrs[row], c->input.lengths[row]));
+            }
+        }
+    }
+}
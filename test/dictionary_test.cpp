@@ -0,0 +1,102 @@
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+#include "../src/fsst_plus.h"
+#include "bitpacking.h"
+#include "dictionary_fsst_plus.h"
+#include "test_helpers.h"
+
+TEST_CASE("BitPack() and BitUnpack() round trip", "[dictionary]") {
+    REQUIRE(CalcBitWidth(1) == 0);
+    REQUIRE(CalcBitWidth(2) == 1);
+    REQUIRE(CalcBitWidth(5) == 3);
+    REQUIRE(CalcBitWidth(256) == 8);
+    REQUIRE(CalcBitWidth(257) == 9);
+
+    for (const uint8_t width : {0, 1, 3, 7, 13, 17, 32}) {
+        std::mt19937 rng(width);
+        std::vector<uint32_t> values(1000);
+        const uint64_t limit = static_cast<uint64_t>(1) << width;
+        for (uint32_t &value : values) {
+            value = static_cast<uint32_t>(rng() % limit);
+        }
+        std::vector<uint8_t> packed(CalcBitPackedSize(values.size(), width) + bitpacking_padding);
+        BitPack(values, width, packed.data());
+        for (size_t i = 0; i < values.size(); i++) {
+            REQUIRE(BitUnpack(packed.data(), i, width) == values[i]);
+        }
+    }
+}
+
+// Dictionary FSST+ as the codec of BasicCompressedCorpus
+struct DictionaryCodec {
+    using Result = DictionaryFSSTPlusCompressionResult;
+
+    static Result Compress(StringCollection &input, const size_t block_granularity) {
+        StageMeasurements stages;
+        MemoryFootprint memory;
+        return DictionaryFSSTPlusCompress(input.lengths.size(), input, block_granularity, stages, memory);
+    }
+
+    static FSSTPlusCompressionResult Corpus(const Result &result) {
+        return result.dictionary;
+    }
+
+    static void Destroy(Result &result) {
+        FSSTPlusCodec::Destroy(result.dictionary);
+    }
+};
+
+struct DictionaryCorpus : BasicCompressedCorpus<DictionaryCodec> {
+    DictionaryCorpus(std::vector<std::string> strings, const std::vector<bool> &nulls)
+        : BasicCompressedCorpus(std::move(strings), [&nulls](const size_t row) { return nulls[row]; }) {}
+
+    void RequireRoundTrip() const {
+        uint8_t *global_header = compression_result.dictionary.data_start;
+        const size_t dictionary_size = LoadDecompressedOffset(global_header, Load<uint16_t>(global_header));
+        std::vector<unsigned char> out(dictionary_size + 32);
+        std::vector<const unsigned char *> out_ptrs(corpus.size());
+        std::vector<size_t> out_lengths(corpus.size());
+        REQUIRE(DictionaryFSSTPlusDecompressAll(global_header, compression_result.codes_start, prefix_decoder, suffix_decoder,
+                                                out.data(), out.size(), out_ptrs, out_lengths) == dictionary_size);
+        REQUIRE_NOTHROW(VerifyDecompression(out_ptrs, out_lengths, input.lengths, input.string_ptrs));
+    }
+};
+
+TEST_CASE("Dictionary FSST+ stores every distinct string once", "[dictionary]") {
+    constexpr size_t n = 10000;
+    const std::vector<std::string> categories = {
+        "https://example.com/products/shoes", "https://example.com/products/shirts", "https://example.com/category/sale",
+        "", "https://example.com/products/shoes/running", "https://example.com/category/new"
+    };
+    std::mt19937 rng(42);
+    std::vector<std::string> corpus(n);
+    std::vector<bool> nulls(n);
+    for (size_t i = 0; i < n; i++) {
+        corpus[i] = categories[rng() % categories.size()];
+        nulls[i] = i % 11 == 0;
+    }
+    const DictionaryCorpus c(corpus, nulls);
+
+    // The NULL entry plus the six categories, packed in 3 bits
+    REQUIRE(LoadDictionaryNumRows(c.compression_result.codes_start) == n);
+    REQUIRE(LoadDictionaryNumEntries(c.compression_result.codes_start) == categories.size() + 1);
+    REQUIRE(LoadDictionaryCodeWidth(c.compression_result.codes_start) == 3);
+    REQUIRE(c.compression_result.codes_end - c.compression_result.codes_start == dictionary_codes_header_size + CalcBitPackedSize(n, 3));
+    c.RequireRoundTrip();
+}
+
+TEST_CASE("Dictionary FSST+ round trips columns without repeats or with only NULLs", "[dictionary]") {
+    constexpr size_t n = 1000;
+    std::vector<std::string> distinct(n);
+    for (size_t i = 0; i < n; i++) {
+        distinct[i] = "row/" + std::to_string(i * 7919 % n);
+    }
+    const DictionaryCorpus all_distinct(distinct, std::vector<bool>(n, false));
+    REQUIRE(LoadDictionaryNumEntries(all_distinct.compression_result.codes_start) == n);
+    all_distinct.RequireRoundTrip();
+
+    const DictionaryCorpus all_nulls(distinct, std::vector<bool>(n, true));
+    REQUIRE(LoadDictionaryNumEntries(all_nulls.compression_result.codes_start) == 1);
+    REQUIRE(LoadDictionaryCodeWidth(all_nulls.compression_result.codes_start) == 0);
+    all_nulls.RequireRoundTrip();
+}
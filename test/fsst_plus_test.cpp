@@ -39,13 +39,22 @@ TEST_CASE("SizeEverything() Many blocks test", "[block_sizer]") {
             }
         }
 
+        // No NULLs: every cleaving run holds small_block_granularity strings
+        CleavingRuns runs;
+        for (size_t i = 0; i < num_strings; i += test::small_block_granularity) {
+            runs.first_strings.push_back(i);
+        }
+        runs.first_strings.push_back(num_strings);
+        runs.equals_previous.assign(num_strings, false);
+
         // Call SizeEverything
         FSSTPlusSizingResult sizing_result = SizeEverything(
             num_strings,
             similarity_chunks,
             prefix_compression_result,
             suffix_compression_result,
-            test::small_block_granularity // Use small granularity
+            test::small_block_granularity, // Use small granularity
+            runs
         );
 
         // Assert a large number of blocks were created
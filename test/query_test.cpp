@@ -0,0 +1,77 @@
+#include <catch2/catch_test_macros.hpp>
+#include <functional>
+#include <random>
+#include <set>
+#include "../src/fsst_plus.h"
+#include "fsst_plus_query.h"
+#include "test_helpers.h"
+
+TEST_CASE("FSST+ queries answer like a scan of the original strings", "[query]") {
+    constexpr size_t n = 25 * test::block_granularity + 9;
+    std::mt19937 rng(33);
+    std::vector<std::string> corpus(n);
+    for (size_t i = 0; i < n; i++) {
+        corpus[i] = "user" + std::to_string(rng() % 300) + "@mail-" + std::to_string(rng() % 7) + ".example.com";
+    }
+    corpus[5] = "";
+    corpus[6] = "\xFF\xFF";
+    const SegmentCorpus c(corpus, [](const size_t row) { return row % 13 == 2; });
+    const FSSTPlusSegment &segment = *c.compression_result;
+
+    size_t expected_sum = 0;
+    std::set<std::string> distinct;
+    for (size_t i = 0; i < n; i++) {
+        if (c.input.string_ptrs[i] != nullptr) {
+            expected_sum += corpus[i].size();
+            distinct.insert(corpus[i]);
+        }
+    }
+    const auto expected_count = [&](const std::function<bool(const std::string &)> &matches) {
+        size_t count = 0;
+        for (size_t i = 0; i < n; i++) {
+            count += c.input.string_ptrs[i] != nullptr && matches(corpus[i]);
+        }
+        return count;
+    };
+
+    FSSTPlusQueryScratch scratch(segment);
+
+    REQUIRE(FSSTPlusSumLengths(segment, scratch) == expected_sum);
+    REQUIRE(FSSTPlusCountGroups(segment, scratch) == distinct.size() + 1);
+
+    for (const std::string prefix : {"user1", "user29", "u", "user299@mail-6", "zzz", "\xFF", "\xFF\xFF"}) {
+        const auto p = reinterpret_cast<const unsigned char *>(prefix.data());
+        REQUIRE(FSSTPlusCountPrefix(segment, p, prefix.size(), scratch) ==
+                expected_count([&](const std::string &str) { return str.compare(0, prefix.size(), prefix) == 0; }));
+    }
+    for (const std::string infix : {"l-3", "@", "com", "9@m", "xyz", ""}) {
+        const auto p = reinterpret_cast<const unsigned char *>(infix.data());
+        REQUIRE(FSSTPlusCountInfix(segment, p, infix.size(), scratch) ==
+                expected_count([&](const std::string &str) { return str.find(infix) != std::string::npos; }));
+    }
+    for (const size_t row : {0, 1, 5, 6, 100, 3000}) {
+        const std::string &value = corpus[row];
+        const auto p = reinterpret_cast<const unsigned char *>(value.data());
+        REQUIRE(FSSTPlusCountEquals(segment, p, value.size(), scratch) ==
+                expected_count([&](const std::string &str) { return str == value; }));
+    }
+}
+
+TEST_CASE("GROUP BY counts columns of distinct and of repeated strings", "[query]") {
+    constexpr size_t n = 10 * test::block_granularity + 3;
+    std::vector<std::string> distinct(n);
+    for (size_t i = 0; i < n; i++) {
+        distinct[i] = "https://example.com/item/" + std::to_string(i);
+    }
+    const SegmentCorpus no_duplicates(distinct, [](size_t) { return false; });
+    FSSTPlusQueryScratch scratch(*no_duplicates.compression_result);
+    REQUIRE(FSSTPlusCountGroups(*no_duplicates.compression_result, scratch) == n);
+
+    std::vector<std::string> repeated(n);
+    for (size_t i = 0; i < n; i++) {
+        repeated[i] = distinct[i % 50];
+    }
+    const SegmentCorpus with_duplicates(repeated, [](const size_t row) { return row % 50 == 7; });
+    FSSTPlusQueryScratch repeated_scratch(*with_duplicates.compression_result);
+    REQUIRE(FSSTPlusCountGroups(*with_duplicates.compression_result, repeated_scratch) == 49 + 1);
+}
@@ -0,0 +1,54 @@
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+#include "../src/fsst_plus.h"
+#include "row_group_sorted_fsst_plus.h"
+#include "test_helpers.h"
+
+TEST_CASE("Row group sorted FSST+ round trips and shares prefixes across runs", "[row_group_sort]") {
+    // Long prefixes that recur all over the row group, a few per run once the row group is sorted
+    constexpr size_t n = 40 * test::block_granularity;
+    std::mt19937 rng(11);
+    std::vector<std::string> corpus(n);
+    for (size_t i = 0; i < n; i++) {
+        corpus[i] = "https://example.com/a/very/long/shared/path/number/" + std::to_string(rng() % 40) + "/to/item?id=" +
+                    std::to_string(rng() % 100000);
+    }
+    StringCollection input(n);
+    size_t total_string_size = 0;
+    for (size_t i = 0; i < n; i++) {
+        const bool is_null = i % 9 == 4;
+        input.lengths.push_back(is_null ? 0 : corpus[i].size());
+        input.string_ptrs.push_back(is_null ? nullptr : reinterpret_cast<const unsigned char *>(corpus[i].data()));
+        total_string_size += input.lengths.back();
+    }
+    const std::vector<size_t> original_lengths = input.lengths;
+    const std::vector<const unsigned char *> original_string_ptrs = input.string_ptrs;
+
+    StageMeasurements stages;
+    MemoryFootprint memory;
+    const RowGroupSortedCompressionResult sorted_result = RowGroupSortedFSSTPlusCompress(n, input, test::block_granularity, stages, memory);
+    const size_t n_strings = n - (n + 4) / 9;
+    REQUIRE(LoadPermutationNumRows(sorted_result.permutation_start) == n);
+    REQUIRE(LoadPermutationNumStrings(sorted_result.permutation_start) == n_strings);
+    REQUIRE(static_cast<size_t>(sorted_result.permutation_end - sorted_result.permutation_start) ==
+            permutation_header_size + n_strings * sizeof(uint32_t));
+
+    // Same corpus with per-run sorting only
+    const FSSTPlusCompressionResult blockwise_result = CompressFSSTPlus(input, test::block_granularity, stages, memory);
+    REQUIRE(sorted_result.sorted.data_end - sorted_result.sorted.data_start < blockwise_result.data_end - blockwise_result.data_start);
+
+    const fsst_decoder_t prefix_decoder = fsst_decoder(sorted_result.sorted.prefix_encoder);
+    const fsst_decoder_t suffix_decoder = fsst_decoder(sorted_result.sorted.suffix_encoder);
+    std::vector<unsigned char> out(total_string_size + 32);
+    std::vector<const unsigned char *> out_ptrs(n);
+    std::vector<size_t> out_lengths(n);
+    REQUIRE(RowGroupSortedFSSTPlusDecompressAll(sorted_result.sorted.data_start, sorted_result.permutation_start,
+                                                prefix_decoder, suffix_decoder, out.data(), out.size(),
+                                                out_ptrs, out_lengths) == total_string_size);
+    REQUIRE_NOTHROW(VerifyDecompression(out_ptrs, out_lengths, original_lengths, original_string_ptrs));
+
+    fsst_destroy(sorted_result.sorted.prefix_encoder);
+    fsst_destroy(sorted_result.sorted.suffix_encoder);
+    fsst_destroy(blockwise_result.prefix_encoder);
+    fsst_destroy(blockwise_result.suffix_encoder);
+}
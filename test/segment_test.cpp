@@ -0,0 +1,64 @@
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+#include <thread>
+#include "../src/fsst_plus.h"
+#include "fsst_plus_segment.h"
+#include "test_helpers.h"
+
+TEST_CASE("Threads read one FSST+ segment concurrently", "[segment]") {
+    constexpr size_t n = 40 * test::block_granularity + 17;
+    std::mt19937 rng(12);
+    std::vector<std::string> corpus(n);
+    for (size_t i = 0; i < n; i++) {
+        corpus[i] = "/var/log/service-" + std::to_string(rng() % 30) + "/2025-03-" + std::to_string(rng() % 28) + ".log";
+    }
+    const SegmentCorpus c(corpus, [](const size_t row) { return row % 11 == 4; });
+    const FSSTPlusSegment &segment = *c.compression_result;
+
+    // The segment owns its bytes, overwriting the arena it was written to changes nothing
+    ThreadArena().Reset();
+    uint8_t *scratch = ThreadArena().Allocate(segment.BufferSize());
+    memset(scratch, 0xAB, segment.BufferSize());
+    REQUIRE(segment.NumRows() == n);
+
+    constexpr size_t n_threads = 4;
+    std::vector<int> failures(n_threads, 0);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < n_threads; t++) {
+        threads.emplace_back([&, t]() {
+            std::vector<unsigned char> out(segment.DecompressAllCapacity());
+            std::vector<const unsigned char *> out_ptrs(n);
+            std::vector<size_t> out_lengths(n);
+            segment.DecompressAll(out.data(), out.size(), out_ptrs, out_lengths);
+            for (size_t row = 0; row < n; row++) {
+                const bool same = c.input.string_ptrs[row] == nullptr
+                                      ? out_ptrs[row] == nullptr
+                                      : out_lengths[row] == c.input.lengths[row] &&
+                                        memcmp(out_ptrs[row], c.input.string_ptrs[row], c.input.lengths[row]) == 0;
+                failures[t] += !same;
+            }
+
+            std::mt19937 row_rng(t);
+            std::vector<unsigned char> row_out(segment.BlockCapacity());
+            for (size_t lookup = 0; lookup < 2000; lookup++) {
+                const size_t row = row_rng() % n;
+                size_t decompressed_size = 0;
+                const bool valid = segment.DecompressRow(row, row_out.data(), row_out.data() + row_out.size(), decompressed_size);
+                const bool same = valid ? decompressed_size == c.input.lengths[row] &&
+                                              memcmp(row_out.data(), c.input.string_ptrs[row], decompressed_size) == 0
+                                        : c.input.string_ptrs[row] == nullptr;
+                failures[t] += !same;
+            }
+
+            std::vector<uint32_t> matching_rows;
+            segment.Lookup(c.input.string_ptrs[t], c.input.lengths[t], row_out.data(), row_out.data() + row_out.size(), matching_rows);
+            failures[t] += std::find(matching_rows.begin(), matching_rows.end(), t) == matching_rows.end();
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    for (size_t t = 0; t < n_threads; t++) {
+        REQUIRE(failures[t] == 0);
+    }
+}
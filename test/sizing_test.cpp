@@ -7,7 +7,7 @@ namespace test {
 
 TEST_CASE("CanFitInBlock()", "[block_sizer]") {
     constexpr size_t capacity = config::block_byte_capacity;
-    constexpr size_t block_header_suffix_offset = sizeof(uint16_t); // Space needed for one suffix offset
+    constexpr size_t block_header_suffix_offset = sizeof(uint16_t) + sizeof(uint8_t); // Space needed for one suffix offset and its row
 
     SECTION("Block is empty") {
         BlockSizingMetadata bsm; // block_size defaults to 0
@@ -135,10 +135,13 @@ TEST_CASE("Basic tests CalculateBlockSizeAndPopulateWritingMetadata()", "[block_
             suffix_compression_result,
             wm,
             0,
-            test::block_granularity
+            test::block_granularity,
+            suffix_compression_result.encoded_string_ptrs.size(), // one cleaving run covering every string
+            std::vector<bool>(suffix_compression_result.encoded_string_ptrs.size(), false) // no duplicates
         );
         size_t expected_size = sizeof(uint8_t) + // num_strings
                                sizeof(uint16_t) * 5 + // suffix data area offsets
+                               sizeof(uint8_t) * 5 + // rows
                                5*10 + // encoded prefixes
                                5* (sizeof(uint8_t) + sizeof(uint16_t) + 10); // suffix data areas
 
@@ -197,7 +200,9 @@ TEST_CASE("Large scale CalculateBlockSizeAndPopulateWritingMetadata()", "[block_
             suffix_compression_result,
             wm,
             0,
-            test::block_granularity
+            test::block_granularity,
+            suffix_compression_result.encoded_string_ptrs.size(), // one cleaving run covering every string
+            std::vector<bool>(suffix_compression_result.encoded_string_ptrs.size(), false) // no duplicates
         );
 
         REQUIRE(block_size < config::block_byte_capacity);
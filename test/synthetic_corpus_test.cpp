@@ -0,0 +1,121 @@
+#include <catch2/catch_test_macros.hpp>
+#include <set>
+#include <string>
+#include <vector>
+#include "synthetic_corpus.h"
+
+// n values, NULLs as "<null>"
+static std::vector<std::string> Generate(const SyntheticCorpusOptions &options, const size_t n) {
+    SyntheticCorpusGenerator generator(options);
+    std::vector<std::string> values(n);
+    for (size_t i = 0; i < n; i++) {
+        if (!generator.Next(values[i])) {
+            values[i] = "<null>";
+        }
+    }
+    return values;
+}
+
+static size_t CommonPrefix(const std::string &a, const std::string &b) {
+    size_t length = 0;
+    while (length < a.size() && length < b.size() && a[length] == b[length]) {
+        length++;
+    }
+    return length;
+}
+
+TEST_CASE("Synthetic corpora only depend on their options", "[synthetic]") {
+    for (const SyntheticColumn column : synthetic_columns) {
+        SyntheticCorpusOptions options;
+        options.column = column;
+        options.null_rate = 0.05;
+        const std::vector<std::string> values = Generate(options, 2000);
+        REQUIRE(values == Generate(options, 2000));
+        options.seed++;
+        REQUIRE(values != Generate(options, 2000));
+    }
+}
+
+TEST_CASE("Synthetic corpora follow their shape options", "[synthetic]") {
+    constexpr size_t n = 20000;
+    SyntheticCorpusOptions options;
+    options.duplicate_rate = 0;
+    options.null_rate = 0.1;
+    options.min_tail_length = 6;
+    options.max_tail_length = 6;
+
+    SECTION("NULL and duplicate rates") {
+        const std::vector<std::string> values = Generate(options, n);
+        size_t nulls = 0;
+        for (const std::string &value : values) {
+            nulls += value == "<null>";
+        }
+        REQUIRE(nulls > n / 20);
+        REQUIRE(nulls < n / 5);
+        REQUIRE(std::set<std::string>(values.begin(), values.end()).size() > n * 8 / 10);
+
+        options.null_rate = 0;
+        options.duplicate_rate = 0.5;
+        const std::vector<std::string> duplicated = Generate(options, n);
+        const size_t distinct = std::set<std::string>(duplicated.begin(), duplicated.end()).size();
+        REQUIRE(distinct > n * 4 / 10);
+        REQUIRE(distinct < n * 6 / 10);
+    }
+
+    SECTION("Prefix sharing") {
+        options.null_rate = 0;
+        options.duplicate_rate = 0;
+        options.prefix_sharing = 1;
+        const std::vector<std::string> shared = Generate(options, n);
+        for (size_t window = 0; window < n; window += config::synthetic_stem_window) {
+            const size_t stem_length = shared[window].size() - options.max_tail_length;
+            for (size_t i = window; i < std::min(n, window + config::synthetic_stem_window); i++) {
+                REQUIRE(CommonPrefix(shared[i], shared[window]) >= stem_length);
+            }
+        }
+        options.prefix_sharing = 0;
+        REQUIRE(SyntheticCorpusGenerator(options).StemsPerWindow() == config::synthetic_stem_window);
+        options.prefix_sharing = 0.5;
+        REQUIRE(SyntheticCorpusGenerator(options).StemsPerWindow() == 32);
+
+        // Runs far into a long corpus share prefixes like the first ones
+        const auto distinct_stems = [&](const std::vector<std::string> &values, const size_t first) {
+            std::set<std::string> stems;
+            for (size_t i = first; i < first + 128; i++) {
+                stems.insert(values[i].substr(0, values[i].size() - options.max_tail_length));
+            }
+            return stems.size();
+        };
+        const std::vector<std::string> values = Generate(options, 10 * n);
+        const size_t first_run = distinct_stems(values, 0);
+        const size_t late_run = distinct_stems(values, 10 * n - 128);
+        REQUIRE(first_run < 64);
+        REQUIRE(late_run < 64);
+    }
+
+    SECTION("UUIDs and categories") {
+        options.null_rate = 0;
+        options.column = SyntheticColumn::UUID;
+        for (const std::string &value : Generate(options, 1000)) {
+            REQUIRE(value.size() == 36);
+            REQUIRE(value[8] == '-');
+            REQUIRE(value[14] == '7');
+            REQUIRE(std::string("89ab").find(value[19]) != std::string::npos);
+        }
+        options.column = SyntheticColumn::CATEGORICAL;
+        options.cardinality = 12;
+        const std::vector<std::string> categories = Generate(options, n);
+        REQUIRE(std::set<std::string>(categories.begin(), categories.end()).size() <= 12);
+    }
+
+    SECTION("Log lines rise in time") {
+        options.null_rate = 0;
+        options.duplicate_rate = 0;
+        options.column = SyntheticColumn::LOG;
+        const std::vector<std::string> lines = Generate(options, 1000);
+        REQUIRE(lines[0].compare(0, 10, "2025-01-01") == 0);
+        for (size_t i = 1; i < lines.size(); i++) {
+            REQUIRE(lines[i - 1].substr(0, 23) <= lines[i].substr(0, 23));
+        }
+    }
+}
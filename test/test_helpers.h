@@ -0,0 +1,103 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../src/config.h"
+#include "../src/fsst_plus.h"
+#include "fsst_plus_segment.h"
+
+// The switches config.h leaves to each binary, and the block granularity the tests compress with
+namespace config {
+    constexpr size_t total_strings = 100000;
+    constexpr bool print_sorted_corpus = false;
+    constexpr bool print_split_points = false;
+    constexpr bool print_decompressed_corpus = false;
+}
+
+namespace test {
+    constexpr size_t block_granularity = 128;
+}
+
+// CompressFSSTPlus() for tests that measure neither stages nor memory. Sorts input in place
+inline FSSTPlusCompressionResult CompressTestCorpus(StringCollection &input, const size_t block_granularity = test::block_granularity) {
+    StageMeasurements stages;
+    MemoryFootprint memory;
+    return CompressFSSTPlus(input, block_granularity, stages, memory);
+}
+
+// Points at the rows of strings, rows for which is_null() holds become NULL. strings must outlive the collection
+inline StringCollection ToStringCollection(const std::vector<std::string> &strings, const std::function<bool(size_t)> &is_null) {
+    StringCollection input(strings.size(), false);
+    for (size_t i = 0; i < strings.size(); i++) {
+        input.lengths.push_back(is_null(i) ? 0 : strings[i].size());
+        input.string_ptrs.push_back(is_null(i) ? nullptr : reinterpret_cast<const unsigned char *>(strings[i].data()));
+    }
+    return input;
+}
+
+// The plain FSST+ codec of BasicCompressedCorpus. A codec names its Result, the FSST+ corpus inside it and how to free it
+struct FSSTPlusCodec {
+    using Result = FSSTPlusCompressionResult;
+
+    static Result Compress(StringCollection &input, const size_t block_granularity) {
+        return CompressTestCorpus(input, block_granularity);
+    }
+
+    static FSSTPlusCompressionResult Corpus(const Result &result) {
+        return result;
+    }
+
+    static void Destroy(Result &result) {
+        fsst_destroy(result.prefix_encoder);
+        fsst_destroy(result.suffix_encoder);
+    }
+};
+
+// Compresses into an FSSTPlusSegment, which owns the encoders from then on
+struct FSSTPlusSegmentCodec {
+    using Result = std::unique_ptr<FSSTPlusSegment>;
+
+    static Result Compress(StringCollection &input, const size_t block_granularity) {
+        return std::make_unique<FSSTPlusSegment>(CompressTestCorpus(input, block_granularity));
+    }
+
+    static FSSTPlusCompressionResult Corpus(const Result &result) {
+        return result->View();
+    }
+
+    static void Destroy(Result &) {}
+};
+
+// Compresses strings with Codec, rows for which is_null() holds become NULL. input keeps the rows in their original order
+template <class Codec>
+struct BasicCompressedCorpus {
+    std::vector<std::string> corpus;
+    StringCollection input{0};
+    size_t total_string_size = 0;
+    typename Codec::Result compression_result{};
+    fsst_decoder_t prefix_decoder{};
+    fsst_decoder_t suffix_decoder{};
+
+    BasicCompressedCorpus(std::vector<std::string> strings, const std::function<bool(size_t)> &is_null,
+                          const size_t block_granularity = test::block_granularity)
+        : corpus(std::move(strings)), input(ToStringCollection(corpus, is_null)) {
+        for (const size_t length : input.lengths) {
+            total_string_size += length;
+        }
+        StringCollection sorted = input;
+        compression_result = Codec::Compress(sorted, block_granularity);
+        prefix_decoder = fsst_decoder(Codec::Corpus(compression_result).prefix_encoder);
+        suffix_decoder = fsst_decoder(Codec::Corpus(compression_result).suffix_encoder);
+    }
+
+    BasicCompressedCorpus(const BasicCompressedCorpus &) = delete;
+    BasicCompressedCorpus &operator=(const BasicCompressedCorpus &) = delete;
+
+    ~BasicCompressedCorpus() {
+        Codec::Destroy(compression_result);
+    }
+};
+
+using CompressedCorpus = BasicCompressedCorpus<FSSTPlusCodec>;
+using SegmentCorpus = BasicCompressedCorpus<FSSTPlusSegmentCodec>;
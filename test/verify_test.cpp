@@ -0,0 +1,70 @@
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+#include "../src/fsst_plus.h"
+#include "fsst_plus_verify.h"
+#include "test_helpers.h"
+
+TEST_CASE("The validator accepts written corpora and rejects broken ones", "[verify]") {
+    constexpr size_t n = 30 * test::block_granularity + 5;
+    std::mt19937 rng(21);
+    std::vector<std::string> corpus(n);
+    for (size_t i = 0; i < n; i++) {
+        corpus[i] = "https://shop.example.org/category/" + std::to_string(rng() % 40) + "/page-" + std::to_string(rng() % 500);
+    }
+    const CompressedCorpus c(corpus, [](const size_t row) { return row % 9 == 3; });
+    const FSSTPlusCompressionResult &compression_result = c.compression_result;
+
+    REQUIRE_NOTHROW(VerifyFSSTPlusCompressionResult(compression_result));
+    REQUIRE_NOTHROW(VerifyFSSTPlusDecompressedSizes(compression_result.data_start, c.prefix_decoder, c.suffix_decoder));
+
+    uint8_t *global_header = compression_result.data_start;
+    uint8_t *block_start_offsets = global_header + sizeof(uint16_t);
+    const size_t num_blocks = Load<uint16_t>(global_header);
+    const size_t size = compression_result.data_end - compression_result.data_start;
+    std::vector<uint8_t> original(global_header, compression_result.data_end);
+    const auto restore = [&]() { memcpy(global_header, original.data(), size); };
+
+    // A truncated buffer
+    REQUIRE_THROWS_AS(VerifyFSSTPlusCorpus(global_header, compression_result.data_end - 1), std::logic_error);
+    REQUIRE_THROWS_AS(VerifyFSSTPlusCorpus(global_header, global_header + 1), std::logic_error);
+
+    // Block offsets out of order
+    uint8_t *second_offset = block_start_offsets + sizeof(uint32_t);
+    Store<uint32_t>(Load<uint32_t>(block_start_offsets) - sizeof(uint32_t) - 1, second_offset);
+    REQUIRE_THROWS_AS(VerifyFSSTPlusCorpus(global_header, compression_result.data_end), std::logic_error);
+    restore();
+
+    // decompressed_offsets[] that no longer match the blocks
+    uint8_t *last_decompressed_offset = global_header + sizeof(uint16_t) + (2 * num_blocks + 1) * sizeof(uint32_t);
+    Store<uint32_t>(Load<uint32_t>(last_decompressed_offset) + 3, last_decompressed_offset);
+    REQUIRE_NOTHROW(VerifyFSSTPlusCorpus(global_header, compression_result.data_end));
+    REQUIRE_THROWS_AS(VerifyFSSTPlusDecompressedSizes(global_header, c.prefix_decoder, c.suffix_decoder), std::logic_error);
+    restore();
+
+    // A suffix offset past its block, and a prefix jumpback out of the prefix area
+    uint8_t *block_start = FindBlockStart(block_start_offsets, 0);
+    const size_t block_size = FindBlockStart(block_start_offsets, 1) - block_start;
+    Store<uint16_t>(block_size, block_start + sizeof(uint8_t));
+    REQUIRE_THROWS_AS(VerifyFSSTPlusCorpus(global_header, compression_result.data_end), std::logic_error);
+    restore();
+    bool corrupted_jumpback = false;
+    const size_t n_strings_in_block = Load<uint8_t>(block_start);
+    for (size_t i = 0; i < n_strings_in_block && !corrupted_jumpback; i++) {
+        uint8_t *entry = const_cast<uint8_t *>(FindSuffixDataArea(block_start, i));
+        if (Load<uint8_t>(entry) != 0) {
+            Store<uint16_t>(entry - block_start, entry + sizeof(uint8_t));
+            corrupted_jumpback = true;
+        }
+    }
+    REQUIRE(corrupted_jumpback);
+    REQUIRE_THROWS_AS(VerifyFSSTPlusCorpus(global_header, compression_result.data_end), std::logic_error);
+    restore();
+
+    // A row stored twice
+    uint8_t *rows = block_start + sizeof(uint8_t) + n_strings_in_block * sizeof(uint16_t);
+    rows[1] = rows[0];
+    REQUIRE_THROWS_AS(VerifyFSSTPlusCorpus(global_header, compression_result.data_end), std::logic_error);
+    restore();
+
+    REQUIRE_NOTHROW(VerifyFSSTPlusCompressionResult(compression_result));
+}
@@ -0,0 +1,70 @@
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+#include "../src/fsst_plus.h"
+#include "zone_map.h"
+#include "test_helpers.h"
+
+// Rows are grouped by value range every 1024 rows, so most blocks fall outside a narrow filter
+static std::vector<std::string> GenerateGroupedCorpus(const size_t n) {
+    std::mt19937 rng(5);
+    const std::vector<std::string> hosts = {"", "a", "api.example.com/", "cdn.example.com/", "shop.example.org/", "zz"};
+    std::vector<std::string> corpus;
+    for (size_t i = 0; i < n; i++) {
+        const std::string &host = hosts[(i / 1024) % hosts.size()];
+        corpus.push_back(host + (rng() % 4 ? "v1/items/" : "") + std::to_string(rng() % 5000));
+    }
+    return corpus;
+}
+
+struct ZoneMappedCorpus : CompressedCorpus {
+    explicit ZoneMappedCorpus(const size_t n) : CompressedCorpus(GenerateGroupedCorpus(n), [](const size_t row) { return row % 17 == 0; }) {}
+
+    // Scans with the zone map and checks the result against a plain filter over every row
+    size_t RequireScanMatches(const ZoneMapFilter &filter) const {
+        std::vector<unsigned char> out(LoadDecompressedOffset(compression_result.data_start, Load<uint16_t>(compression_result.data_start)) + 32);
+        std::vector<uint32_t> matching_rows;
+        std::vector<const unsigned char *> out_ptrs;
+        std::vector<size_t> out_lengths;
+        const size_t decoded_blocks = ZoneMapScan(compression_result.data_start, compression_result.zone_map_start, prefix_decoder,
+                                                  suffix_decoder, filter, out.data(), out.data() + out.size(),
+                                                  matching_rows, out_ptrs, out_lengths);
+        std::vector<uint32_t> expected_rows;
+        for (size_t row = 0; row < corpus.size(); row++) {
+            if (input.string_ptrs[row] != nullptr && filter.Matches(input.string_ptrs[row], input.lengths[row])) {
+                expected_rows.push_back(row);
+            }
+        }
+        REQUIRE(matching_rows == expected_rows);
+        for (size_t k = 0; k < matching_rows.size(); k++) {
+            REQUIRE(out_lengths[k] == input.lengths[matching_rows[k]]);
+            REQUIRE(TextMatches(out_ptrs[k], input.string_ptrs[matching_rows[k]], out_lengths[k]));
+        }
+        return decoded_blocks;
+    }
+};
+
+static const unsigned char *Bytes(const std::string &s) {
+    return reinterpret_cast<const unsigned char *>(s.data());
+}
+
+TEST_CASE("Zone maps skip blocks outside range and equality filters", "[zone_map]") {
+    const ZoneMappedCorpus c(12 * 1024);
+    const size_t num_blocks = Load<uint16_t>(c.compression_result.data_start);
+    REQUIRE(Load<uint16_t>(c.compression_result.zone_map_start) == num_blocks);
+    REQUIRE(static_cast<size_t>(c.compression_result.zone_map_end - c.compression_result.zone_map_start) ==
+            sizeof(uint16_t) + num_blocks * zone_map_entry_size);
+
+    const std::string hit = c.corpus[3 * 1024 + 5]; // a "cdn.example.com/" row
+    const std::string missing = "cdn.example.com/v1/items/none";
+    const std::string lower = "api.example.com/v1/items/4", upper = "cdn.example.com/2";
+    const std::string short_key = "a", past_api = "b", past_all = "zzz";
+
+    // Blocks of the "cdn.example.com/" rows, plus those of the rows without a host, which range from digits to "v1/"
+    REQUIRE(c.RequireScanMatches(ZoneMapEquals(Bytes(hit), hit.size())) <= num_blocks / 3);
+    REQUIRE(c.RequireScanMatches(ZoneMapEquals(Bytes(missing), missing.size())) <= num_blocks / 3);
+    REQUIRE(c.RequireScanMatches(ZoneMapBetween(Bytes(lower), lower.size(), Bytes(upper), upper.size())) <= 2 * num_blocks / 3);
+    REQUIRE(c.RequireScanMatches(ZoneMapLess(Bytes(short_key), short_key.size(), true)) <= num_blocks / 6);
+    REQUIRE(c.RequireScanMatches(ZoneMapGreater(Bytes(past_all), past_all.size())) == 0);
+    REQUIRE(c.RequireScanMatches(ZoneMapGreater(Bytes(past_api), past_api.size())) <= 2 * num_blocks / 3);
+    REQUIRE(c.RequireScanMatches(ZoneMapLess(Bytes(upper), upper.size())) < num_blocks);
+}